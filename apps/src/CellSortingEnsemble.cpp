@@ -0,0 +1,378 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Run an ensemble of cell sorting simulations over a grid of noise parameters.
+ *
+ * Each simulation runs in its own forked process.  Simulations rely on global singletons (SimulationTime,
+ * RandomNumberGenerator, CellPropertyRegistry), so a process can only drive one at a time, and a fresh process per
+ * run also guarantees runs cannot affect one another.  Up to --processes runs execute at once.  To spread a grid
+ * over several nodes, for instance as a job array, give each job --task-id and --num-tasks (read from
+ * SLURM_ARRAY_TASK_ID and SLURM_ARRAY_TASK_COUNT if not given); job k then runs every run whose index is k modulo the
+ * number of tasks.  Each run has seed --base-seed plus its index in the full grid, so results do not depend on how the
+ * grid is split.
+ *
+ * Random fields for vertex runs are loaded once, before any runs start, and shared copy-on-write by every run.
+ *
+ * With --snapshot-interval, each run also writes a binary snapshot of its population (node locations, labels and cell
+ * areas) every given number of time steps after labelling, to populationsnapshots.bin in its output directory.
+ * Vertex runs then no longer write the id and mutation state of every cell as text.
+ *
+ * With --vertex-text-output no, vertex runs do not write the id and mutation state of every cell, or the adjacency
+ * matrix of the population, with their results after labelling.  These text dumps dominate the output of long runs.
+ *
+ * Each job writes ensemble_summary_<task id>.csv to the output directory, listing every run it handled with its
+ * parameters, seed, output directory, exit status and wall time.
+ *
+ * With --steady-state-archives, the reruns of each set of parameters fork from one steady state, saved in an archive
+ * under the given directory, rather than each simulating the time to steady state.  The steady state follows the seed
+ * of the first rerun, so it does not depend on which run saves it.  The first such run of each job saves the archive
+ * before the others start; jobs of a job array that save the same archive at once save identical ones, and the first
+ * to finish is kept.
+ *
+ * Example, the lengthscale sweep of TestIbSortingWithNoiseLengthscales on 16 cores:
+ *
+ *   CellSortingEnsemble --model ib --lengthscales 0.003,0.07 --diffusion-strengths 5e8 --reruns 40 --processes 16
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "CellSortingAppHelpers.hpp"
+#include "CellSortingSimulation.hpp"
+#include "Exception.hpp"
+#include "OutputFileHandler.hpp"
+
+/** A single run in the ensemble */
+struct EnsembleRun
+{
+    /** The index of the run in the full parameter grid */
+    unsigned mIndex;
+
+    /** The index of the run among those with the same parameters */
+    unsigned mRerun;
+
+    /** The parameters of the run */
+    CellSortingParameters mParameters;
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        CellSortingParameters base_parameters;
+        std::vector<double> lengthscales = {0.003, 0.07};
+        std::vector<double> diffusion_strengths = {5.0 * 1e8};
+        std::vector<double> cell_gaps = {0.03};
+        std::vector<double> rearrangement_thresholds = {0.01};
+        unsigned num_reruns = 1u;
+        unsigned num_processes = 1u;
+        unsigned base_seed = 0u;
+        std::string output_directory = "VertexIbComp/CellSorting/Ensemble";
+        std::string archive_directory;
+
+        const char* const p_array_task_id = std::getenv("SLURM_ARRAY_TASK_ID");
+        const char* const p_array_task_count = std::getenv("SLURM_ARRAY_TASK_COUNT");
+        unsigned task_id = p_array_task_id ? std::stoul(p_array_task_id) : 0u;
+        unsigned num_tasks = p_array_task_count ? std::stoul(p_array_task_count) : 1u;
+
+        for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+        {
+            const std::string option = argv[arg_idx];
+            if (arg_idx + 1 >= argc)
+            {
+                EXCEPTION("Option " + option + " needs a value.");
+            }
+            const std::string value = argv[++arg_idx];
+
+            if (option == "--model")
+            {
+                if (value == "ib")
+                {
+                    base_parameters.mModel = CellSortingModel::IMMERSED_BOUNDARY;
+                }
+                else if (value == "vertex")
+                {
+                    base_parameters.mModel = CellSortingModel::VERTEX;
+                }
+                else
+                {
+                    EXCEPTION("The model must be 'ib' or 'vertex', not '" + value + "'.");
+                }
+            }
+            else if (option == "--lengthscales")
+            {
+                lengthscales = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--diffusion-strengths")
+            {
+                diffusion_strengths = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--cell-gaps")
+            {
+                cell_gaps = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--rearrangement-thresholds")
+            {
+                rearrangement_thresholds = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--reruns")
+            {
+                num_reruns = std::stoul(value);
+            }
+            else if (option == "--cells-across")
+            {
+                base_parameters.mNumCellsAcross = std::stoul(value);
+            }
+            else if (option == "--steady-state-time")
+            {
+                base_parameters.mTimeToSteadyState = std::stod(value);
+            }
+            else if (option == "--simulation-time")
+            {
+                base_parameters.mTimeForSimulation = std::stod(value);
+            }
+            else if (option == "--snapshot-interval")
+            {
+                base_parameters.mSnapshotSamplingInterval = std::stoul(value);
+            }
+            else if (option == "--vertex-text-output")
+            {
+                if (value != "yes" && value != "no")
+                {
+                    EXCEPTION("The vertex text output must be 'yes' or 'no', not '" + value + "'.");
+                }
+                base_parameters.mWriteVertexTextOutput = value == "yes";
+            }
+            else if (option == "--base-seed")
+            {
+                base_seed = std::stoul(value);
+            }
+            else if (option == "--processes")
+            {
+                num_processes = std::stoul(value);
+            }
+            else if (option == "--output")
+            {
+                output_directory = value;
+            }
+            else if (option == "--steady-state-archives")
+            {
+                archive_directory = value;
+            }
+            else if (option == "--task-id")
+            {
+                task_id = std::stoul(value);
+            }
+            else if (option == "--num-tasks")
+            {
+                num_tasks = std::stoul(value);
+            }
+            else
+            {
+                EXCEPTION("Unknown option " + option + ".");
+            }
+        }
+
+        if (num_processes == 0u || num_tasks == 0u || task_id >= num_tasks)
+        {
+            EXCEPTION("Need at least one process and one task, and a task id less than the number of tasks.");
+        }
+
+        // The third grid dimension is the cell gap for immersed boundary runs and the threshold for vertex runs
+        const bool is_ib = base_parameters.mModel == CellSortingModel::IMMERSED_BOUNDARY;
+        const std::vector<double>& r_model_values = is_ib ? cell_gaps : rearrangement_thresholds;
+
+        // Enumerate the full grid, keeping the runs belonging to this task
+        std::vector<EnsembleRun> runs;
+        unsigned run_idx = 0u;
+        for (const double lengthscale : lengthscales)
+        {
+            for (const double diffusion_strength : diffusion_strengths)
+            {
+                for (const double model_value : r_model_values)
+                {
+                    for (unsigned rerun = 0; rerun < num_reruns; ++rerun, ++run_idx)
+                    {
+                        if (run_idx % num_tasks != task_id)
+                        {
+                            continue;
+                        }
+
+                        CellSortingParameters parameters = base_parameters;
+                        parameters.mLengthscale = lengthscale;
+                        parameters.mDiffusionStrength = diffusion_strength;
+                        if (is_ib)
+                        {
+                            parameters.mCellGap = model_value;
+                        }
+                        else
+                        {
+                            parameters.mRearrangementThreshold = model_value;
+                        }
+                        parameters.mSeed = base_seed + run_idx;
+
+                        const std::string parameters_path =
+                                CellSortingAppHelpers::FormatForPath(lengthscale) + "/" +
+                                CellSortingAppHelpers::FormatForPath(diffusion_strength) + "/" +
+                                CellSortingAppHelpers::FormatForPath(model_value);
+                        if (!archive_directory.empty())
+                        {
+                            parameters.mSteadyStateArchive = archive_directory + "/" + parameters_path;
+                            parameters.mSteadyStateSeed = base_seed + run_idx - rerun;
+                        }
+                        parameters.mOutputDirectory =
+                                output_directory + "/" + parameters_path + "/" + std::to_string(rerun);
+
+                        runs.emplace_back(EnsembleRun{run_idx, rerun, parameters});
+                    }
+                }
+            }
+        }
+
+        // The first run to use each steady state archive saves it, and runs before any others that use it
+        std::size_t num_leading_runs = runs.size();
+        if (!archive_directory.empty())
+        {
+            std::vector<EnsembleRun> leading_runs;
+            std::vector<EnsembleRun> following_runs;
+            std::set<std::string> archives;
+            for (const EnsembleRun& r_run : runs)
+            {
+                const bool is_first = archives.insert(r_run.mParameters.mSteadyStateArchive).second;
+                (is_first ? leading_runs : following_runs).emplace_back(r_run);
+            }
+
+            num_leading_runs = leading_runs.size();
+            runs = leading_runs;
+            runs.insert(runs.end(), following_runs.begin(), following_runs.end());
+        }
+
+        // Load each random field once here, so that every run forked from this process shares the one copy
+        std::set<double> preloaded_lengthscales;
+        for (const EnsembleRun& r_run : runs)
+        {
+            if (preloaded_lengthscales.insert(r_run.mParameters.mLengthscale).second)
+            {
+                CellSortingSimulation::PreloadRandomField(r_run.mParameters);
+            }
+        }
+
+        OutputFileHandler results_handler(output_directory, false);
+        out_stream p_summary = results_handler.OpenOutputFile("ensemble_summary_" + std::to_string(task_id) + ".csv");
+        *p_summary << "run,lengthscale,diffusion_strength," << (is_ib ? "cell_gap" : "rearrangement_threshold")
+                   << ",rerun,seed,output_directory,exit_status,wall_seconds\n";
+
+        using clock = std::chrono::steady_clock;
+        std::map<pid_t, std::pair<const EnsembleRun*, clock::time_point>> running;
+        unsigned num_failed = 0u;
+
+        // Wait for one run to finish, and record it in the summary
+        auto WaitForRun = [&]()
+        {
+            int exit_status = 0;
+            const pid_t pid = CellSortingAppHelpers::WaitForProcess(-1, exit_status);
+
+            // Skip any child that is not one of the simulation processes, such as one started by a library
+            const auto it = running.find(pid);
+            if (it == running.end())
+            {
+                return;
+            }
+
+            const EnsembleRun& r_run = *it->second.first;
+            const double wall_seconds = std::chrono::duration<double>(clock::now() - it->second.second).count();
+            num_failed += exit_status != 0;
+
+            const CellSortingParameters& r_params = r_run.mParameters;
+            *p_summary << r_run.mIndex << "," << r_params.mLengthscale << "," << r_params.mDiffusionStrength << ","
+                       << (is_ib ? r_params.mCellGap : r_params.mRearrangementThreshold) << "," << r_run.mRerun << ","
+                       << r_params.mSeed << "," << r_params.mOutputDirectory << "," << exit_status << ","
+                       << wall_seconds << std::endl;
+
+            running.erase(it);
+        };
+
+        for (std::size_t run_position = 0; run_position < runs.size(); ++run_position)
+        {
+            const EnsembleRun& r_run = runs[run_position];
+
+            // Every archive must be saved before any run resumes from one
+            const bool wait_for_all = run_position == num_leading_runs;
+            while (running.size() >= num_processes || (wait_for_all && !running.empty()))
+            {
+                WaitForRun();
+            }
+
+            const pid_t pid = CellSortingAppHelpers::StartProcess([&r_run]()
+            {
+                try
+                {
+                    CellSortingSimulation::Run(r_run.mParameters);
+                }
+                catch (const Exception& e)
+                {
+                    std::cerr << "Run " << r_run.mIndex << " failed: " << e.GetMessage() << std::endl;
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
+            });
+
+            running.emplace(pid, std::make_pair(&r_run, clock::now()));
+        }
+
+        while (!running.empty())
+        {
+            WaitForRun();
+        }
+
+        std::cout << runs.size() - num_failed << " of " << runs.size() << " runs succeeded; summary in "
+                  << results_handler.GetOutputDirectoryFullPath() << std::endl;
+
+        return num_failed == 0u ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const Exception& e)
+    {
+        std::cerr << e.GetMessage() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
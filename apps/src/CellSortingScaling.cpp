@@ -0,0 +1,325 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+ * Measure the end-to-end throughput of immersed boundary cell sorting against problem size.
+ *
+ * Runs a grid of cell counts (--cells-across), fluid grid resolutions (--fluid-grid-points) and target node spacing
+ * ratios (--node-spacing-ratios), which together set the number of cells, fluid points and membrane nodes.  Each run
+ * settles for --warmup-steps time steps, labels cells, then takes --steps measured time steps.  Runs execute one at a
+ * time, each in its own forked process, so that runs cannot compete for cores or memory bandwidth and the peak
+ * resident set size of each run can be read back from the kernel when it exits.
+ *
+ * Writes scaling_summary.csv to the output directory, listing for every run its parameters, the number of nodes, the
+ * setup time, the measured steps per second and the peak resident set size.  When built with
+ * VertexIbComp_USE_PROFILING, also writes scaling_components.csv with the per-component breakdown of the measured
+ * steps from ImmersedBoundaryProfiler; otherwise that file only has its header.
+ *
+ * With --device-offload 1, the cell-cell force is evaluated on the OpenMP target device, which needs a Verlet list
+ * (--verlet-skin-multiple, as a multiple of the cell gap).  Comparing with --device-offload 0 and the same skin
+ * measures the device path against its host reference.
+ *
+ * Example, a cell count sweep at two fluid resolutions:
+ *
+ *   CellSortingScaling --cells-across 4,8,16 --fluid-grid-points 64,128 --steps 300
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "CellSortingAppHelpers.hpp"
+#include "CellSortingSimulation.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
+#include "OutputFileHandler.hpp"
+
+/**
+ * Run a simulation and describe its timings, one item per line.  The first line is
+ * "run <nodes> <setup seconds> <steps> <solve seconds>" and each following line is
+ * "component <name> <calls> <wall seconds> <pairs> <nodes>".
+ *
+ * @param rParameters the parameters of the simulation
+ * @return the description
+ */
+std::string RunAndDescribe(const CellSortingParameters& rParameters)
+{
+    const CellSortingRunStatistics statistics = CellSortingSimulation::Run(rParameters);
+
+    std::ostringstream description;
+    description.precision(9);
+    description << "run " << statistics.mNumNodes << " " << statistics.mSetupSeconds << " "
+                << statistics.mNumSimulationTimeSteps << " " << statistics.mSimulationSolveSeconds << "\n";
+
+    // The profiling modifier resets the records at the start of each solve, so these cover the measured steps only
+    for (const ImmersedBoundaryProfiler::Record& r_record : ImmersedBoundaryProfiler::GetRecords())
+    {
+        description << "component " << r_record.mName << " " << r_record.mNumCalls << " " << r_record.mWallTime << " "
+                    << r_record.mNumPairs << " " << r_record.mNumNodes << "\n";
+    }
+    return description.str();
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        CellSortingParameters base_parameters;
+        base_parameters.mModel = CellSortingModel::IMMERSED_BOUNDARY;
+        std::vector<double> cells_across = {4.0, 8.0, 16.0};
+        std::vector<double> fluid_grid_points = {128.0};
+        std::vector<double> node_spacing_ratios = {0.5};
+        unsigned num_steps = 300u;
+        unsigned num_warmup_steps = 10u;
+        std::string output_directory = "VertexIbComp/CellSorting/Scaling";
+
+        for (int arg_idx = 1; arg_idx < argc; ++arg_idx)
+        {
+            const std::string option = argv[arg_idx];
+            if (arg_idx + 1 >= argc)
+            {
+                EXCEPTION("Option " + option + " needs a value.");
+            }
+            const std::string value = argv[++arg_idx];
+
+            if (option == "--cells-across")
+            {
+                cells_across = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--fluid-grid-points")
+            {
+                fluid_grid_points = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--node-spacing-ratios")
+            {
+                node_spacing_ratios = CellSortingAppHelpers::ParseList(value);
+            }
+            else if (option == "--steps")
+            {
+                num_steps = std::stoul(value);
+            }
+            else if (option == "--warmup-steps")
+            {
+                num_warmup_steps = std::stoul(value);
+            }
+            else if (option == "--verlet-skin-multiple")
+            {
+                base_parameters.mVerletSkinMultiple = std::stod(value);
+            }
+            else if (option == "--device-offload")
+            {
+                base_parameters.mUseDeviceOffload = std::stoul(value) != 0u;
+            }
+            else if (option == "--lengthscale")
+            {
+                base_parameters.mLengthscale = std::stod(value);
+            }
+            else if (option == "--diffusion-strength")
+            {
+                base_parameters.mDiffusionStrength = std::stod(value);
+            }
+            else if (option == "--seed")
+            {
+                base_parameters.mSeed = std::stoul(value);
+            }
+            else if (option == "--output")
+            {
+                output_directory = value;
+            }
+            else
+            {
+                EXCEPTION("Unknown option " + option + ".");
+            }
+        }
+
+        if (num_steps == 0u || num_warmup_steps == 0u)
+        {
+            EXCEPTION("Need at least one warmup step and one measured step.");
+        }
+
+        // Stage lengths are set in time steps, so every run takes the same number of steps whatever its size
+        const double dt = CellSortingSimulation::GetTimeStep(base_parameters.mModel);
+        base_parameters.mTimeToSteadyState = num_warmup_steps * dt;
+        base_parameters.mTimeForSimulation = num_steps * dt;
+
+        OutputFileHandler results_handler(output_directory, false);
+        out_stream p_summary = results_handler.OpenOutputFile("scaling_summary.csv");
+        *p_summary << "cells_across,fluid_grid_points,node_spacing_ratio,num_nodes,setup_seconds,num_steps,"
+                      "solve_seconds,steps_per_second,peak_rss_mb,exit_status\n";
+        out_stream p_components = results_handler.OpenOutputFile("scaling_components.csv");
+        *p_components << "cells_across,fluid_grid_points,node_spacing_ratio,component,calls,wall_seconds,"
+                         "seconds_per_step,pairs,nodes\n";
+
+        unsigned num_runs = 0u;
+        unsigned num_failed = 0u;
+        for (const double num_across : cells_across)
+        {
+            for (const double num_grid_points : fluid_grid_points)
+            {
+                for (const double node_spacing_ratio : node_spacing_ratios)
+                {
+                    CellSortingParameters parameters = base_parameters;
+                    parameters.mNumCellsAcross = static_cast<unsigned>(num_across);
+                    parameters.mNumFluidGridPoints = static_cast<unsigned>(num_grid_points);
+                    parameters.mTargetNodeSpacingRatio = node_spacing_ratio;
+                    parameters.mOutputDirectory = output_directory + "/" + CellSortingAppHelpers::FormatForPath(num_across) + "/" +
+                                                  CellSortingAppHelpers::FormatForPath(num_grid_points) + "/" +
+                                                  CellSortingAppHelpers::FormatForPath(node_spacing_ratio);
+
+                    int result_pipe[2];
+                    if (pipe(result_pipe) != 0)
+                    {
+                        EXCEPTION("Could not open a pipe to a simulation process.");
+                    }
+
+                    const pid_t pid = CellSortingAppHelpers::StartProcess([&parameters, &result_pipe]()
+                    {
+                        close(result_pipe[0]);
+                        int exit_status = EXIT_SUCCESS;
+                        try
+                        {
+                            const std::string description = RunAndDescribe(parameters);
+                            std::size_t num_written = 0u;
+                            while (num_written < description.size())
+                            {
+                                const ssize_t written = write(result_pipe[1], description.data() + num_written,
+                                                              description.size() - num_written);
+                                if (written <= 0)
+                                {
+                                    exit_status = EXIT_FAILURE;
+                                    break;
+                                }
+                                num_written += static_cast<std::size_t>(written);
+                            }
+                        }
+                        catch (const Exception& e)
+                        {
+                            std::cerr << "Run with " << parameters.mNumCellsAcross << " cells across failed: "
+                                      << e.GetMessage() << std::endl;
+                            exit_status = EXIT_FAILURE;
+                        }
+                        close(result_pipe[1]);
+                        return exit_status;
+                    });
+
+                    // Read everything the child sends before waiting, so a large description cannot block it
+                    close(result_pipe[1]);
+                    std::string description;
+                    char buffer[4096];
+                    ssize_t num_read = 0;
+                    while ((num_read = read(result_pipe[0], buffer, sizeof(buffer))) > 0)
+                    {
+                        description.append(buffer, static_cast<std::size_t>(num_read));
+                    }
+                    close(result_pipe[0]);
+
+                    int exit_status = 0;
+                    struct rusage usage;
+                    CellSortingAppHelpers::WaitForProcess(pid, exit_status, &usage);
+                    ++num_runs;
+                    num_failed += exit_status != 0;
+
+                    // On Linux ru_maxrss is in kilobytes
+                    const double peak_rss_mb = usage.ru_maxrss / 1024.0;
+
+                    unsigned num_nodes = 0u;
+                    unsigned num_measured_steps = 0u;
+                    double setup_seconds = 0.0;
+                    double solve_seconds = 0.0;
+
+                    std::istringstream description_stream(description);
+                    std::string line;
+                    while (std::getline(description_stream, line))
+                    {
+                        std::istringstream line_stream(line);
+                        std::string kind;
+                        line_stream >> kind;
+                        if (kind == "run")
+                        {
+                            line_stream >> num_nodes >> setup_seconds >> num_measured_steps >> solve_seconds;
+                        }
+                        else if (kind == "component")
+                        {
+                            std::string name;
+                            unsigned long long num_calls = 0u;
+                            double wall_seconds = 0.0;
+                            unsigned long long num_pairs = 0u;
+                            unsigned long long num_component_nodes = 0u;
+                            line_stream >> name >> num_calls >> wall_seconds >> num_pairs >> num_component_nodes;
+
+                            *p_components << num_across << "," << num_grid_points << "," << node_spacing_ratio << ","
+                                          << name << "," << num_calls << "," << wall_seconds << ","
+                                          << (num_measured_steps > 0u ? wall_seconds / num_measured_steps : 0.0)
+                                          << "," << num_pairs << "," << num_component_nodes << "\n";
+                        }
+                    }
+
+                    const double steps_per_second = solve_seconds > 0.0 ? num_measured_steps / solve_seconds : 0.0;
+                    *p_summary << num_across << "," << num_grid_points << "," << node_spacing_ratio << ","
+                               << num_nodes << "," << setup_seconds << "," << num_measured_steps << ","
+                               << solve_seconds << "," << steps_per_second << "," << peak_rss_mb << ","
+                               << exit_status << std::endl;
+                    p_components->flush();
+
+                    std::cout << num_across << " cells across, " << num_grid_points << " fluid points, node spacing "
+                              << node_spacing_ratio << ": " << steps_per_second << " steps/s, " << peak_rss_mb
+                              << " MB peak" << std::endl;
+                }
+            }
+        }
+
+        if (!ImmersedBoundaryProfiler::IsEnabled())
+        {
+            std::cout << "Built without VertexIbComp_USE_PROFILING, so there is no per-component breakdown."
+                      << std::endl;
+        }
+        std::cout << num_runs - num_failed << " of " << num_runs << " runs succeeded; summary in "
+                  << results_handler.GetOutputDirectoryFullPath() << std::endl;
+
+        return num_failed == 0u ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const Exception& e)
+    {
+        std::cerr << e.GetMessage() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
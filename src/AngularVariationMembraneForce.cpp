@@ -35,12 +35,44 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "AngularVariationMembraneForce.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include "ChasteMakeUnique.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryPeriodicDifference.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
+#include "OffloadBuffer.hpp"
+
+template <unsigned DIM>
+struct AngularVariationMembraneForce<DIM>::DeviceState
+{
+    /** The location of the nodes of every element, one element after another, copied to the device each time step */
+    OffloadBuffer<double> mSlotLocations;
+
+    /** The offset of the nodes of each element in mSlotLocations, with the total number of nodes at the end */
+    OffloadBuffer<unsigned> mElementOffsets;
+
+    /** The element, in iteration order, of each node in mSlotLocations */
+    OffloadBuffer<unsigned> mSlotElements;
+
+    /** The spring constant and rest length of each element, copied to the device each time step */
+    OffloadBuffer<double> mElementConstants;
+
+    /** The aggregate force on each node in mSlotLocations, copied back each time step */
+    OffloadBuffer<double> mSlotForces;
+
+    /** The offsets of the current time step, compared with mElementOffsets to find if the layout has changed */
+    std::vector<unsigned> mScratchOffsets;
+};
+
 template <unsigned DIM>
 AngularVariationMembraneForce<DIM>::AngularVariationMembraneForce()
         : AbstractImmersedBoundaryForce<DIM>(),
           mpMesh(NULL),
           mSpringConstant(1e6),
-          mRestLengthMultiplier(0.5)
+          mRestLengthMultiplier(0.5),
+          mUseDeviceOffload(false)
 {
 }
 
@@ -53,10 +85,14 @@ template <unsigned DIM>
 void AngularVariationMembraneForce<DIM>::AddImmersedBoundaryForceContribution(std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
                                                                               ImmersedBoundaryCellPopulation<DIM>& rCellPopulation)
 {
+    IB_PROFILE_SCOPE(timer, "AngularVariationMembraneForce");
+    IB_PROFILE_ADD_NODES(timer, rCellPopulation.GetNumNodes());
+
     // This is only run once, on the first pass, and performs a set-up of all necessary class members
     if (mpMesh == NULL)
     {
         mpMesh = &(rCellPopulation.rGetMesh());
+        mpGeometryCache = ImmersedBoundaryGeometryCache<DIM>::GetForMesh(*mpMesh);
     }
 
     /*
@@ -66,6 +102,12 @@ void AngularVariationMembraneForce<DIM>::AddImmersedBoundaryForceContribution(st
     // Used in the calculation of the spring constant
     mIntrinsicSpacingSquared = rCellPopulation.GetIntrinsicSpacing() * rCellPopulation.GetIntrinsicSpacing();
 
+    if (mUseDeviceOffload)
+    {
+        AddDeviceForceContribution();
+        return;
+    }
+
     for (typename ImmersedBoundaryMesh<DIM, DIM>::ImmersedBoundaryElementIterator elem_it = mpMesh->GetElementIteratorBegin();
          elem_it != mpMesh->GetElementIteratorEnd();
          ++elem_it)
@@ -79,15 +121,8 @@ template <unsigned ELEMENT_DIM, unsigned SPACE_DIM>
 void AngularVariationMembraneForce<DIM>::CalculateForcesOnElement(ImmersedBoundaryElement<ELEMENT_DIM, SPACE_DIM>& rElement)
 {
     // Get index and number of nodes of current element
-    unsigned elem_idx = rElement.GetIndex();
-    unsigned num_nodes = rElement.GetNumNodes();
-
-    // Helper variables
-    double normed_dist;
-    c_vector<double, DIM> aggregate_force;
-
-    // Make a vector to store the force on node i+1 from node i
-    std::vector<c_vector<double, DIM> > elastic_force_to_next_node(num_nodes);
+    const unsigned elem_idx = rElement.GetIndex();
+    const unsigned num_nodes = rElement.GetNumNodes();
 
     /*
      * Get the node spacing ratio for this element.  The rest length and spring constant are derived from this
@@ -100,43 +135,271 @@ void AngularVariationMembraneForce<DIM>::CalculateForcesOnElement(ImmersedBounda
      * takes into account the energy considerations of the elastic springs, and the other takes account of the
      * factor of node_spacing used in discretising the force relation.
      */
+    const double node_spacing = mpGeometryCache->GetAverageNodeSpacingOfElement(elem_idx);
 
-    double node_spacing;
-    double spring_constant;
-    double rest_length;
+    const double spring_constant = mSpringConstant * mIntrinsicSpacingSquared / (node_spacing * node_spacing);
+    const double rest_length = mRestLengthMultiplier * node_spacing;
 
-    node_spacing = mpMesh->GetAverageNodeSpacingOfElement(elem_idx, false);
+    // Gather the node locations into contiguous storage, repeating the first node at the end of each component
+    const unsigned stride = num_nodes + 1u;
+    mScratchLocations.resize(DIM * stride);
+    mScratchElasticForces.resize(DIM * num_nodes);
 
-    spring_constant = mSpringConstant * mIntrinsicSpacingSquared / (node_spacing * node_spacing);
-    rest_length = mRestLengthMultiplier * node_spacing;
-
-    // Loop over nodes and calculate the force exerted on node i+1 by node i
-    for (unsigned node_idx = 0; node_idx < num_nodes; node_idx++)
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, SPACE_DIM>& r_location = rElement.GetNodeLocation(node_idx);
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            mScratchLocations[dim * stride + node_idx] = r_location[dim];
+        }
+    }
+    for (unsigned dim = 0; dim < DIM; ++dim)
     {
-        // Index of the next node, calculated modulo number of nodes in this element
-        unsigned next_idx = (node_idx + 1) % num_nodes;
+        mScratchLocations[dim * stride + num_nodes] = mScratchLocations[dim * stride];
+    }
 
-        // Hooke's law linear spring force
-        elastic_force_to_next_node[node_idx] = mpMesh->GetVectorFromAtoB(rElement.GetNodeLocation(node_idx), rElement.GetNodeLocation(next_idx));
-        normed_dist = norm_2(elastic_force_to_next_node[node_idx]);
+    /*
+     * Calculate the vector from node i to node i+1.  As in ImmersedBoundaryMesh::GetVectorFromAtoB(), the domain is
+     * periodic on the unit square, so any component longer than half the domain is wrapped.
+     */
+    for (unsigned dim = 0; dim < DIM; ++dim)
+    {
+        const double* const p_locations = &mScratchLocations[dim * stride];
+        double* const p_forces = &mScratchElasticForces[dim * num_nodes];
 
-        double cos_theta = fabs(elastic_force_to_next_node[node_idx][1]) / normed_dist;
-        double modified_spring_constant = spring_constant * (1.0 + cos_theta);
-        double modified_rest_length = rest_length;
+        for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+        {
+            p_forces[node_idx] = CalculatePeriodicDifference(p_locations[node_idx], p_locations[node_idx + 1u]);
+        }
+    }
 
-        elastic_force_to_next_node[node_idx] *= modified_spring_constant * (normed_dist - modified_rest_length) / normed_dist;
+    // Hooke's law linear spring force, with the spring constant modified by the angle the spring makes to the x-axis
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        double normed_dist_squared = 0.0;
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            const double component = mScratchElasticForces[dim * num_nodes + node_idx];
+            normed_dist_squared += component * component;
+        }
+        const double normed_dist = std::sqrt(normed_dist_squared);
+
+        const double cos_theta = DIM > 1u ? std::fabs(mScratchElasticForces[num_nodes + node_idx]) / normed_dist : 0.0;
+        const double modified_spring_constant = spring_constant * (1.0 + cos_theta);
+        const double modified_rest_length = rest_length;
+
+        const double scale = modified_spring_constant * (normed_dist - modified_rest_length) / normed_dist;
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            mScratchElasticForces[dim * num_nodes + node_idx] *= scale;
+        }
     }
 
-    // Add the contributions of springs adjacent to each node
-    for (unsigned node_idx = 0; node_idx < num_nodes; node_idx++)
+    // Add the contributions of springs adjacent to each node, and apply the aggregate force to the node once
+    c_vector<double, DIM> aggregate_force;
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
     {
         // Get index of previous node
-        unsigned prev_idx = (node_idx + num_nodes - 1) % num_nodes;
+        const unsigned prev_idx = node_idx == 0u ? num_nodes - 1u : node_idx - 1u;
+
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            const double* const p_forces = &mScratchElasticForces[dim * num_nodes];
+            aggregate_force[dim] = p_forces[node_idx] - p_forces[prev_idx];
+        }
+
+        rElement.GetNode(node_idx)->AddAppliedForceContribution(aggregate_force);
+    }
+}
+
+template <>
+template <>
+void AngularVariationMembraneForce<2>::CalculateForcesOnElement(ImmersedBoundaryElement<2, 2>& rElement)
+{
+    // Get index and number of nodes of current element
+    const unsigned elem_idx = rElement.GetIndex();
+    const unsigned num_nodes = rElement.GetNumNodes();
+
+    // The rest length and spring constant are derived as in the general case
+    const double node_spacing = mpGeometryCache->GetAverageNodeSpacingOfElement(elem_idx);
+
+    const double spring_constant = mSpringConstant * mIntrinsicSpacingSquared / (node_spacing * node_spacing);
+    const double rest_length = mRestLengthMultiplier * node_spacing;
+
+    // The force on node i+1 from node i, with the two components interleaved
+    mScratchElasticForces.resize(2u * num_nodes);
+
+    const c_vector<double, 2>& r_first_location = rElement.GetNodeLocation(0);
+    double this_x = r_first_location[0];
+    double this_y = r_first_location[1];
+
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, 2>& r_next_location = rElement.GetNodeLocation(node_idx + 1u == num_nodes ? 0u : node_idx + 1u);
+        const double next_x = r_next_location[0];
+        const double next_y = r_next_location[1];
+
+        // Wrap on the periodic unit square, as in the general case
+        const double vec_x = CalculatePeriodicDifference(this_x, next_x);
+        const double vec_y = CalculatePeriodicDifference(this_y, next_y);
+
+        // Hooke's law linear spring force, with the spring constant modified by the angle the spring makes to the x-axis
+        const double normed_dist = std::sqrt(vec_x * vec_x + vec_y * vec_y);
+        const double cos_theta = std::fabs(vec_y) / normed_dist;
+        const double scale = spring_constant * (1.0 + cos_theta) * (normed_dist - rest_length) / normed_dist;
+
+        mScratchElasticForces[2u * node_idx] = vec_x * scale;
+        mScratchElasticForces[2u * node_idx + 1u] = vec_y * scale;
 
-        aggregate_force = elastic_force_to_next_node[node_idx] - elastic_force_to_next_node[prev_idx];
+        this_x = next_x;
+        this_y = next_y;
+    }
+
+    // Add the contributions of springs adjacent to each node, and apply the aggregate force to the node once
+    c_vector<double, 2> aggregate_force;
+    unsigned prev_idx = num_nodes - 1u;
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        aggregate_force[0] = mScratchElasticForces[2u * node_idx] - mScratchElasticForces[2u * prev_idx];
+        aggregate_force[1] = mScratchElasticForces[2u * node_idx + 1u] - mScratchElasticForces[2u * prev_idx + 1u];
 
-        // Add the aggregate force contribution to the node
         rElement.GetNode(node_idx)->AddAppliedForceContribution(aggregate_force);
+        prev_idx = node_idx;
+    }
+}
+
+template <unsigned DIM>
+void AngularVariationMembraneForce<DIM>::AddDeviceForceContribution()
+{
+    EXCEPTION("Device offload is only available in 2D.");
+}
+
+template <>
+void AngularVariationMembraneForce<2>::AddDeviceForceContribution()
+{
+    if (!mpDeviceState)
+    {
+        mpDeviceState = our::make_unique<DeviceState>();
+    }
+    DeviceState& r_state = *mpDeviceState;
+
+    // Lay out the nodes of every element one element after another, with the spring constant and rest length of each
+    const unsigned num_elems = mpMesh->GetNumElements();
+    r_state.mScratchOffsets.resize(num_elems + 1u);
+    r_state.mElementConstants.Resize(2u * num_elems);
+
+    unsigned elem_count = 0u;
+    unsigned num_slots = 0u;
+    for (auto elem_it = mpMesh->GetElementIteratorBegin(); elem_it != mpMesh->GetElementIteratorEnd(); ++elem_it, ++elem_count)
+    {
+        const double node_spacing = mpGeometryCache->GetAverageNodeSpacingOfElement(elem_it->GetIndex());
+
+        r_state.mScratchOffsets[elem_count] = num_slots;
+        r_state.mElementConstants[2u * elem_count] = mSpringConstant * mIntrinsicSpacingSquared / (node_spacing * node_spacing);
+        r_state.mElementConstants[2u * elem_count + 1u] = mRestLengthMultiplier * node_spacing;
+        num_slots += elem_it->GetNumNodes();
+    }
+    r_state.mScratchOffsets[num_elems] = num_slots;
+
+    if (num_slots == 0u)
+    {
+        return;
+    }
+
+    // The layout only changes if the number of nodes in an element does
+    if (r_state.mElementOffsets.size() != num_elems + 1u ||
+        !std::equal(r_state.mScratchOffsets.begin(), r_state.mScratchOffsets.end(), r_state.mElementOffsets.data()))
+    {
+        r_state.mElementOffsets.Resize(num_elems + 1u);
+        std::copy(r_state.mScratchOffsets.begin(), r_state.mScratchOffsets.end(), r_state.mElementOffsets.data());
+
+        r_state.mSlotElements.Resize(num_slots);
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            std::fill(r_state.mSlotElements.data() + r_state.mScratchOffsets[elem_idx],
+                      r_state.mSlotElements.data() + r_state.mScratchOffsets[elem_idx + 1u],
+                      elem_idx);
+        }
+
+        r_state.mElementOffsets.CopyToDevice();
+        r_state.mSlotElements.CopyToDevice();
+    }
+
+    r_state.mSlotLocations.Resize(2u * num_slots);
+    r_state.mSlotForces.Resize(2u * num_slots);
+
+    unsigned slot_idx = 0u;
+    for (auto elem_it = mpMesh->GetElementIteratorBegin(); elem_it != mpMesh->GetElementIteratorEnd(); ++elem_it)
+    {
+        for (unsigned node_idx = 0; node_idx < elem_it->GetNumNodes(); ++node_idx, ++slot_idx)
+        {
+            const c_vector<double, 2>& r_location = elem_it->GetNodeLocation(node_idx);
+            r_state.mSlotLocations[2u * slot_idx] = r_location[0];
+            r_state.mSlotLocations[2u * slot_idx + 1u] = r_location[1];
+        }
+    }
+    r_state.mSlotLocations.CopyToDevice();
+    r_state.mElementConstants.CopyToDevice();
+
+    // Kernels may only use plain pointers and values
+    const double* const p_locations = r_state.mSlotLocations.data();
+    const unsigned* const p_offsets = r_state.mElementOffsets.data();
+    const unsigned* const p_slot_elements = r_state.mSlotElements.data();
+    const double* const p_constants = r_state.mElementConstants.data();
+    double* const p_forces = r_state.mSlotForces.data();
+
+    // Each node evaluates the spring from the previous node and the spring to the next, and writes only its own force
+#ifdef _OPENMP
+#pragma omp target teams distribute parallel for \
+        map(alloc: p_locations[0:2u * num_slots], p_offsets[0:num_elems + 1u], p_slot_elements[0:num_slots], \
+                   p_constants[0:2u * num_elems], p_forces[0:2u * num_slots])
+#endif
+    for (unsigned slot = 0; slot < num_slots; ++slot)
+    {
+        const unsigned elem = p_slot_elements[slot];
+        const unsigned first_slot = p_offsets[elem];
+        const unsigned num_nodes = p_offsets[elem + 1u] - first_slot;
+        const unsigned node_idx = slot - first_slot;
+
+        const double spring_constant = p_constants[2u * elem];
+        const double rest_length = p_constants[2u * elem + 1u];
+
+        // Springs from the previous node to this one, and from this one to the next
+        const unsigned spring_starts[2] = {node_idx == 0u ? num_nodes - 1u : node_idx - 1u, node_idx};
+        double spring_forces[2][2];
+        for (unsigned spring = 0; spring < 2u; ++spring)
+        {
+            const unsigned start = first_slot + spring_starts[spring];
+            const unsigned end = first_slot + (spring_starts[spring] + 1u == num_nodes ? 0u : spring_starts[spring] + 1u);
+
+            // Wrap on the periodic unit square, as on the host
+            const double vec_x = CalculatePeriodicDifference(p_locations[2u * start], p_locations[2u * end]);
+            const double vec_y = CalculatePeriodicDifference(p_locations[2u * start + 1u], p_locations[2u * end + 1u]);
+
+            const double normed_dist = std::sqrt(vec_x * vec_x + vec_y * vec_y);
+            const double cos_theta = std::fabs(vec_y) / normed_dist;
+            const double scale = spring_constant * (1.0 + cos_theta) * (normed_dist - rest_length) / normed_dist;
+
+            spring_forces[spring][0] = vec_x * scale;
+            spring_forces[spring][1] = vec_y * scale;
+        }
+
+        p_forces[2u * slot] = spring_forces[1][0] - spring_forces[0][0];
+        p_forces[2u * slot + 1u] = spring_forces[1][1] - spring_forces[0][1];
+    }
+
+    r_state.mSlotForces.CopyFromDevice();
+
+    c_vector<double, 2> aggregate_force;
+    slot_idx = 0u;
+    for (auto elem_it = mpMesh->GetElementIteratorBegin(); elem_it != mpMesh->GetElementIteratorEnd(); ++elem_it)
+    {
+        for (unsigned node_idx = 0; node_idx < elem_it->GetNumNodes(); ++node_idx, ++slot_idx)
+        {
+            aggregate_force[0] = r_state.mSlotForces[2u * slot_idx];
+            aggregate_force[1] = r_state.mSlotForces[2u * slot_idx + 1u];
+            elem_it->GetNode(node_idx)->AddAppliedForceContribution(aggregate_force);
+        }
     }
 }
 
@@ -164,11 +427,28 @@ double AngularVariationMembraneForce<DIM>::GetRestLengthMultiplier()
     return mRestLengthMultiplier;
 }
 
+template <unsigned DIM>
+bool AngularVariationMembraneForce<DIM>::GetUseDeviceOffload() const
+{
+    return mUseDeviceOffload;
+}
+
+template <unsigned DIM>
+void AngularVariationMembraneForce<DIM>::SetUseDeviceOffload(bool useDeviceOffload)
+{
+    if (useDeviceOffload && DIM != 2u)
+    {
+        EXCEPTION("Device offload is only available in 2D.");
+    }
+    mUseDeviceOffload = useDeviceOffload;
+}
+
 template <unsigned DIM>
 void AngularVariationMembraneForce<DIM>::OutputImmersedBoundaryForceParameters(out_stream& rParamsFile)
 {
     *rParamsFile << "\t\t\t<SpringConstant>" << mSpringConstant << "</SpringConstant>\n";
     *rParamsFile << "\t\t\t<RestLengthMultiplier>" << mRestLengthMultiplier << "</RestLengthMultiplier>\n";
+    *rParamsFile << "\t\t\t<UseDeviceOffload>" << mUseDeviceOffload << "</UseDeviceOffload>\n";
 
     // Call method on direct parent class
     AbstractImmersedBoundaryForce<DIM>::OutputImmersedBoundaryForceParameters(rParamsFile);
@@ -179,6 +459,9 @@ template class AngularVariationMembraneForce<1>;
 template class AngularVariationMembraneForce<2>;
 template class AngularVariationMembraneForce<3>;
 
+// In 2D the general case of CalculateForcesOnElement() serves laminas, and tests compare it with the specialisation
+template void AngularVariationMembraneForce<2>::CalculateForcesOnElement(ImmersedBoundaryElement<1, 2>& rElement);
+
 // Serialization for Boost >= 1.36
 #include "SerializationExportWrapperForCpp.hpp"
 EXPORT_TEMPLATE_CLASS_SAME_DIMS(AngularVariationMembraneForce)
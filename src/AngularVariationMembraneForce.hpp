@@ -37,13 +37,16 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ANGULARVARIATIONMEMBRANEFORCE_HPP_
 
 #include "ChasteSerialization.hpp"
+#include "ChasteSerializationVersion.hpp"
 #include <boost/serialization/base_object.hpp>
 
 #include "AbstractImmersedBoundaryForce.hpp"
 #include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryGeometryCache.hpp"
 #include "ImmersedBoundaryMesh.hpp"
 
 #include <iostream>
+#include <memory>
 
 /**
  * A force class for use in immersed boundary simulations.  The force varies with angle of
@@ -68,6 +71,12 @@ private:
         archive & boost::serialization::base_object<AbstractImmersedBoundaryForce<DIM> >(*this);
         archive & mSpringConstant;
         archive & mRestLengthMultiplier;
+
+        // Archives of version 0 predate device offload, which is then off
+        if (version > 0)
+        {
+            archive & mUseDeviceOffload;
+        }
     }
 
 protected:
@@ -75,6 +84,9 @@ protected:
     /** The immersed boundary mesh. */
     ImmersedBoundaryMesh<DIM,DIM>* mpMesh;
 
+    /** The element geometry cache shared by all users of mpMesh */
+    std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> mpGeometryCache;
+
     /** The membrane spring constant associated with each element. */
     double mSpringConstant;
 
@@ -84,9 +96,48 @@ protected:
     /** A value needed to calculate elastic forces, set every time step in AddImmersedBoundaryForceContribution() */
     double mIntrinsicSpacingSquared;
 
+    /**
+     * Scratch space for CalculateForcesOnElement(), reused across elements and time steps so that no allocation is
+     * needed once it has grown to fit the largest element.  Node locations are stored one component after another,
+     * and each component has the first node repeated at the end so the spring from the last node to the first is
+     * treated like every other spring.
+     */
+    std::vector<double> mScratchLocations;
+
+    /** Scratch space for CalculateForcesOnElement(): the force on node i+1 from node i, one component after another */
+    std::vector<double> mScratchElasticForces;
+
+    /** Whether to evaluate the spring forces on the default OpenMP target device, rather than on the host */
+    bool mUseDeviceOffload;
+
+    /** The arrays kept on the device by AddDeviceForceContribution(), defined with it */
+    struct DeviceState;
+
+    /** The device state, created on first use of the device */
+    std::unique_ptr<DeviceState> mpDeviceState;
+
+    /**
+     * Calculate the elastic forces between consecutive nodes of an element, and add them to the nodes.
+     *
+     * Immersed boundary simulations are in practice two dimensional, so there is a specialisation for DIM=2 that
+     * makes a single pass over the springs with the two components held in registers.
+     *
+     * @param rElement the element
+     */
     template<unsigned ELEMENT_DIM, unsigned SPACE_DIM>
     void CalculateForcesOnElement(ImmersedBoundaryElement<ELEMENT_DIM, SPACE_DIM>& rElement);
 
+    /**
+     * Calculate the elastic forces of every element on the default OpenMP target device, and add them to the nodes.
+     *
+     * The nodes of all elements are laid out one element after another, and the layout stays on the device until
+     * the number of nodes in an element changes.  Each time step only the node locations and the spring constant and
+     * rest length of each element are copied to the device, and only the aggregate force on each node is copied
+     * back.  Each node evaluates both of its springs, as in the specialisation of CalculateForcesOnElement() for
+     * DIM=2, so results match the host up to differences in the device's sqrt().  Only available in 2D.
+     */
+    void AddDeviceForceContribution();
+
 public:
 
     /**
@@ -130,6 +181,20 @@ public:
      */
     double GetRestLengthMultiplier();
 
+    /**
+     * @return mUseDeviceOffload
+     */
+    bool GetUseDeviceOffload() const;
+
+    /**
+     * Set whether to evaluate the spring forces on the default OpenMP target device.  Only available in 2D.  The
+     * host loop remains the reference.  Build with VertexIbComp_USE_OPENMP and offload flags for a device; otherwise
+     * OpenMP runs the device loop on the host.
+     *
+     * @param useDeviceOffload the new value of mUseDeviceOffload
+     */
+    void SetUseDeviceOffload(bool useDeviceOffload);
+
     /**
      * Overridden OutputImmersedBoundaryForceParameters() method.
      *
@@ -141,4 +206,21 @@ public:
 #include "SerializationExportWrapper.hpp"
 EXPORT_TEMPLATE_CLASS_SAME_DIMS(AngularVariationMembraneForce)
 
+namespace boost
+{
+namespace serialization
+{
+/**
+ * Specify a version number for this templated class, as BOOST_CLASS_VERSION does not work for templates.
+ * Version 1 adds device offload.
+ */
+template<unsigned DIM>
+struct version<AngularVariationMembraneForce<DIM> >
+{
+    /// Macro to set the version number of templated archive in known versions of Boost
+    CHASTE_VERSION_CONTENT(1);
+};
+} // namespace serialization
+} // namespace boost
+
 #endif /*ANGULARVARIATIONMEMBRANEFORCE_HPP_*/
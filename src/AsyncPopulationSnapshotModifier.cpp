@@ -0,0 +1,315 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "AsyncPopulationSnapshotModifier.hpp"
+
+#include <utility>
+
+#include "CellLabel.hpp"
+#include "Exception.hpp"
+#include "SimulationOutputDirectory.hpp"
+#include "SimulationTime.hpp"
+
+namespace
+{
+/**
+ * Write an array of values to a binary stream in native byte order.
+ *
+ * @param rStream the stream
+ * @param rValues the values
+ */
+template<typename T>
+void WriteValues(std::ostream& rStream, const std::vector<T>& rValues)
+{
+    if (!rValues.empty())
+    {
+        rStream.write(reinterpret_cast<const char*>(rValues.data()), rValues.size() * sizeof(T));
+    }
+}
+
+/**
+ * Write a single value to a binary stream in native byte order.
+ *
+ * @param rStream the stream
+ * @param value the value
+ */
+template<typename T>
+void WriteValue(std::ostream& rStream, T value)
+{
+    rStream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+} // namespace
+
+template<unsigned DIM>
+AsyncPopulationSnapshotModifier<DIM>::~AsyncPopulationSnapshotModifier()
+{
+    StopWriter();
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (SimulationTime::Instance()->GetTimeStepsElapsed() % mSamplingInterval == 0u)
+    {
+        TakeSnapshot(rCellPopulation);
+    }
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    // The writer is still running if the previous Solve() threw
+    StopWriter();
+
+    // A simulation that is solved in stages, such as to label cells after reaching steady state, continues one file
+    const std::string simulation_directory = GetSimulationOutputDirectory(outputDirectory);
+    const bool continuing = mpSnapshotFile && simulation_directory == mOutputDirectory;
+    if (continuing)
+    {
+        // This stage starts from the final state of the last, so sampling it could repeat the last stage's snapshot
+        StartWriter();
+        return;
+    }
+
+    OutputFileHandler output_file_handler(simulation_directory, false);
+    mpSnapshotFile = output_file_handler.OpenOutputFile("populationsnapshots.bin",
+                                                        std::ios::out | std::ios::trunc | std::ios::binary);
+    mOutputDirectory = simulation_directory;
+    mWriteFailed = false;
+
+    mpSnapshotFile->write("POPSNAP1", 8);
+    WriteValue<std::uint32_t>(*mpSnapshotFile, DIM);
+    WriteValue<std::uint32_t>(*mpSnapshotFile, mCellDataItems.size());
+    for (const std::string& r_item : mCellDataItems)
+    {
+        WriteValue<std::uint32_t>(*mpSnapshotFile, r_item.size());
+        mpSnapshotFile->write(r_item.data(), r_item.size());
+    }
+
+    StartWriter();
+    TakeSnapshot(rCellPopulation);
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    StopWriter();
+
+    if (mWriteFailed)
+    {
+        EXCEPTION("Writing the population snapshot file failed.");
+    }
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::TakeSnapshot(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    // Fill the free buffer while the writer thread may still be writing the other
+    Snapshot& r_snapshot = mFillSnapshot;
+    r_snapshot.mTime = SimulationTime::Instance()->GetTime();
+
+    const unsigned num_nodes = rCellPopulation.GetNumNodes();
+    r_snapshot.mNodeLocations.resize(num_nodes * DIM);
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, DIM>& r_location = rCellPopulation.GetNode(node_idx)->rGetLocation();
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            r_snapshot.mNodeLocations[node_idx * DIM + dim] = r_location[dim];
+        }
+    }
+
+    r_snapshot.mLocationIndices.clear();
+    r_snapshot.mCellIds.clear();
+    r_snapshot.mIsLabelled.clear();
+    r_snapshot.mVolumes.clear();
+    r_snapshot.mCellData.clear();
+    for (CellPtr p_cell : rCellPopulation.rGetCells())
+    {
+        r_snapshot.mLocationIndices.push_back(rCellPopulation.GetLocationIndexUsingCell(p_cell));
+        r_snapshot.mCellIds.push_back(p_cell->GetCellId());
+        r_snapshot.mIsLabelled.push_back(p_cell->template HasCellProperty<CellLabel>() ? 1u : 0u);
+        r_snapshot.mVolumes.push_back(rCellPopulation.GetVolumeOfCell(p_cell));
+
+        for (const std::string& r_item : mCellDataItems)
+        {
+            r_snapshot.mCellData.push_back(p_cell->GetCellData()->GetItem(r_item));
+        }
+    }
+
+    // Hand it over, waiting only if the previous snapshot is still being written
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]{ return !mHasPendingSnapshot; });
+
+        if (mWriteFailed)
+        {
+            EXCEPTION("Writing the population snapshot file failed.");
+        }
+
+        std::swap(mFillSnapshot, mWriteSnapshot);
+        mHasPendingSnapshot = true;
+    }
+    mCondition.notify_all();
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::RunWriter()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this]{ return mHasPendingSnapshot || mStopWriter; });
+        if (!mHasPendingSnapshot)
+        {
+            break;
+        }
+
+        // The simulation thread does not touch mWriteSnapshot while a snapshot is pending
+        lock.unlock();
+        const bool written = WriteSnapshot(mWriteSnapshot);
+        lock.lock();
+
+        mWriteFailed = mWriteFailed || !written;
+        mHasPendingSnapshot = false;
+        mCondition.notify_all();
+    }
+}
+
+template<unsigned DIM>
+bool AsyncPopulationSnapshotModifier<DIM>::WriteSnapshot(const Snapshot& rSnapshot)
+{
+    std::ostream& r_file = *mpSnapshotFile;
+
+    WriteValue<double>(r_file, rSnapshot.mTime);
+    WriteValue<std::uint32_t>(r_file, rSnapshot.mNodeLocations.size() / DIM);
+    WriteValues(r_file, rSnapshot.mNodeLocations);
+
+    WriteValue<std::uint32_t>(r_file, rSnapshot.mLocationIndices.size());
+    WriteValues(r_file, rSnapshot.mLocationIndices);
+    WriteValues(r_file, rSnapshot.mCellIds);
+    WriteValues(r_file, rSnapshot.mIsLabelled);
+    WriteValues(r_file, rSnapshot.mVolumes);
+    WriteValues(r_file, rSnapshot.mCellData);
+
+    return static_cast<bool>(r_file);
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::StartWriter()
+{
+    mStopWriter = false;
+    mWriterThread = std::thread(&AsyncPopulationSnapshotModifier<DIM>::RunWriter, this);
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::StopWriter()
+{
+    if (!mWriterThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopWriter = true;
+    }
+    mCondition.notify_all();
+    mWriterThread.join();
+
+    if (mpSnapshotFile)
+    {
+        mpSnapshotFile->flush();
+        mWriteFailed = mWriteFailed || !*mpSnapshotFile;
+    }
+}
+
+template<unsigned DIM>
+unsigned AsyncPopulationSnapshotModifier<DIM>::GetSamplingInterval() const noexcept
+{
+    return mSamplingInterval;
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::SetSamplingInterval(unsigned samplingInterval)
+{
+    if (samplingInterval == 0u)
+    {
+        EXCEPTION("The sampling interval must be at least 1.");
+    }
+    mSamplingInterval = samplingInterval;
+}
+
+template<unsigned DIM>
+const std::vector<std::string>& AsyncPopulationSnapshotModifier<DIM>::rGetCellDataItems() const noexcept
+{
+    return mCellDataItems;
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::SetCellDataItems(const std::vector<std::string>& rCellDataItems)
+{
+    if (mpSnapshotFile)
+    {
+        EXCEPTION("The cell data items cannot be changed once a snapshot file has been started.");
+    }
+    mCellDataItems = rCellDataItems;
+}
+
+template<unsigned DIM>
+void AsyncPopulationSnapshotModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<SamplingInterval>" << mSamplingInterval << "</SamplingInterval>\n";
+
+    *rParamsFile << "\t\t\t<CellDataItems>";
+    for (unsigned item_idx = 0; item_idx < mCellDataItems.size(); ++item_idx)
+    {
+        *rParamsFile << (item_idx == 0 ? "" : ",") << mCellDataItems[item_idx];
+    }
+    *rParamsFile << "</CellDataItems>\n";
+
+    // Next, call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class AsyncPopulationSnapshotModifier<1>;
+template class AsyncPopulationSnapshotModifier<2>;
+template class AsyncPopulationSnapshotModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(AsyncPopulationSnapshotModifier)
@@ -0,0 +1,242 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef ASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_
+#define ASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include "ChasteSerialization.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "OutputFileHandler.hpp"
+
+/**
+ * A modifier class that records a compact snapshot of the population at regular intervals, appending it to a single
+ * binary file, populationsnapshots.bin, in the simulation output directory.  It is intended to replace high frequency
+ * text output from the cell and population writers in studies that only need positions, labels and a few scalars.
+ *
+ * The simulation thread only copies the snapshot into one of two buffers; a background thread writes the other, so
+ * stepping only waits for output if a snapshot is taken before the previous one has finished being written.
+ *
+ * All values are written in native byte order.  The file starts with the header
+ *   char[8] "POPSNAP1"; uint32 DIM; uint32 number of cell data items; then for each item uint32 length, char[length] name
+ * and each snapshot is then written as
+ *   double time; uint32 number of nodes; double[nodes*DIM] node locations;
+ *   uint32 number of cells; uint32[cells] location indices; uint32[cells] cell ids; uint8[cells] whether labelled;
+ *   double[cells] cell volumes; double[cells*items] cell data items, cell by cell.
+ */
+template<unsigned DIM>
+class AsyncPopulationSnapshotModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mSamplingInterval;
+        archive & mCellDataItems;
+    }
+
+    /** A snapshot of the population, reused between samples to avoid reallocation */
+    struct Snapshot
+    {
+        /** The simulation time */
+        double mTime = 0.0;
+
+        /** The node locations, node by node */
+        std::vector<double> mNodeLocations;
+
+        /** The location index of each cell */
+        std::vector<std::uint32_t> mLocationIndices;
+
+        /** The id of each cell */
+        std::vector<std::uint32_t> mCellIds;
+
+        /** Whether each cell is labelled */
+        std::vector<unsigned char> mIsLabelled;
+
+        /** The volume (area in 2D) of each cell */
+        std::vector<double> mVolumes;
+
+        /** The cell data items of each cell, cell by cell */
+        std::vector<double> mCellData;
+    };
+
+protected:
+
+    /** The number of time steps between samples */
+    unsigned mSamplingInterval = 1u;
+
+    /** The names of the cell data items recorded for each cell */
+    std::vector<std::string> mCellDataItems;
+
+    /** The simulation output directory, relative to $CHASTE_TEST_OUTPUT, of the snapshot file, or empty if none */
+    std::string mOutputDirectory;
+
+    /** The snapshot file; only used by the writer thread while it is running */
+    out_stream mpSnapshotFile;
+
+    /** The snapshot being filled by the simulation thread */
+    Snapshot mFillSnapshot;
+
+    /** The snapshot handed to the writer thread */
+    Snapshot mWriteSnapshot;
+
+    /** Guards mHasPendingSnapshot, mStopWriter and mWriteFailed */
+    std::mutex mMutex;
+
+    /** Signalled when a snapshot is handed over, when it has been written, and when the writer should stop */
+    std::condition_variable mCondition;
+
+    /** Whether mWriteSnapshot holds a snapshot not yet written */
+    bool mHasPendingSnapshot = false;
+
+    /** Whether the writer thread should stop once any pending snapshot is written */
+    bool mStopWriter = false;
+
+    /** Whether writing to the snapshot file has failed */
+    bool mWriteFailed = false;
+
+    /** The writer thread, running between SetupSolve() and UpdateAtEndOfSolve() */
+    std::thread mWriterThread;
+
+    /**
+     * Copy the current state of the population into mFillSnapshot, then hand it to the writer thread, waiting only if
+     * the previous snapshot has not been written yet.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void TakeSnapshot(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /** The body of the writer thread: write each snapshot handed over until told to stop. */
+    void RunWriter();
+
+    /**
+     * Write a snapshot to the snapshot file.
+     *
+     * @param rSnapshot the snapshot
+     * @return whether the snapshot was written successfully
+     */
+    bool WriteSnapshot(const Snapshot& rSnapshot);
+
+    /** Start the writer thread. */
+    void StartWriter();
+
+    /** Stop the writer thread, if running, once any pending snapshot is written, and flush the snapshot file. */
+    void StopWriter();
+
+public:
+
+    /** Default constructor. */
+    AsyncPopulationSnapshotModifier() = default;
+
+    /** Destructor.  Stops the writer thread, such as if a Solve() threw. */
+    virtual ~AsyncPopulationSnapshotModifier();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Specify what to do in the simulation at the end of each time step.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Open the snapshot file in the simulation output directory, start the writer thread and take a snapshot of the
+     * initial state.  If the previous Solve() had the same simulation output directory, continue its file instead,
+     * without taking a snapshot of the initial state again.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.  Wait for the remaining snapshots to be written and stop the writer.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /** @return the number of time steps between samples */
+    unsigned GetSamplingInterval() const noexcept;
+
+    /** @param samplingInterval the new number of time steps between samples; must be at least 1 */
+    void SetSamplingInterval(unsigned samplingInterval);
+
+    /** @return the names of the cell data items recorded for each cell */
+    const std::vector<std::string>& rGetCellDataItems() const noexcept;
+
+    /**
+     * Set the cell data items recorded for each cell.  Cannot be changed once a snapshot file has been started.
+     *
+     * @param rCellDataItems the names of the items, each of which every cell must have
+     */
+    void SetCellDataItems(const std::vector<std::string>& rCellDataItems);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    virtual void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(AsyncPopulationSnapshotModifier)
+
+#endif /*ASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_*/
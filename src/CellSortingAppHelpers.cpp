@@ -0,0 +1,121 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "CellSortingAppHelpers.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Exception.hpp"
+
+std::vector<double> CellSortingAppHelpers::ParseList(const std::string& rList)
+{
+    std::vector<double> values;
+    std::stringstream list_stream(rList);
+    std::string item;
+    while (std::getline(list_stream, item, ','))
+    {
+        values.emplace_back(std::stod(item));
+    }
+
+    if (values.empty())
+    {
+        EXCEPTION("Expected a comma-separated list of numbers but got '" + rList + "'.");
+    }
+    return values;
+}
+
+std::string CellSortingAppHelpers::FormatForPath(double value)
+{
+    std::ostringstream formatted;
+    formatted << value;
+    return formatted.str();
+}
+
+pid_t CellSortingAppHelpers::StartProcess(const std::function<int()>& rFunction)
+{
+    // Don't let the child inherit, and later flush a second time, anything the parent has buffered
+    std::cout.flush();
+    std::cerr.flush();
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        EXCEPTION("Could not start a simulation process.");
+    }
+    if (pid == 0)
+    {
+        int exit_status = EXIT_FAILURE;
+        try
+        {
+            exit_status = rFunction();
+        }
+        catch (const Exception& e)
+        {
+            std::cerr << e.GetMessage() << std::endl;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(exit_status);
+    }
+
+    return pid;
+}
+
+pid_t CellSortingAppHelpers::WaitForProcess(pid_t pid, int& rExitStatus, struct rusage* pUsage)
+{
+    int status = 0;
+    pid_t finished_pid = -1;
+    do
+    {
+        finished_pid = wait4(pid, &status, 0, pUsage);
+    }
+    while (finished_pid < 0 && errno == EINTR);
+
+    if (finished_pid < 0 || (pid >= 0 && finished_pid != pid))
+    {
+        EXCEPTION("Lost track of a simulation process.");
+    }
+
+    rExitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return finished_pid;
+}
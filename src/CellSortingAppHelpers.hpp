@@ -0,0 +1,88 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef CELLSORTINGAPPHELPERS_HPP_
+#define CELLSORTINGAPPHELPERS_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+/**
+ * Helpers shared by the command-line drivers of cell sorting simulations, CellSortingEnsemble and CellSortingScaling:
+ * parsing and formatting of parameter values, and running each simulation in its own forked process.
+ */
+class CellSortingAppHelpers
+{
+public:
+
+    /**
+     * @param rList a comma-separated list of numbers
+     * @return the numbers
+     */
+    static std::vector<double> ParseList(const std::string& rList);
+
+    /**
+     * @param value a parameter value
+     * @return the value formatted for a directory name
+     */
+    static std::string FormatForPath(double value);
+
+    /**
+     * Run a function in a forked child process, which exits with the status the function returns without running
+     * any exit handlers or destructors of the parent's state.  Output buffered by the parent is flushed first, so
+     * the child cannot later flush it a second time.
+     *
+     * @param rFunction the function to run in the child, returning its exit status
+     * @return the process ID of the child
+     */
+    static pid_t StartProcess(const std::function<int()>& rFunction);
+
+    /**
+     * Wait for a child process started by StartProcess() to finish.
+     *
+     * @param pid the process ID of the child, or -1 for whichever child finishes first
+     * @param rExitStatus set to the exit status of the child, or -1 if it did not exit normally
+     * @param pUsage if not null, set to the resources used by the child
+     * @return the process ID of the child that finished
+     */
+    static pid_t WaitForProcess(pid_t pid, int& rExitStatus, struct rusage* pUsage=nullptr);
+};
+
+#endif /*CELLSORTINGAPPHELPERS_HPP_*/
@@ -0,0 +1,703 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CellSortingSimulation.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/make_shared.hpp>
+
+#include "AsyncPopulationSnapshotModifier.hpp"
+#include "CellBasedSimulationArchiver.hpp"
+#include "CellId.hpp"
+#include "CellIdWriter.hpp"
+#include "CellLabel.hpp"
+#include "CellMutationStatesWriter.hpp"
+#include "CellPopulationAdjacencyMatrixWriter.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellSortingStatisticsModifier.hpp"
+#include "CellsGenerator.hpp"
+#include "ChasteMakeUnique.hpp"
+#include "CheckpointArchiveTypes.hpp"
+#include "Exception.hpp"
+#include "FileFinder.hpp"
+#include "ForwardEulerNumericalMethod.hpp"
+#include "HeterotypicBoundaryLengthWriter.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "ImmersedBoundaryMorseDifferentialAdhesionForce.hpp"
+#include "ImmersedBoundaryMorseMembraneForce.hpp"
+#include "ImmersedBoundaryNodeRenumberingModifier.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
+#include "ImmersedBoundaryProfilingModifier.hpp"
+#include "ImmersedBoundarySimulationModifier.hpp"
+#include "ImmersedBoundaryTargetAreaModifier.hpp"
+#include "NagaiHondaDifferentialAdhesionForce.hpp"
+#include "NoCellCycleModel.hpp"
+#include "OffLatticeRandomFieldForce.hpp"
+#include "OffLatticeSimulation.hpp"
+#include "OutputFileHandler.hpp"
+#include "ProfiledImmersedBoundarySimulationModifier.hpp"
+#include "ProgressReporter.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "SimulationTime.hpp"
+#include "Toroidal2dVertexMesh.hpp"
+#include "UniformGridRandomFieldGenerator.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+#include "VoronoiVertexMeshGenerator.hpp"
+
+void CellSortingSimulation::SetupSingletons(unsigned seed)
+{
+    SimulationTime::Instance()->SetStartTime(0.0);
+    RandomNumberGenerator::Instance()->Reseed(seed);
+    CellPropertyRegistry::Instance()->Clear();
+    CellId::ResetMaxCellId();
+}
+
+void CellSortingSimulation::DestroySingletons()
+{
+    SimulationTime::Destroy();
+    RandomNumberGenerator::Destroy();
+    CellPropertyRegistry::Instance()->Clear();
+}
+
+void CellSortingSimulation::RandomlyLabelCells(std::list<CellPtr>& rCells,
+                                               boost::shared_ptr<AbstractCellProperty> pLabel,
+                                               double labelledRatio)
+{
+    const unsigned num_cells = rCells.size();
+    const unsigned num_to_label = static_cast<unsigned>(std::round(num_cells * labelledRatio));
+
+    // A random permutation of the positions in rCells, the first num_to_label of which are labelled
+    std::vector<unsigned> permutation;
+    RandomNumberGenerator::Instance()->Shuffle(num_cells, permutation);
+
+    std::vector<char> is_selected(num_cells, 0);
+    for (unsigned i = 0; i < num_to_label; ++i)
+    {
+        is_selected[permutation[i]] = 1;
+    }
+
+    unsigned cell_position = 0;
+    for (const auto& p_cell : rCells)
+    {
+        if (is_selected[cell_position++])
+        {
+            p_cell->AddCellProperty(pLabel);
+        }
+    }
+}
+
+std::string CellSortingSimulation::GenerateSuitableRandomField(const std::array<double, 2>& lowerCorner,
+                                                               const std::array<double, 2>& upperCorner,
+                                                               double lengthscale)
+{
+    if (lengthscale == 0.0)
+    {
+        return "";
+    }
+
+    // Constructing the generator loads or computes its eigen-decomposition, so only do so once per field
+    static std::map<std::array<double, 5>, std::string> cached_field_names;
+    const std::array<double, 5> key = {{lowerCorner[0], lowerCorner[1], upperCorner[0], upperCorner[1], lengthscale}};
+    const auto it = cached_field_names.find(key);
+    if (it != cached_field_names.end())
+    {
+        return it->second;
+    }
+
+    const std::array<unsigned, 2> num_grid_pts = {{64u, 64u}};
+    const std::array<bool, 2> periodicity = {{true, true}};
+    const double trace_proportion = 0.8;
+
+    // Generate and cache the random field
+    UniformGridRandomFieldGenerator<2> gen(lowerCorner, upperCorner, num_grid_pts, periodicity, trace_proportion, lengthscale);
+
+    const std::string cached_field_name = gen.SaveToCache();
+    cached_field_names.emplace(key, cached_field_name);
+    return cached_field_name;
+}
+
+std::unique_ptr<VoronoiVertexMeshGenerator> CellSortingSimulation::MakeVertexMeshGenerator(
+        const CellSortingParameters& rParameters)
+{
+    return our::make_unique<VoronoiVertexMeshGenerator>(rParameters.mNumCellsAcross, rParameters.mNumCellsAcross, 5u,
+                                                        0.5 * std::sqrt(3.0));
+}
+
+std::string CellSortingSimulation::DescribeSteadyState(const CellSortingParameters& rParameters)
+{
+    std::ostringstream description;
+    description << std::setprecision(std::numeric_limits<double>::max_digits10);
+    description << "num_cells_across=" << rParameters.mNumCellsAcross << "\n"
+                << "time_to_steady_state=" << rParameters.mTimeToSteadyState << "\n"
+                << "steady_state_seed=" << rParameters.mSteadyStateSeed << "\n"
+                << "lengthscale=" << rParameters.mLengthscale << "\n"
+                << "diffusion_strength=" << rParameters.mDiffusionStrength << "\n";
+
+    switch (rParameters.mModel)
+    {
+        case CellSortingModel::IMMERSED_BOUNDARY:
+            description << "model=ib\n"
+                        << "cell_gap=" << rParameters.mCellGap << "\n"
+                        << "num_fluid_grid_points=" << rParameters.mNumFluidGridPoints << "\n"
+                        << "target_node_spacing_ratio=" << rParameters.mTargetNodeSpacingRatio << "\n"
+                        << "use_morton_ordering=" << rParameters.mUseMortonOrdering << "\n";
+            break;
+        case CellSortingModel::VERTEX:
+            description << "model=vertex\n"
+                        << "rearrangement_threshold=" << rParameters.mRearrangementThreshold << "\n";
+            break;
+    }
+
+    return description.str();
+}
+
+void CellSortingSimulation::SaveSteadyState(OffLatticeSimulation<2>& rSimulator,
+                                            const CellSortingParameters& rParameters)
+{
+    const std::string& r_archive = rParameters.mSteadyStateArchive;
+    const std::string temp_archive = r_archive + ".tmp" + std::to_string(getpid());
+
+    // The archiver saves to the output directory of the simulation, so point it at the temporary directory meanwhile
+    OutputFileHandler temp_handler(temp_archive, true);
+    rSimulator.SetOutputDirectory(temp_archive);
+    CellBasedSimulationArchiver<2, OffLatticeSimulation<2>, 2>::Save(&rSimulator);
+    rSimulator.SetOutputDirectory(rParameters.mOutputDirectory);
+
+    out_stream p_file = temp_handler.OpenOutputFile("steady_state_parameters.txt");
+    *p_file << DescribeSteadyState(rParameters);
+    p_file->close();
+
+    std::string temp_path = temp_handler.GetOutputDirectoryFullPath();
+    temp_path.erase(temp_path.find_last_not_of('/') + 1u);
+    const std::string archive_path = FileFinder(r_archive, RelativeTo::ChasteTestOutput).GetAbsolutePath();
+    if (std::rename(temp_path.c_str(), archive_path.c_str()) != 0)
+    {
+        // Renaming onto a directory that exists fails, which means another run saved the steady state first
+        FileFinder(temp_path, RelativeTo::Absolute).Remove();
+        if (!FileFinder(r_archive + "/steady_state_parameters.txt", RelativeTo::ChasteTestOutput).Exists())
+        {
+            EXCEPTION("Could not move steady state archive into place at " + archive_path + ".");
+        }
+    }
+}
+
+std::unique_ptr<OffLatticeSimulation<2>> CellSortingSimulation::LoadSteadyState(
+        const CellSortingParameters& rParameters)
+{
+    const std::string& r_archive = rParameters.mSteadyStateArchive;
+    const FileFinder parameters_file(r_archive + "/steady_state_parameters.txt", RelativeTo::ChasteTestOutput);
+    if (!parameters_file.Exists())
+    {
+        return nullptr;
+    }
+
+    // Check the archive was saved with the steady state parameters of this run, one line at a time
+    std::ifstream saved_file(parameters_file.GetAbsolutePath());
+    std::istringstream expected(DescribeSteadyState(rParameters));
+    std::string saved_line;
+    std::string expected_line;
+    while (std::getline(expected, expected_line))
+    {
+        if (!std::getline(saved_file, saved_line) || saved_line != expected_line)
+        {
+            EXCEPTION("The steady state archive " + r_archive + " was saved with " +
+                      (saved_line.empty() ? "other parameters" : saved_line) + " rather than " + expected_line + ".");
+        }
+        saved_line.clear();
+    }
+
+    // The archiver also loads the SimulationTime, and sets the archive location for the mesh files
+    using Archiver = CellBasedSimulationArchiver<2, OffLatticeSimulation<2>, 2>;
+    return std::unique_ptr<OffLatticeSimulation<2>>(Archiver::Load(r_archive, rParameters.mTimeToSteadyState));
+}
+
+void CellSortingSimulation::ResetSteadyStateVariant(OffLatticeSimulation<2>& rSimulator,
+                                                    const CellSortingParameters& rParameters)
+{
+    if (rSimulator.rGetCellPopulation().GetNumRealCells() != rParameters.mNumCellsAcross * rParameters.mNumCellsAcross)
+    {
+        EXCEPTION("The steady state archive does not have " + std::to_string(rParameters.mNumCellsAcross) +
+                  " cells across.");
+    }
+
+    RandomNumberGenerator::Instance()->Reseed(rParameters.mSeed);
+
+    switch (rParameters.mModel)
+    {
+        case CellSortingModel::IMMERSED_BOUNDARY:
+        {
+            // The neighbour distance is a property of the mesh rather than the population, so set it again
+            auto& r_population = dynamic_cast<ImmersedBoundaryCellPopulation<2>&>(rSimulator.rGetCellPopulation());
+            const double verlet_skin = rParameters.mVerletSkinMultiple * rParameters.mCellGap;
+            r_population.rGetMesh().SetNeighbourDist(r_population.GetInteractionDistance() + verlet_skin);
+
+            // Replace the main modifier in place, so that modifiers are still updated in the order they were added
+            bool found_main_modifier = false;
+            for (auto& rp_modifier : *rSimulator.GetSimulationModifiers())
+            {
+                if (boost::dynamic_pointer_cast<ImmersedBoundarySimulationModifier<2>>(rp_modifier))
+                {
+                    rp_modifier = MakeImmersedBoundaryModifier(rParameters);
+                    found_main_modifier = true;
+                }
+            }
+            if (!found_main_modifier)
+            {
+                EXCEPTION("The steady state archive has no immersed boundary simulation modifier.");
+            }
+            break;
+        }
+        case CellSortingModel::VERTEX:
+        {
+            auto& r_mesh = dynamic_cast<Toroidal2dVertexMesh&>(rSimulator.rGetCellPopulation().rGetMesh());
+            const std::array<double, 2> lower_corner = {{0.0, 0.0}};
+            const std::array<double, 2> upper_corner = {{r_mesh.GetWidth(0), r_mesh.GetWidth(1)}};
+
+            bool found_random_force = false;
+            for (const auto& rp_force : rSimulator.rGetForceCollection())
+            {
+                if (auto p_random_force = boost::dynamic_pointer_cast<OffLatticeRandomFieldForce<2>>(rp_force))
+                {
+                    p_random_force->SetDiffusionStrength(rParameters.mDiffusionStrength);
+                    p_random_force->SetUpRandomFieldGenerator(
+                            GenerateSuitableRandomField(lower_corner, upper_corner, rParameters.mLengthscale));
+
+                    // Any counter-based noise then follows the new seed, like the noise drawn node by node
+                    p_random_force->ResetCounterBasedNoise();
+                    found_random_force = true;
+                }
+            }
+            if (!found_random_force)
+            {
+                EXCEPTION("The steady state archive has no random field force.");
+            }
+            break;
+        }
+    }
+}
+
+void CellSortingSimulation::RunFromSteadyState(OffLatticeSimulation<2>& rSimulator,
+                                               const CellSortingParameters& rParameters,
+                                               CellSortingRunStatistics& rStatistics)
+{
+    using clock = std::chrono::steady_clock;
+    const bool is_ib = rParameters.mModel == CellSortingModel::IMMERSED_BOUNDARY;
+
+    // Now label some cells
+    boost::shared_ptr<AbstractCellProperty> p_state(CellPropertyRegistry::Instance()->Get<CellLabel>());
+    RandomlyLabelCells(rSimulator.rGetCellPopulation().rGetCells(), p_state, 0.5);
+
+    /*
+     * Add the full text dumps of vertex runs here, so a run resuming from an archive writes them as it asks.  The
+     * population snapshots record the id and label of every cell, so the per-cell writers are left out with them.
+     */
+    if (!is_ib && rParameters.mWriteVertexTextOutput)
+    {
+        AbstractCellPopulation<2>& r_population = rSimulator.rGetCellPopulation();
+        if (rParameters.mSnapshotSamplingInterval == 0u && !r_population.HasWriter<CellIdWriter>())
+        {
+            r_population.AddCellWriter<CellIdWriter>();
+        }
+        if (rParameters.mSnapshotSamplingInterval == 0u && !r_population.HasWriter<CellMutationStatesWriter>())
+        {
+            r_population.AddCellWriter<CellMutationStatesWriter>();
+        }
+        if (!r_population.HasWriter<CellPopulationAdjacencyMatrixWriter>())
+        {
+            r_population.AddPopulationWriter<CellPopulationAdjacencyMatrixWriter>();
+        }
+    }
+
+    if (rParameters.mSnapshotSamplingInterval > 0u)
+    {
+        auto p_snapshot_modifier = boost::make_shared<AsyncPopulationSnapshotModifier<2>>();
+        p_snapshot_modifier->SetSamplingInterval(rParameters.mSnapshotSamplingInterval);
+        rSimulator.AddSimulationModifier(p_snapshot_modifier);
+    }
+
+    // Sample the sorting statistics as often as the results
+    const unsigned sampling_timestep_multiple = is_ib ? 125u : 200u;
+    auto p_statistics_modifier = boost::make_shared<CellSortingStatisticsModifier<2>>();
+    p_statistics_modifier->SetSamplingInterval(sampling_timestep_multiple);
+    rSimulator.AddSimulationModifier(p_statistics_modifier);
+
+    // Run simulation
+    rSimulator.SetSamplingTimestepMultiple(sampling_timestep_multiple);
+    rSimulator.SetEndTime(rParameters.mTimeToSteadyState + rParameters.mTimeForSimulation);
+
+    if (rParameters.mReportProgressToConsole)
+    {
+        ProgressReporter& r_progress = rSimulator.rSetUpAndGetProgressReporter();
+        r_progress.SetOutputToConsole(true);
+    }
+
+    const double simulation_start_time = SimulationTime::Instance()->GetTime();
+    const clock::time_point simulation_start = clock::now();
+    rSimulator.Solve();
+
+    // The time stepper is reset at each solve, so count steps from the elapsed simulation time
+    rStatistics.mNumSimulationTimeSteps = static_cast<unsigned>(std::lround(
+            (SimulationTime::Instance()->GetTime() - simulation_start_time) / GetTimeStep(rParameters.mModel)));
+    rStatistics.mSimulationSolveSeconds = std::chrono::duration<double>(clock::now() - simulation_start).count();
+    rStatistics.mNumNodes = rSimulator.rGetCellPopulation().GetNumNodes();
+
+    if (rSimulator.rGetCellPopulation().GetNumRealCells() != rParameters.mNumCellsAcross * rParameters.mNumCellsAcross)
+    {
+        EXCEPTION("Cells were lost during the simulation.");
+    }
+}
+
+boost::shared_ptr<ImmersedBoundarySimulationModifier<2>> CellSortingSimulation::MakeImmersedBoundaryModifier(
+        const CellSortingParameters& rParameters)
+{
+    const double interaction_dist_multiple = 2.0;
+    const double verlet_skin = rParameters.mVerletSkinMultiple * rParameters.mCellGap;
+
+    // Add main immersed boundary simulation modifier and random noise, timing its update on its own if built with
+    // profiling
+    boost::shared_ptr<ImmersedBoundarySimulationModifier<2>> p_main_modifier;
+    if (ImmersedBoundaryProfiler::IsEnabled())
+    {
+        p_main_modifier = boost::make_shared<ProfiledImmersedBoundarySimulationModifier<2>>();
+    }
+    else
+    {
+        p_main_modifier = boost::make_shared<ImmersedBoundarySimulationModifier<2>>();
+    }
+    p_main_modifier->SetNoiseLengthScale(rParameters.mLengthscale);
+    p_main_modifier->SetNoiseSkip(2u);
+    p_main_modifier->SetNoiseStrength(rParameters.mDiffusionStrength);
+    p_main_modifier->SetAdditiveNormalNoise(true);
+
+    // Add force laws
+    auto p_boundary_force = boost::make_shared<ImmersedBoundaryMorseMembraneForce<2>>();
+    p_main_modifier->AddImmersedBoundaryForce(p_boundary_force);
+    p_boundary_force->SetElementWellDepth(1.5 * 1e7);
+
+    const double basic_strength = 1.2 * 1e5;
+    auto p_cell_cell_force = boost::make_shared<ImmersedBoundaryMorseDifferentialAdhesionForce<2>>();
+    p_main_modifier->AddImmersedBoundaryForce(p_cell_cell_force);
+    p_cell_cell_force->SetRepulsionWellDepth(10.0 * basic_strength);
+    p_cell_cell_force->SetAdhesionAtoAWellDepth(basic_strength);
+    p_cell_cell_force->SetAdhesionAtoBWellDepth(0.25 * basic_strength);
+    p_cell_cell_force->SetAdhesionBtoBWellDepth(basic_strength);
+    p_cell_cell_force->SetRestLength(0.5 * 1.0 / interaction_dist_multiple);
+    p_cell_cell_force->SetVerletSkin(verlet_skin);
+    p_cell_cell_force->SetUseDeviceOffload(rParameters.mUseDeviceOffload);
+
+    return p_main_modifier;
+}
+
+CellSortingRunStatistics CellSortingSimulation::RunImmersedBoundary(const CellSortingParameters& rParameters)
+{
+    using clock = std::chrono::steady_clock;
+    const clock::time_point setup_start = clock::now();
+    CellSortingRunStatistics statistics;
+
+    // Resume from a steady state saved by an earlier run, if there is one
+    const bool has_archive = !rParameters.mSteadyStateArchive.empty();
+    std::unique_ptr<OffLatticeSimulation<2>> p_simulator = has_archive ? LoadSteadyState(rParameters) : nullptr;
+    if (p_simulator)
+    {
+        p_simulator->SetOutputDirectory(rParameters.mOutputDirectory);
+        ResetSteadyStateVariant(*p_simulator, rParameters);
+        statistics.mSetupSeconds = std::chrono::duration<double>(clock::now() - setup_start).count();
+
+        RunFromSteadyState(*p_simulator, rParameters, statistics);
+        return statistics;
+    }
+
+    // Create a simple 2D Immersed Boundary mesh
+    const double dist_between_cells = rParameters.mCellGap;
+    const double interaction_dist_multiple = 2.0;
+
+    VoronoiImmersedBoundaryMeshGenerator generator(rParameters.mNumCellsAcross, rParameters.mNumCellsAcross, 20u,
+                                                   rParameters.mNumFluidGridPoints, 1.0, dist_between_cells,
+                                                   rParameters.mTargetNodeSpacingRatio, 1u, false,
+                                                   rParameters.mUseMortonOrdering);
+
+    ImmersedBoundaryMesh<2,2>* p_mesh = generator.GetMesh();
+
+    // Set up cells, one for each element
+    std::vector<CellPtr> cells;
+    CellsGenerator<NoCellCycleModel, 2> cells_generator;
+    cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+    // Create cell population
+    ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+    cell_population.SetIfPopulationHasActiveSources(true);
+    cell_population.SetReMeshFrequency(50u);
+    cell_population.SetInteractionDistance(interaction_dist_multiple * dist_between_cells);
+
+    // Set the neighbour distance to the cell population interaction distance, plus any Verlet skin
+    const double verlet_skin = rParameters.mVerletSkinMultiple * dist_between_cells;
+    p_mesh->SetNeighbourDist(cell_population.GetInteractionDistance() + verlet_skin);
+
+    // Set population to output all data to results files
+    cell_population.AddPopulationWriter<HeterotypicBoundaryLengthWriter>();
+
+    // Set up cell-based simulation and output directory
+    OffLatticeSimulation<2> simulator(cell_population);
+    simulator.SetNumericalMethod(boost::make_shared<ForwardEulerNumericalMethod<2, 2>>());
+    simulator.GetNumericalMethod()->SetUseUpdateNodeLocation(true);
+
+    std::vector<double> vols;
+    for (const auto& p_cell : cell_population.rGetCells())
+    {
+        vols.push_back(cell_population.GetVolumeOfCell(p_cell));
+    }
+
+    auto p_area_modifier = boost::make_shared<ImmersedBoundaryTargetAreaModifier<2>>();
+    const double vol_mean = std::accumulate(vols.begin(), vols.end(), 0.0) / vols.size();
+    p_area_modifier->SetMinTargetArea(0.5 * vol_mean);
+    p_area_modifier->SetMaxTargetArea(1.5 * vol_mean);
+    simulator.AddSimulationModifier(p_area_modifier);
+
+    // Write a timing summary alongside the results, if built with profiling
+    if (ImmersedBoundaryProfiler::IsEnabled())
+    {
+        simulator.AddSimulationModifier(boost::make_shared<ImmersedBoundaryProfilingModifier<2>>());
+    }
+
+    if (rParameters.mUseMortonOrdering)
+    {
+        simulator.AddSimulationModifier(boost::make_shared<ImmersedBoundaryNodeRenumberingModifier<2>>());
+    }
+
+    // Add main immersed boundary simulation modifier, with its forces and random noise
+    simulator.AddSimulationModifier(MakeImmersedBoundaryModifier(rParameters));
+
+    simulator.SetOutputDirectory(rParameters.mOutputDirectory);
+
+    // Set time step and end time for simulation
+    simulator.SetDt(GetTimeStep(CellSortingModel::IMMERSED_BOUNDARY));
+    simulator.SetSamplingTimestepMultiple(UINT_MAX);
+    simulator.SetEndTime(rParameters.mTimeToSteadyState);
+
+    // Run simulation
+    const clock::time_point steady_state_start = clock::now();
+    statistics.mSetupSeconds = std::chrono::duration<double>(steady_state_start - setup_start).count();
+    simulator.Solve();
+    statistics.mSteadyStateSolveSeconds = std::chrono::duration<double>(clock::now() - steady_state_start).count();
+
+    if (has_archive)
+    {
+        SaveSteadyState(simulator, rParameters);
+        ResetSteadyStateVariant(simulator, rParameters);
+    }
+
+    RunFromSteadyState(simulator, rParameters, statistics);
+    return statistics;
+}
+
+CellSortingRunStatistics CellSortingSimulation::RunVertex(const CellSortingParameters& rParameters)
+{
+    using clock = std::chrono::steady_clock;
+    const clock::time_point setup_start = clock::now();
+    CellSortingRunStatistics statistics;
+
+    // Resume from a steady state saved by an earlier run, if there is one
+    const bool has_archive = !rParameters.mSteadyStateArchive.empty();
+    std::unique_ptr<OffLatticeSimulation<2>> p_simulator = has_archive ? LoadSteadyState(rParameters) : nullptr;
+    if (p_simulator)
+    {
+        p_simulator->SetOutputDirectory(rParameters.mOutputDirectory);
+        ResetSteadyStateVariant(*p_simulator, rParameters);
+        statistics.mSetupSeconds = std::chrono::duration<double>(clock::now() - setup_start).count();
+
+        RunFromSteadyState(*p_simulator, rParameters, statistics);
+        return statistics;
+    }
+
+    // Create a simple periodic 2D MutableVertexMesh
+    std::unique_ptr<VoronoiVertexMeshGenerator> p_generator = MakeVertexMeshGenerator(rParameters);
+
+    Toroidal2dVertexMesh* p_mesh = p_generator->GetToroidalMesh();
+
+    const std::array<double, 2> lower_corner = {{0.0, 0.0}};
+    const std::array<double, 2> upper_corner = {{p_mesh->GetWidth(0), p_mesh->GetWidth(1)}};
+
+    p_mesh->SetCellRearrangementThreshold(rParameters.mRearrangementThreshold);
+
+    // Slows things down but can use a larger timestep and diffusion forces
+    p_mesh->SetCheckForInternalIntersections(false);
+
+    // Set up cells, one for each VertexElement, with a target area rather than a growth modifier
+    std::vector<CellPtr> cells;
+    CellsGenerator<NoCellCycleModel, 2> cells_generator;
+    cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+    for (const auto& p_cell : cells)
+    {
+        p_cell->GetCellData()->SetItem("target area", 1.0);
+    }
+
+    // Create cell population
+    VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+    // Set population to output the boundary length to results files; the full text dumps follow the steady state
+    cell_population.AddPopulationWriter<HeterotypicBoundaryLengthWriter>();
+
+    // Set up cell-based simulation and output directory
+    OffLatticeSimulation<2> simulator(cell_population);
+    simulator.SetOutputDirectory(rParameters.mOutputDirectory);
+
+    // Set time step and end time for simulation
+    simulator.SetDt(GetTimeStep(CellSortingModel::VERTEX));
+    simulator.SetSamplingTimestepMultiple(UINT_MAX);
+    simulator.SetEndTime(rParameters.mTimeToSteadyState);
+
+    // Set up force law and pass it to the simulation
+    auto p_force = boost::make_shared<NagaiHondaDifferentialAdhesionForce<2>>();
+    p_force->SetNagaiHondaDeformationEnergyParameter(50.0);
+    p_force->SetNagaiHondaMembraneSurfaceEnergyParameter(1.0);
+    p_force->SetNagaiHondaCellCellAdhesionEnergyParameter(1.0);
+    p_force->SetNagaiHondaLabelledCellCellAdhesionEnergyParameter(2.0);
+    p_force->SetNagaiHondaLabelledCellLabelledCellAdhesionEnergyParameter(1.0);
+    p_force->SetNagaiHondaCellBoundaryAdhesionEnergyParameter(10.0);
+    p_force->SetNagaiHondaLabelledCellBoundaryAdhesionEnergyParameter(20.0);
+    simulator.AddForce(p_force);
+
+    // Add some noise to avoid local minimum
+    auto p_random_force = boost::make_shared<OffLatticeRandomFieldForce<2>>();
+    p_random_force->SetDiffusionStrength(rParameters.mDiffusionStrength);
+    p_random_force->SetUpRandomFieldGenerator(GenerateSuitableRandomField(lower_corner, upper_corner, rParameters.mLengthscale));
+    simulator.AddForce(p_random_force);
+
+    // Run simulation
+    const clock::time_point steady_state_start = clock::now();
+    statistics.mSetupSeconds = std::chrono::duration<double>(steady_state_start - setup_start).count();
+    simulator.Solve();
+    statistics.mSteadyStateSolveSeconds = std::chrono::duration<double>(clock::now() - steady_state_start).count();
+
+    if (has_archive)
+    {
+        SaveSteadyState(simulator, rParameters);
+        ResetSteadyStateVariant(simulator, rParameters);
+    }
+
+    RunFromSteadyState(simulator, rParameters, statistics);
+    return statistics;
+}
+
+CellSortingRunStatistics CellSortingSimulation::Run(const CellSortingParameters& rParameters)
+{
+    // With a steady state archive, the steady state follows its own seed, and ResetSteadyStateVariant() reseeds
+    SetupSingletons(rParameters.mSteadyStateArchive.empty() ? rParameters.mSeed : rParameters.mSteadyStateSeed);
+
+    CellSortingRunStatistics statistics;
+    try
+    {
+        switch (rParameters.mModel)
+        {
+            case CellSortingModel::IMMERSED_BOUNDARY:
+                statistics = RunImmersedBoundary(rParameters);
+                break;
+            case CellSortingModel::VERTEX:
+                statistics = RunVertex(rParameters);
+                break;
+        }
+    }
+    catch (const Exception&)
+    {
+        DestroySingletons();
+        throw;
+    }
+
+    DestroySingletons();
+
+    return statistics;
+}
+
+double CellSortingSimulation::GetTimeStep(CellSortingModel model)
+{
+    switch (model)
+    {
+        case CellSortingModel::IMMERSED_BOUNDARY:
+            return 1.0 / 30.0;
+        case CellSortingModel::VERTEX:
+            return 1.0 / 100.0;
+    }
+
+    EXCEPTION("Unknown cell sorting model.");
+}
+
+void CellSortingSimulation::PreloadRandomField(const CellSortingParameters& rParameters)
+{
+    // Only the vertex model takes its noise from an OffLatticeRandomFieldForce
+    if (rParameters.mModel != CellSortingModel::VERTEX || rParameters.mLengthscale == 0.0)
+    {
+        return;
+    }
+
+    // With a steady state archive, the steady state follows its own seed, and ResetSteadyStateVariant() reseeds
+    SetupSingletons(rParameters.mSteadyStateArchive.empty() ? rParameters.mSeed : rParameters.mSteadyStateSeed);
+
+    try
+    {
+        // The field covers the mesh, so generate the mesh as RunVertex() does to find its size
+        std::unique_ptr<VoronoiVertexMeshGenerator> p_generator = MakeVertexMeshGenerator(rParameters);
+        Toroidal2dVertexMesh* p_mesh = p_generator->GetToroidalMesh();
+
+        const std::array<double, 2> lower_corner = {{0.0, 0.0}};
+        const std::array<double, 2> upper_corner = {{p_mesh->GetWidth(0), p_mesh->GetWidth(1)}};
+        OffLatticeRandomFieldForce<2>::GetSharedRandomFieldGenerator(
+                GenerateSuitableRandomField(lower_corner, upper_corner, rParameters.mLengthscale));
+    }
+    catch (const Exception&)
+    {
+        DestroySingletons();
+        throw;
+    }
+
+    DestroySingletons();
+}
@@ -0,0 +1,308 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CELLSORTINGSIMULATION_HPP_
+#define CELLSORTINGSIMULATION_HPP_
+
+#include <array>
+#include <list>
+#include <memory>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Cell.hpp"
+#include "OffLatticeSimulation.hpp"
+
+template<unsigned DIM> class ImmersedBoundarySimulationModifier;
+class VoronoiVertexMeshGenerator;
+
+/** The cell-based model used for a cell sorting simulation */
+enum class CellSortingModel
+{
+    IMMERSED_BOUNDARY,
+    VERTEX
+};
+
+/**
+ * The parameters of a single cell sorting simulation.  The defaults are those of the immersed boundary noise
+ * lengthscale sweeps.
+ */
+struct CellSortingParameters
+{
+    /** The cell-based model */
+    CellSortingModel mModel = CellSortingModel::IMMERSED_BOUNDARY;
+
+    /** The output directory, relative to $CHASTE_TEST_OUTPUT */
+    std::string mOutputDirectory = "VertexIbComp/CellSorting/Ensemble";
+
+    /** The lengthscale of the random field; zero for uncorrelated noise */
+    double mLengthscale = 0.03;
+
+    /** The strength of the random noise */
+    double mDiffusionStrength = 5.0 * 1e8;
+
+    /** The absolute gap between cells; immersed boundary only */
+    double mCellGap = 0.03;
+
+    /** The number of fluid grid points in each direction; immersed boundary only */
+    unsigned mNumFluidGridPoints = 128u;
+
+    /** The target ratio of node spacing to fluid grid spacing; immersed boundary only */
+    double mTargetNodeSpacingRatio = 0.5;
+
+    /** The Verlet skin of the cell-cell force, as a multiple of the cell gap, or zero for none; immersed boundary only */
+    double mVerletSkinMultiple = 0.0;
+
+    /** Whether to number nodes along a Morton curve when generated and after each remesh; immersed boundary only */
+    bool mUseMortonOrdering = false;
+
+    /**
+     * Whether to evaluate the cell-cell force on the OpenMP target device; immersed boundary only, and needs a
+     * positive mVerletSkinMultiple
+     */
+    bool mUseDeviceOffload = false;
+
+    /** The cell rearrangement threshold; vertex only */
+    double mRearrangementThreshold = 0.01;
+
+    /**
+     * Whether to write the id and mutation state of every cell, and the adjacency matrix of the population, with the
+     * results after cells are labelled; vertex only.  These full text dumps dominate the output of long runs.
+     */
+    bool mWriteVertexTextOutput = true;
+
+    /** The number of cells across the square tissue */
+    unsigned mNumCellsAcross = 6u;
+
+    /** The time simulated before cells are labelled */
+    double mTimeToSteadyState = 10.0;
+
+    /** The time simulated after cells are labelled */
+    double mTimeForSimulation = 250.0;
+
+    /** The seed for the RandomNumberGenerator */
+    unsigned mSeed = 0u;
+
+    /**
+     * The number of time steps between compact binary snapshots of the population after cells are labelled, written
+     * in the background by AsyncPopulationSnapshotModifier, or zero for none.  The snapshots replace the id and
+     * mutation state of every cell otherwise written by vertex runs.
+     */
+    unsigned mSnapshotSamplingInterval = 0u;
+
+    /** Whether to report the progress of the simulation after cells are labelled to the console */
+    bool mReportProgressToConsole = false;
+
+    /**
+     * A directory, relative to $CHASTE_TEST_OUTPUT, holding an archive of the simulation at steady state, or empty to
+     * always simulate the time to steady state.  If the archive exists the run resumes from it instead, and otherwise
+     * the run saves its steady state to it.  The archive records the parameters that determine the steady state
+     * (the model, mNumCellsAcross, mTimeToSteadyState, mSteadyStateSeed, the noise, and mCellGap, mNumFluidGridPoints,
+     * mTargetNodeSpacingRatio and mUseMortonOrdering or mRearrangementThreshold), and resuming from an archive saved
+     * with other values of these throws.  At steady state the RandomNumberGenerator is reseeded with mSeed, so runs
+     * resuming from one archive differ in labelling and noise, and a run repeats exactly whether it saves the archive
+     * or resumes from it.
+     */
+    std::string mSteadyStateArchive;
+
+    /** The seed for the RandomNumberGenerator up to steady state; only used with mSteadyStateArchive */
+    unsigned mSteadyStateSeed = 0u;
+};
+
+/** Timings of a single cell sorting simulation, for throughput measurements */
+struct CellSortingRunStatistics
+{
+    /** The wall time, in seconds, to generate the mesh and set up the simulation */
+    double mSetupSeconds = 0.0;
+
+    /** The wall time, in seconds, of the solve before cells are labelled */
+    double mSteadyStateSolveSeconds = 0.0;
+
+    /** The wall time, in seconds, of the solve after cells are labelled */
+    double mSimulationSolveSeconds = 0.0;
+
+    /** The number of time steps in the solve after cells are labelled */
+    unsigned mNumSimulationTimeSteps = 0u;
+
+    /** The number of nodes in the cell population */
+    unsigned mNumNodes = 0u;
+};
+
+/**
+ * Run the cell sorting simulations of the noise lengthscale sweeps, as in TestIbSortingWithNoiseLengthscales and
+ * TestVertexSortingWithNoiseLengthscales, so the same simulation can be driven from a test or an ensemble runner.
+ * After cells are labelled, each run also writes sortingstatistics.csv, with CellSortingStatisticsModifier, as often
+ * as its results.
+ *
+ * Each run sets up and destroys the SimulationTime, RandomNumberGenerator and CellPropertyRegistry singletons, so
+ * runs can follow one another in a single process, but not run concurrently in it.
+ */
+class CellSortingSimulation
+{
+private:
+
+    /**
+     * Reset singletons, as the test suite would, before a run.
+     *
+     * @param seed the seed for the RandomNumberGenerator
+     */
+    static void SetupSingletons(unsigned seed);
+
+    /** Destroy singletons, as the test suite would, after a run. */
+    static void DestroySingletons();
+
+    /**
+     * Label a given proportion of cells, chosen using the RandomNumberGenerator so the choice follows the seed.
+     *
+     * @param rCells the list of cells to randomly label
+     * @param pLabel the label to give to selected cells
+     * @param labelledRatio the target fraction of cells to label
+     */
+    static void RandomlyLabelCells(std::list<CellPtr>& rCells,
+                                   boost::shared_ptr<AbstractCellProperty> pLabel,
+                                   double labelledRatio);
+
+    /**
+     * Generate and cache a random field on a square domain.
+     *
+     * @param lowerCorner the lower corner of the mesh
+     * @param upperCorner the upper corner of the mesh
+     * @param lengthscale the correlation length for the random field
+     * @return the path to the cached random field, or an empty string for zero lengthscale
+     */
+    static std::string GenerateSuitableRandomField(const std::array<double, 2>& lowerCorner,
+                                                   const std::array<double, 2>& upperCorner,
+                                                   double lengthscale);
+
+    /**
+     * @param rParameters the parameters of a vertex simulation
+     * @return the generator of the periodic vertex mesh
+     */
+    static std::unique_ptr<VoronoiVertexMeshGenerator> MakeVertexMeshGenerator(const CellSortingParameters& rParameters);
+
+    /**
+     * @param rParameters the parameters of an immersed boundary simulation
+     * @return the main immersed boundary modifier, with its forces and noise
+     */
+    static boost::shared_ptr<ImmersedBoundarySimulationModifier<2>> MakeImmersedBoundaryModifier(
+            const CellSortingParameters& rParameters);
+
+    /**
+     * @param rParameters the parameters of a simulation with a steady state archive
+     * @return the parameters that determine its steady state, one per line, as recorded in the archive
+     */
+    static std::string DescribeSteadyState(const CellSortingParameters& rParameters);
+
+    /**
+     * Save a simulation at steady state with CellBasedSimulationArchiver, along with the parameters that determine
+     * its steady state, to CellSortingParameters::mSteadyStateArchive.  The archive is saved to a directory of this
+     * process's own and renamed into place, so that simultaneous runs never see a partially-saved archive; if another
+     * run has saved the same steady state first, its archive is kept.
+     *
+     * @param rSimulator the simulation
+     * @param rParameters the parameters of the simulation
+     */
+    static void SaveSteadyState(OffLatticeSimulation<2>& rSimulator, const CellSortingParameters& rParameters);
+
+    /**
+     * Load a simulation, and the SimulationTime, from an archive saved by SaveSteadyState(), having checked that it
+     * was saved with the steady state parameters of this simulation.
+     *
+     * @param rParameters the parameters of the simulation
+     * @return the simulation, which owns its cell population, or nullptr if the archive has not been saved
+     */
+    static std::unique_ptr<OffLatticeSimulation<2>> LoadSteadyState(const CellSortingParameters& rParameters);
+
+    /**
+     * With a steady state archive, reseed the RandomNumberGenerator with the seed of this run and set up the noise
+     * again, including the key of any counter-based noise.  The immersed boundary modifier is replaced by a new one,
+     * so its forces and noise need not be archived.
+     *
+     * @param rSimulator the simulation, at steady state
+     * @param rParameters the parameters of the simulation
+     */
+    static void ResetSteadyStateVariant(OffLatticeSimulation<2>& rSimulator, const CellSortingParameters& rParameters);
+
+    /**
+     * Label cells and simulate from steady state to the end of the simulation.
+     *
+     * @param rSimulator the simulation, at steady state
+     * @param rParameters the parameters of the simulation
+     * @param rStatistics the timings of the simulation, to which those of this stage are added
+     */
+    static void RunFromSteadyState(OffLatticeSimulation<2>& rSimulator,
+                                   const CellSortingParameters& rParameters,
+                                   CellSortingRunStatistics& rStatistics);
+
+    /**
+     * @param rParameters the parameters of the immersed boundary simulation to run
+     * @return the timings of the simulation
+     */
+    static CellSortingRunStatistics RunImmersedBoundary(const CellSortingParameters& rParameters);
+
+    /**
+     * @param rParameters the parameters of the vertex simulation to run
+     * @return the timings of the simulation
+     */
+    static CellSortingRunStatistics RunVertex(const CellSortingParameters& rParameters);
+
+public:
+
+    /**
+     * Run one cell sorting simulation.
+     *
+     * @param rParameters the parameters of the simulation
+     * @return the timings of the simulation
+     */
+    static CellSortingRunStatistics Run(const CellSortingParameters& rParameters);
+
+    /**
+     * @param model a cell-based model
+     * @return the time step used in simulations of the model
+     */
+    static double GetTimeStep(CellSortingModel model);
+
+    /**
+     * Load the random field of a simulation into this process, so that simulations run in processes forked from it
+     * afterwards share the one copy rather than each loading their own.  Only vertex simulations with correlated
+     * noise use a random field; for others this does nothing.
+     *
+     * @param rParameters the parameters of the simulation
+     */
+    static void PreloadRandomField(const CellSortingParameters& rParameters);
+};
+
+#endif /*CELLSORTINGSIMULATION_HPP_*/
@@ -0,0 +1,196 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CellSortingStatisticsModifier.hpp"
+
+#include "CellLabel.hpp"
+#include "Exception.hpp"
+#include "SimulationOutputDirectory.hpp"
+#include "SimulationTime.hpp"
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (SimulationTime::Instance()->GetTimeStepsElapsed() % mSamplingInterval == 0u)
+    {
+        WriteStatistics(rCellPopulation);
+    }
+}
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    // A simulation that is solved in stages, such as to label cells after reaching steady state, continues one file
+    const std::string simulation_directory = GetSimulationOutputDirectory(outputDirectory);
+    const bool continuing = mpStatisticsFile && simulation_directory == mOutputDirectory;
+    if (continuing)
+    {
+        // This stage starts from the final state of the last, so sampling it could repeat the last stage's final row
+        return;
+    }
+
+    OutputFileHandler output_file_handler(simulation_directory, false);
+    mpStatisticsFile = output_file_handler.OpenOutputFile("sortingstatistics.csv");
+    mOutputDirectory = simulation_directory;
+
+    *mpStatisticsFile << "time,num_cells,num_labelled_cells,num_neighbour_pairs,num_heterotypic_pairs,"
+                      << "heterotypic_pair_fraction,mean_homotypic_neighbour_fraction\n";
+
+    WriteStatistics(rCellPopulation);
+}
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mpStatisticsFile)
+    {
+        mpStatisticsFile->flush();
+    }
+}
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::WriteStatistics(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    // First record which location indices have cells, and which of those are labelled
+    mHasCell.clear();
+    mIsLabelled.clear();
+
+    unsigned num_cells = 0u;
+    unsigned num_labelled_cells = 0u;
+    for (const auto& p_cell : rCellPopulation.rGetCells())
+    {
+        if (p_cell->IsDead())
+        {
+            continue;
+        }
+
+        const unsigned location_idx = rCellPopulation.GetLocationIndexUsingCell(p_cell);
+        if (location_idx >= mHasCell.size())
+        {
+            mHasCell.resize(location_idx + 1u, 0);
+            mIsLabelled.resize(location_idx + 1u, 0);
+        }
+
+        const bool is_labelled = p_cell->template HasCellProperty<CellLabel>();
+        mHasCell[location_idx] = 1;
+        mIsLabelled[location_idx] = is_labelled;
+
+        ++num_cells;
+        num_labelled_cells += is_labelled;
+    }
+
+    // Then count each neighbouring pair once, from the cell with the lower location index
+    unsigned num_pairs = 0u;
+    unsigned num_heterotypic_pairs = 0u;
+    double sum_homotypic_fractions = 0.0;
+    unsigned num_cells_with_neighbours = 0u;
+    for (const auto& p_cell : rCellPopulation.rGetCells())
+    {
+        if (p_cell->IsDead())
+        {
+            continue;
+        }
+
+        const unsigned location_idx = rCellPopulation.GetLocationIndexUsingCell(p_cell);
+        const bool is_labelled = mIsLabelled[location_idx] != 0;
+
+        unsigned num_neighbours = 0u;
+        unsigned num_homotypic_neighbours = 0u;
+        for (const unsigned neighbour_idx : rCellPopulation.GetNeighbouringLocationIndices(p_cell))
+        {
+            if (neighbour_idx >= mHasCell.size() || !mHasCell[neighbour_idx])
+            {
+                continue;
+            }
+
+            const bool is_heterotypic = is_labelled != (mIsLabelled[neighbour_idx] != 0);
+            ++num_neighbours;
+            num_homotypic_neighbours += !is_heterotypic;
+
+            if (location_idx < neighbour_idx)
+            {
+                ++num_pairs;
+                num_heterotypic_pairs += is_heterotypic;
+            }
+        }
+
+        if (num_neighbours > 0u)
+        {
+            sum_homotypic_fractions += static_cast<double>(num_homotypic_neighbours) / num_neighbours;
+            ++num_cells_with_neighbours;
+        }
+    }
+
+    const double heterotypic_fraction = num_pairs > 0u ? static_cast<double>(num_heterotypic_pairs) / num_pairs : 0.0;
+    const double mean_homotypic_fraction = num_cells_with_neighbours > 0u ? sum_homotypic_fractions / num_cells_with_neighbours : 0.0;
+
+    *mpStatisticsFile << SimulationTime::Instance()->GetTime() << "," << num_cells << "," << num_labelled_cells << ","
+                      << num_pairs << "," << num_heterotypic_pairs << "," << heterotypic_fraction << ","
+                      << mean_homotypic_fraction << "\n";
+}
+
+template<unsigned DIM>
+unsigned CellSortingStatisticsModifier<DIM>::GetSamplingInterval() const noexcept
+{
+    return mSamplingInterval;
+}
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::SetSamplingInterval(unsigned samplingInterval)
+{
+    if (samplingInterval == 0u)
+    {
+        EXCEPTION("The sampling interval must be at least 1.");
+    }
+    mSamplingInterval = samplingInterval;
+}
+
+template<unsigned DIM>
+void CellSortingStatisticsModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<SamplingInterval>" << mSamplingInterval << "</SamplingInterval>\n";
+
+    // Next, call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class CellSortingStatisticsModifier<1>;
+template class CellSortingStatisticsModifier<2>;
+template class CellSortingStatisticsModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(CellSortingStatisticsModifier)
@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CELLSORTINGSTATISTICSMODIFIER_HPP_
+#define CELLSORTINGSTATISTICSMODIFIER_HPP_
+
+#include <boost/serialization/base_object.hpp>
+#include "ChasteSerialization.hpp"
+
+#include <string>
+#include <vector>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "OutputFileHandler.hpp"
+
+/**
+ * A modifier class that computes cell sorting statistics in-process from the neighbour structure of the population,
+ * and appends them as one CSV row per sample to sortingstatistics.csv in the simulation output directory.
+ *
+ * Each row holds the time; the numbers of cells and of labelled cells; the number of neighbouring cell pairs and how
+ * many of them are heterotypic (exactly one cell labelled); the heterotypic fraction of pairs; and the mean, over
+ * cells with any neighbours, of the fraction of neighbours sharing the cell's label.  This replaces writing the full
+ * adjacency matrix at every sample and computing the metric afterwards: CellPopulationAdjacencyMatrixWriter need only
+ * be added when the matrices themselves are wanted.
+ */
+template<unsigned DIM>
+class CellSortingStatisticsModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mSamplingInterval;
+    }
+
+protected:
+
+    /** The number of time steps between samples */
+    unsigned mSamplingInterval = 1u;
+
+    /**
+     * The simulation output directory, relative to $CHASTE_TEST_OUTPUT, of the statistics file, or empty if no file
+     * is open
+     */
+    std::string mOutputDirectory;
+
+    /** The statistics file */
+    out_stream mpStatisticsFile;
+
+    /** Whether each location index has a cell, for the current sample */
+    std::vector<char> mHasCell;
+
+    /** Whether the cell at each location index is labelled, for the current sample */
+    std::vector<char> mIsLabelled;
+
+    /**
+     * Compute the statistics for the current state of the population, and append them to the statistics file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void WriteStatistics(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+public:
+
+    /** Default constructor. */
+    CellSortingStatisticsModifier() = default;
+
+    /** Default destructor. */
+    virtual ~CellSortingStatisticsModifier() = default;
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Specify what to do in the simulation at the end of each time step.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Open the statistics file in the simulation output directory and write the statistics of the initial state.  If
+     * the previous Solve() had the same simulation output directory, continue its file instead, without writing the
+     * initial state again.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.  Flush the statistics file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /** @return the number of time steps between samples */
+    unsigned GetSamplingInterval() const noexcept;
+
+    /** @param samplingInterval the new number of time steps between samples; must be at least 1 */
+    void SetSamplingInterval(unsigned samplingInterval);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    virtual void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(CellSortingStatisticsModifier)
+
+#endif /*CELLSORTINGSTATISTICSMODIFIER_HPP_*/
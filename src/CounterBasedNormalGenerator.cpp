@@ -0,0 +1,130 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CounterBasedNormalGenerator.hpp"
+
+#include <cmath>
+
+#include <boost/math/constants/constants.hpp>
+
+namespace
+{
+
+/**
+ * Convert two 32-bit words to a uniform deviate on (0, 1] with 53 random bits.
+ *
+ * @param hi the word giving the high 27 bits
+ * @param lo the word giving the low 26 bits
+ * @return the uniform deviate
+ */
+inline double ToOpenClosedUnitInterval(std::uint32_t hi, std::uint32_t lo)
+{
+    const std::uint64_t bits = (static_cast<std::uint64_t>(hi >> 5u) << 26u) | static_cast<std::uint64_t>(lo >> 6u);
+    return (static_cast<double>(bits) + 1.0) * (1.0 / 9007199254740992.0);
+}
+
+} // namespace
+
+CounterBasedNormalGenerator::CounterBasedNormalGenerator(std::uint64_t key)
+{
+    SetKey(key);
+}
+
+std::uint64_t CounterBasedNormalGenerator::GetKey() const
+{
+    return (static_cast<std::uint64_t>(mKey[1]) << 32u) | static_cast<std::uint64_t>(mKey[0]);
+}
+
+void CounterBasedNormalGenerator::SetKey(std::uint64_t key)
+{
+    mKey[0] = static_cast<std::uint32_t>(key);
+    mKey[1] = static_cast<std::uint32_t>(key >> 32u);
+}
+
+CounterBasedNormalGenerator::Block CounterBasedNormalGenerator::Philox4x32(Block counter,
+                                                                           std::array<std::uint32_t, 2> key)
+{
+    // Multipliers and Weyl sequence increments from Salmon et al. (2011)
+    constexpr std::uint64_t multiplier_0 = 0xD2511F53u;
+    constexpr std::uint64_t multiplier_1 = 0xCD9E8D57u;
+    constexpr std::uint32_t weyl_0 = 0x9E3779B9u;
+    constexpr std::uint32_t weyl_1 = 0xBB67AE85u;
+
+    for (unsigned round = 0; round < 10; ++round)
+    {
+        const std::uint64_t product_0 = multiplier_0 * counter[0];
+        const std::uint64_t product_1 = multiplier_1 * counter[2];
+
+        counter = {{static_cast<std::uint32_t>(product_1 >> 32u) ^ counter[1] ^ key[0],
+                    static_cast<std::uint32_t>(product_1),
+                    static_cast<std::uint32_t>(product_0 >> 32u) ^ counter[3] ^ key[1],
+                    static_cast<std::uint32_t>(product_0)}};
+
+        key[0] += weyl_0;
+        key[1] += weyl_1;
+    }
+
+    return counter;
+}
+
+void CounterBasedNormalGenerator::FillStandardNormals(std::uint64_t stream,
+                                                      std::uint64_t firstIndex,
+                                                      std::size_t numDeviates,
+                                                      double* pOut) const
+{
+    const double two_pi = boost::math::constants::two_pi<double>();
+
+    const std::uint64_t end_index = firstIndex + numDeviates;
+    for (std::uint64_t block_idx = firstIndex / 2u; 2u * block_idx < end_index; ++block_idx)
+    {
+        const Block counter = {{static_cast<std::uint32_t>(block_idx), static_cast<std::uint32_t>(block_idx >> 32u),
+                                static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32u)}};
+        const Block random_bits = Philox4x32(counter, mKey);
+
+        // Box-Muller: two uniform deviates give the pair of normal deviates with indices 2 * block_idx and one more
+        const double radius = std::sqrt(-2.0 * std::log(ToOpenClosedUnitInterval(random_bits[0], random_bits[1])));
+        const double angle = two_pi * ToOpenClosedUnitInterval(random_bits[2], random_bits[3]);
+
+        const std::uint64_t pair_start = 2u * block_idx;
+        if (pair_start >= firstIndex)
+        {
+            pOut[pair_start - firstIndex] = radius * std::cos(angle);
+        }
+        if (pair_start + 1u < end_index)
+        {
+            pOut[pair_start + 1u - firstIndex] = radius * std::sin(angle);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef COUNTERBASEDNORMALGENERATOR_HPP_
+#define COUNTERBASEDNORMALGENERATOR_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A counter-based generator of standard normal deviates, using the Philox4x32-10 bijection of Salmon et al. (2011)
+ * and the Box-Muller transform.
+ *
+ * Deviate i of stream s depends only on the key, s and i, so a buffer can be filled in any order, in pieces, or from
+ * any number of threads, and always holds the same values.  Each round of Philox gives four 32-bit words, which make two
+ * 53-bit uniform deviates and so two normal deviates.
+ */
+class CounterBasedNormalGenerator
+{
+private:
+
+    /** The Philox key */
+    std::array<std::uint32_t, 2> mKey;
+
+public:
+
+    /** A Philox counter or output block */
+    using Block = std::array<std::uint32_t, 4>;
+
+    /**
+     * Constructor.
+     *
+     * @param key the 64-bit key identifying this generator; each key gives independent streams
+     */
+    explicit CounterBasedNormalGenerator(std::uint64_t key = 0u);
+
+    /** @return the 64-bit key */
+    std::uint64_t GetKey() const;
+
+    /** @param key the new 64-bit key */
+    void SetKey(std::uint64_t key);
+
+    /**
+     * Apply the ten-round Philox4x32 bijection.
+     *
+     * @param counter the counter to encrypt
+     * @param key the key
+     * @return the encrypted counter
+     */
+    static Block Philox4x32(Block counter, std::array<std::uint32_t, 2> key);
+
+    /**
+     * Fill a buffer with consecutive standard normal deviates from one stream.
+     *
+     * @param stream the stream to draw from, for instance the number of time steps elapsed
+     * @param firstIndex the index within the stream of the first deviate to write
+     * @param numDeviates the number of deviates to write
+     * @param pOut the buffer to fill, of length at least numDeviates
+     */
+    void FillStandardNormals(std::uint64_t stream, std::uint64_t firstIndex, std::size_t numDeviates, double* pOut) const;
+};
+
+#endif /*COUNTERBASEDNORMALGENERATOR_HPP_*/
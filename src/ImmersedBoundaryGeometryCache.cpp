@@ -0,0 +1,170 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryGeometryCache.hpp"
+
+#include <map>
+
+#include "Exception.hpp"
+#include "SimulationTime.hpp"
+
+template<unsigned DIM>
+ImmersedBoundaryGeometryCache<DIM>::ImmersedBoundaryGeometryCache(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+        : mrMesh(rMesh),
+          mTimeStepsElapsed(UNSIGNED_UNSET),
+          mAverageNodeSpacingsValid(false),
+          mSurfaceAreasValid(false),
+          mVolumesValid(false),
+          mCentroidsValid(false)
+{
+}
+
+template<unsigned DIM>
+std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> ImmersedBoundaryGeometryCache<DIM>::GetForMesh(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    // Weak pointers, so a mesh allocated at the address of a destroyed one never picks up a stale cache
+    static std::map<const ImmersedBoundaryMesh<DIM, DIM>*, std::weak_ptr<ImmersedBoundaryGeometryCache<DIM>>> caches;
+
+    for (auto it = caches.begin(); it != caches.end();)
+    {
+        it = it->second.expired() ? caches.erase(it) : std::next(it);
+    }
+
+    std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> p_cache = caches[&rMesh].lock();
+    if (!p_cache)
+    {
+        p_cache = std::make_shared<ImmersedBoundaryGeometryCache<DIM>>(rMesh);
+        caches[&rMesh] = p_cache;
+    }
+
+    return p_cache;
+}
+
+template<unsigned DIM>
+ImmersedBoundaryMesh<DIM, DIM>& ImmersedBoundaryGeometryCache<DIM>::rGetMesh()
+{
+    return mrMesh;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryGeometryCache<DIM>::Invalidate()
+{
+    mAverageNodeSpacingsValid = false;
+    mSurfaceAreasValid = false;
+    mVolumesValid = false;
+    mCentroidsValid = false;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryGeometryCache<DIM>::InvalidateIfOutOfDate()
+{
+    const unsigned time_steps_elapsed = SimulationTime::Instance()->GetTimeStepsElapsed();
+
+    if (time_steps_elapsed != mTimeStepsElapsed)
+    {
+        Invalidate();
+        mTimeStepsElapsed = time_steps_elapsed;
+    }
+}
+
+template<unsigned DIM>
+template<typename VALUE, typename CALCULATOR>
+void ImmersedBoundaryGeometryCache<DIM>::FillIfInvalid(std::vector<VALUE>& rValues, bool& rValid, CALCULATOR calculate)
+{
+    InvalidateIfOutOfDate();
+
+    if (!rValid)
+    {
+        // The vector only reallocates if the number of elements grows
+        rValues.resize(mrMesh.GetNumAllElements());
+
+        for (auto elem_it = mrMesh.GetElementIteratorBegin(); elem_it != mrMesh.GetElementIteratorEnd(); ++elem_it)
+        {
+            const unsigned elem_idx = elem_it->GetIndex();
+            rValues[elem_idx] = calculate(elem_idx);
+        }
+
+        rValid = true;
+    }
+}
+
+template<unsigned DIM>
+double ImmersedBoundaryGeometryCache<DIM>::GetAverageNodeSpacingOfElement(unsigned elemIdx)
+{
+    FillIfInvalid(mAverageNodeSpacings, mAverageNodeSpacingsValid, [this](unsigned elem_idx) {
+        return mrMesh.GetAverageNodeSpacingOfElement(elem_idx, false);
+    });
+
+    assert(elemIdx < mAverageNodeSpacings.size());
+    return mAverageNodeSpacings[elemIdx];
+}
+
+template<unsigned DIM>
+double ImmersedBoundaryGeometryCache<DIM>::GetSurfaceAreaOfElement(unsigned elemIdx)
+{
+    FillIfInvalid(mSurfaceAreas, mSurfaceAreasValid, [this](unsigned elem_idx) {
+        return mrMesh.GetSurfaceAreaOfElement(elem_idx);
+    });
+
+    assert(elemIdx < mSurfaceAreas.size());
+    return mSurfaceAreas[elemIdx];
+}
+
+template<unsigned DIM>
+double ImmersedBoundaryGeometryCache<DIM>::GetVolumeOfElement(unsigned elemIdx)
+{
+    FillIfInvalid(mVolumes, mVolumesValid, [this](unsigned elem_idx) {
+        return mrMesh.GetVolumeOfElement(elem_idx);
+    });
+
+    assert(elemIdx < mVolumes.size());
+    return mVolumes[elemIdx];
+}
+
+template<unsigned DIM>
+const c_vector<double, DIM>& ImmersedBoundaryGeometryCache<DIM>::rGetCentroidOfElement(unsigned elemIdx)
+{
+    FillIfInvalid(mCentroids, mCentroidsValid, [this](unsigned elem_idx) {
+        return mrMesh.GetCentroidOfElement(elem_idx);
+    });
+
+    assert(elemIdx < mCentroids.size());
+    return mCentroids[elemIdx];
+}
+
+// Explicit instantiation
+template class ImmersedBoundaryGeometryCache<1>;
+template class ImmersedBoundaryGeometryCache<2>;
+template class ImmersedBoundaryGeometryCache<3>;
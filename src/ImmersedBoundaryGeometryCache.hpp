@@ -0,0 +1,154 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYGEOMETRYCACHE_HPP_
+#define IMMERSEDBOUNDARYGEOMETRYCACHE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "ImmersedBoundaryMesh.hpp"
+#include "UblasCustomFunctions.hpp"
+
+/**
+ * A per-time-step cache of element geometry in an immersed boundary mesh: average node spacing, perimeter (surface
+ * area), area (volume) and centroid.
+ *
+ * Node locations only change once per time step, but several force classes and modifiers each need the same
+ * geometric quantities.  A single cache instance is shared by every user of a given mesh, obtained through
+ * GetForMesh().  Each quantity is calculated for all elements the first time it is requested in a time step, and
+ * the cache is invalidated automatically on the next time step; this also covers remeshing, which only happens when
+ * nodes are moved at the end of a time step.  If nodes are moved by hand within a time step, call Invalidate().
+ */
+template<unsigned DIM>
+class ImmersedBoundaryGeometryCache
+{
+private:
+
+    /** The mesh whose element geometry is cached */
+    ImmersedBoundaryMesh<DIM, DIM>& mrMesh;
+
+    /** The number of time steps elapsed when the cached values were calculated, or UNSIGNED_UNSET if never */
+    unsigned mTimeStepsElapsed;
+
+    /** The average node spacing of each element, indexed by element index */
+    std::vector<double> mAverageNodeSpacings;
+
+    /** The perimeter of each element, indexed by element index */
+    std::vector<double> mSurfaceAreas;
+
+    /** The area of each element, indexed by element index */
+    std::vector<double> mVolumes;
+
+    /** The centroid of each element, indexed by element index */
+    std::vector<c_vector<double, DIM>> mCentroids;
+
+    /** Whether mAverageNodeSpacings is valid for the current time step */
+    bool mAverageNodeSpacingsValid;
+
+    /** Whether mSurfaceAreas is valid for the current time step */
+    bool mSurfaceAreasValid;
+
+    /** Whether mVolumes is valid for the current time step */
+    bool mVolumesValid;
+
+    /** Whether mCentroids is valid for the current time step */
+    bool mCentroidsValid;
+
+    /**
+     * Invalidate all cached values if the time step has changed since they were calculated.
+     */
+    void InvalidateIfOutOfDate();
+
+    /**
+     * Helper method to fill one of the per-element vectors.
+     *
+     * @param rValues the vector to fill
+     * @param rValid the validity flag associated with rValues, set to true on return
+     * @param calculate function returning the value for a given element index
+     */
+    template<typename VALUE, typename CALCULATOR>
+    void FillIfInvalid(std::vector<VALUE>& rValues, bool& rValid, CALCULATOR calculate);
+
+public:
+
+    /**
+     * Constructor.  Prefer GetForMesh(), so that the cache is shared by all users of the mesh.
+     *
+     * @param rMesh the mesh whose element geometry is cached
+     */
+    explicit ImmersedBoundaryGeometryCache(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Get the cache shared by every user of a mesh, creating it if necessary.  The cache is destroyed once the last
+     * pointer to it is released.
+     *
+     * @param rMesh the mesh
+     * @return a shared pointer to the cache for rMesh
+     */
+    static std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> GetForMesh(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /** @return the mesh whose element geometry is cached */
+    ImmersedBoundaryMesh<DIM, DIM>& rGetMesh();
+
+    /** Mark all cached values as out of date. */
+    void Invalidate();
+
+    /**
+     * @param elemIdx global index of the element
+     * @return the average node spacing of the element, as ImmersedBoundaryMesh::GetAverageNodeSpacingOfElement(elemIdx, false)
+     */
+    double GetAverageNodeSpacingOfElement(unsigned elemIdx);
+
+    /**
+     * @param elemIdx global index of the element
+     * @return the perimeter of the element, as ImmersedBoundaryMesh::GetSurfaceAreaOfElement()
+     */
+    double GetSurfaceAreaOfElement(unsigned elemIdx);
+
+    /**
+     * @param elemIdx global index of the element
+     * @return the area of the element, as ImmersedBoundaryMesh::GetVolumeOfElement()
+     */
+    double GetVolumeOfElement(unsigned elemIdx);
+
+    /**
+     * @param elemIdx global index of the element
+     * @return the centroid of the element, as ImmersedBoundaryMesh::GetCentroidOfElement()
+     */
+    const c_vector<double, DIM>& rGetCentroidOfElement(unsigned elemIdx);
+};
+
+#endif /*IMMERSEDBOUNDARYGEOMETRYCACHE_HPP_*/
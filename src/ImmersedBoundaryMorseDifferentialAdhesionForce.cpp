@@ -35,7 +35,52 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ImmersedBoundaryMorseDifferentialAdhesionForce.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include "CellLabel.hpp"
+#include "ChasteMakeUnique.hpp"
+#include "ImmersedBoundaryPeriodicDifference.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
+#include "OffloadBuffer.hpp"
+
+template <unsigned DIM>
+struct ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::DeviceState
+{
+    /** The location of every node, DIM entries per node, copied to the device each time step */
+    OffloadBuffer<double> mNodeLocations;
+
+    /** The two node indices of each pair in mVerletPairs */
+    OffloadBuffer<unsigned> mNodePairs;
+
+    /** The index in mVerletPairs.rGetElementPairs() of the element pair of each node pair */
+    OffloadBuffer<unsigned> mPairElementPairs;
+
+    /** The four quantities of CalculateElementPairConstants() for each element pair, copied each time step */
+    OffloadBuffer<double> mElementPairConstants;
+
+    /** The forces of each pair, laid out as mPairForces, which only exist on the device */
+    OffloadBuffer<double> mPairForces;
+
+    /** The offset of the entries of each node in mNodePairEntries, with the total number of entries at the end */
+    OffloadBuffer<unsigned> mNodePairOffsets;
+
+    /** For each node in turn, its pairs in pair order, as twice the pair index plus one if it is the second node */
+    OffloadBuffer<unsigned> mNodePairEntries;
+
+    /** The force on every node, DIM entries per node, copied back each time step */
+    OffloadBuffer<double> mNodeForces;
+
+    /** A copy of mPotentialTable */
+    OffloadBuffer<double> mPotentialTable;
+
+    /** Whether mVerletPairs has been rebuilt since the pair arrays were copied to the device */
+    bool mPairsAreStale = true;
+
+    /** Whether mPotentialTable has been rebuilt since it was copied to the device */
+    bool mPotentialTableIsStale = true;
+};
 
 template <unsigned DIM>
 ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::ImmersedBoundaryMorseDifferentialAdhesionForce()
@@ -45,83 +90,769 @@ ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::ImmersedBoundaryMorseDiffer
           mAdhesionAtoBWellDepth(1e3),
           mAdhesionBtoBWellDepth(1e3),
           mRestLength(0.25),
-          mWellWidth(0.25)
+          mWellWidth(0.25),
+          mNumThreads(1u),
+          mInteractionDistance(DOUBLE_UNSET),
+          mEffectiveRestLength(DOUBLE_UNSET),
+          mEffectiveWellWidth(DOUBLE_UNSET),
+          mUseTabulatedPotential(false),
+          mTabulationTolerance(1e-6),
+          mPotentialTableOneOverSpacing(DOUBLE_UNSET),
+          mWellDepthByClass({{DOUBLE_UNSET, DOUBLE_UNSET, DOUBLE_UNSET, DOUBLE_UNSET}}),
+          mTabulatedInteractionDistance(DOUBLE_UNSET),
+          mVerletSkin(0.0),
+          mVerletInteractionDistance(DOUBLE_UNSET),
+          mUseDeviceOffload(false)
 {
 }
 
+template <unsigned DIM>
+ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::~ImmersedBoundaryMorseDifferentialAdhesionForce() = default;
+
 template <unsigned DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::AddImmersedBoundaryForceContribution(
         std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
         ImmersedBoundaryCellPopulation<DIM>& rCellPopulation)
 {
+    IB_PROFILE_SCOPE(timer, "ImmersedBoundaryMorseDifferentialAdhesionForce");
+    IB_PROFILE_ADD_NODES(timer, rCellPopulation.GetNumNodes());
+
     // We assume this force is not used with laminas; modifications necessary if laminas are present in the mesh
     assert(rCellPopulation.rGetMesh().GetNumLaminas() == 0u);
 
-    for (const auto& node_pair : rNodePairs)
+    UpdateElementSnapshot(rCellPopulation);
+
+    // These quantities are the same for every pair this time step
+    mInteractionDistance = rCellPopulation.GetInteractionDistance();
+    mEffectiveRestLength = mRestLength * mInteractionDistance;
+    mEffectiveWellWidth = mWellWidth * mInteractionDistance;
+
+    if (mUseTabulatedPotential)
+    {
+        UpdatePotentialTableIfStale();
+    }
+
+    ImmersedBoundaryMesh<DIM, DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    if (mUseDeviceOffload && !(mVerletSkin > 0.0))
+    {
+        EXCEPTION("Device offload needs a Verlet list, so the Verlet skin must be positive.");
+    }
+
+    if (mVerletSkin > 0.0)
+    {
+        UpdateVerletPairsIfStale(rNodePairs, r_mesh);
+        if (mUseDeviceOffload)
+        {
+            AddDeviceForceContribution(r_mesh);
+        }
+        else
+        {
+            AddVerletForceContribution(r_mesh);
+        }
+    }
+    else if (mNumThreads > 1u)
+    {
+        AddForceContributionMultiThreaded(rNodePairs, r_mesh);
+    }
+    else
     {
-        // Interactions only exist between pairs of nodes that are not in the same boundary / lamina
-        if (rCellPopulation.rGetMesh().NodesInDifferentElementOrLamina(node_pair.first, node_pair.second))
+        c_vector<double, DIM> force_on_a;
+        c_vector<double, DIM> force_on_b;
+
+        for (const auto& node_pair : rNodePairs)
         {
-            Node<DIM>* const p_node_a = node_pair.first;
-            Node<DIM>* const p_node_b = node_pair.second;
+            if (CalculatePairForce(node_pair, r_mesh, force_on_a, force_on_b))
+            {
+                node_pair.first->AddAppliedForceContribution(force_on_a);
+                node_pair.second->AddAppliedForceContribution(force_on_b);
+            }
+        }
+    }
 
-            c_vector<double, DIM> vec_a2b = rCellPopulation.rGetMesh().GetVectorFromAtoB(p_node_a->rGetLocation(),
-                                                                                         p_node_b->rGetLocation());
-            const double normed_dist = norm_2(vec_a2b);
+    IB_PROFILE_ADD_PAIRS(timer, mVerletSkin > 0.0 ? mVerletPairs.rGetNodePairs().size() : rNodePairs.size());
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::AddForceContributionMultiThreaded(
+        std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+        ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    const std::size_t num_pairs = rNodePairs.size();
 
-            // Force non-zero only within interaction distance, by definition
-            if (normed_dist < rCellPopulation.GetInteractionDistance())
+    // These only reallocate if the number of pairs grows
+    mPairForces.resize(2u * DIM * num_pairs);
+    mPairInteracts.resize(num_pairs);
+
+    // Each pair writes only to its own slots, so the pairs may be evaluated in any order
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(mNumThreads) schedule(static)
+#endif
+    for (std::size_t pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+    {
+        c_vector<double, DIM> force_on_a;
+        c_vector<double, DIM> force_on_b;
+
+        mPairInteracts[pair_idx] = CalculatePairForce(rNodePairs[pair_idx], rMesh, force_on_a, force_on_b);
+
+        if (mPairInteracts[pair_idx])
+        {
+            double* const p_forces = &mPairForces[2u * DIM * pair_idx];
+            std::copy(force_on_a.begin(), force_on_a.end(), p_forces);
+            std::copy(force_on_b.begin(), force_on_b.end(), p_forces + DIM);
+        }
+    }
+
+    // Accumulate in pair order so that the result does not depend on the number of threads
+    c_vector<double, DIM> force;
+    for (std::size_t pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+    {
+        if (mPairInteracts[pair_idx])
+        {
+            const double* const p_forces = &mPairForces[2u * DIM * pair_idx];
+
+            std::copy(p_forces, p_forces + DIM, force.begin());
+            rNodePairs[pair_idx].first->AddAppliedForceContribution(force);
+
+            std::copy(p_forces + DIM, p_forces + 2u * DIM, force.begin());
+            rNodePairs[pair_idx].second->AddAppliedForceContribution(force);
+        }
+    }
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::AddVerletForceContribution(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    const unsigned num_nodes = rMesh.GetNumNodes();
+    const auto& r_element_pairs = mVerletPairs.rGetElementPairs();
+    const auto& r_node_pairs = mVerletPairs.rGetNodePairs();
+    const std::size_t num_pairs = r_node_pairs.size();
+
+    // These only reallocate if the number of nodes or pairs grows
+    mNodeLocations.resize(DIM * num_nodes);
+    mNodeForces.assign(DIM * num_nodes, 0.0);
+    mPairForces.resize(2u * DIM * num_pairs);
+    mPairInteracts.resize(num_pairs);
+
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, DIM>& r_location = rMesh.GetNode(node_idx)->rGetLocation();
+        std::copy(r_location.begin(), r_location.end(), &mNodeLocations[DIM * node_idx]);
+    }
+
+    const std::size_t num_element_pairs = r_element_pairs.size();
+    if (mNumThreads > 1u)
+    {
+        // Element pairs hold very different numbers of node pairs, so are shared out dynamically
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(mNumThreads) schedule(dynamic, 16)
+#endif
+        for (std::size_t group_idx = 0; group_idx < num_element_pairs; ++group_idx)
+        {
+            CalculateElementPairForces(r_element_pairs[group_idx], rMesh);
+        }
+    }
+    else
+    {
+        for (const auto& r_element_pair : r_element_pairs)
+        {
+            CalculateElementPairForces(r_element_pair, rMesh);
+        }
+    }
+
+    // Accumulate in pair order so that the result does not depend on the number of threads
+    for (std::size_t pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+    {
+        if (mPairInteracts[pair_idx])
+        {
+            const double* const p_forces = &mPairForces[2u * DIM * pair_idx];
+            double* const p_force_on_a = &mNodeForces[DIM * r_node_pairs[pair_idx].mNodeA];
+            double* const p_force_on_b = &mNodeForces[DIM * r_node_pairs[pair_idx].mNodeB];
+
+            for (unsigned dim = 0; dim < DIM; ++dim)
             {
-                const unsigned a_elem_idx = *(p_node_a->ContainingElementsBegin());
-                const unsigned b_elem_idx = *(p_node_b->ContainingElementsBegin());
+                p_force_on_a[dim] += p_forces[dim];
+                p_force_on_b[dim] += p_forces[DIM + dim];
+            }
+        }
+    }
+
+    c_vector<double, DIM> force;
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        std::copy_n(&mNodeForces[DIM * node_idx], DIM, force.begin());
+        rMesh.GetNode(node_idx)->AddAppliedForceContribution(force);
+    }
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::CalculateVectorFromAtoB(const double* pLocationA,
+                                                                                  const double* pLocationB,
+                                                                                  ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+                                                                                  double* pVecA2B) const
+{
+    c_vector<double, DIM> location_a;
+    c_vector<double, DIM> location_b;
+    std::copy_n(pLocationA, DIM, location_a.begin());
+    std::copy_n(pLocationB, DIM, location_b.begin());
+
+    const c_vector<double, DIM> vec_a2b = rMesh.GetVectorFromAtoB(location_a, location_b);
+    std::copy(vec_a2b.begin(), vec_a2b.end(), pVecA2B);
+}
+
+template <>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<2>::CalculateVectorFromAtoB(const double* pLocationA,
+                                                                                const double* pLocationB,
+                                                                                ImmersedBoundaryMesh<2, 2>&,
+                                                                                double* pVecA2B) const
+{
+    for (unsigned dim = 0; dim < 2u; ++dim)
+    {
+        pVecA2B[dim] = CalculatePeriodicDifference(pLocationA[dim], pLocationB[dim]);
+    }
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::CalculateElementPairForces(
+        const typename ImmersedBoundaryNodePairList<DIM>::ElementPair& rElementPair,
+        ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    // Everything that depends only on the two elements, as in CalculatePairForce()
+    double constants[4];
+    CalculateElementPairConstants(rElementPair, constants);
 
-                const bool a_elem_labelled = rCellPopulation.GetCellUsingLocationIndex(a_elem_idx)->template HasCellProperty<CellLabel>();
-                const bool b_elem_labelled = rCellPopulation.GetCellUsingLocationIndex(b_elem_idx)->template HasCellProperty<CellLabel>();
+    const double scale_a = constants[0];
+    const double scale_b = constants[1];
+    const double repulsion_well_depth = constants[2];
+    const double adhesion_well_depth = constants[3];
 
+    const auto& r_node_pairs = mVerletPairs.rGetNodePairs();
 
-                const double node_a_elem_spacing = rCellPopulation.rGetMesh().GetAverageNodeSpacingOfElement(a_elem_idx, false);
-                const double node_b_elem_spacing = rCellPopulation.rGetMesh().GetAverageNodeSpacingOfElement(b_elem_idx, false);
+    // Plain arrays of compile-time length, so that the loops over components unroll
+    double vec_a2b[DIM];
 
-                const double elem_spacing = 0.5 * (node_a_elem_spacing + node_b_elem_spacing);
+    for (unsigned pair_idx = rElementPair.mFirstNodePair; pair_idx < rElementPair.mEndNodePair; ++pair_idx)
+    {
+        CalculateVectorFromAtoB(&mNodeLocations[DIM * r_node_pairs[pair_idx].mNodeA],
+                                &mNodeLocations[DIM * r_node_pairs[pair_idx].mNodeB],
+                                rMesh,
+                                vec_a2b);
 
-                const double eff_rest_length = mRestLength * rCellPopulation.GetInteractionDistance();
-                const double eff_well_width = mWellWidth * rCellPopulation.GetInteractionDistance();
+        double normed_dist_squared = 0.0;
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            normed_dist_squared += vec_a2b[dim] * vec_a2b[dim];
+        }
+        const double normed_dist = std::sqrt(normed_dist_squared);
 
+        // Force non-zero only within interaction distance, by definition
+        mPairInteracts[pair_idx] = normed_dist < mInteractionDistance;
+        if (!mPairInteracts[pair_idx])
+        {
+            continue;
+        }
+
+        const double eff_well_depth = normed_dist < mEffectiveRestLength ? repulsion_well_depth : adhesion_well_depth;
+
+        double force_magnitude = 0.0;
+        if (mUseTabulatedPotential)
+        {
+            force_magnitude = eff_well_depth * InterpolateMorseProfile(normed_dist) / normed_dist;
+        }
+        else
+        {
+            const double morse_exp = std::exp((mEffectiveRestLength - normed_dist) / mEffectiveWellWidth);
+            force_magnitude = 2.0 * mEffectiveWellWidth * eff_well_depth * morse_exp * (1.0 - morse_exp) / normed_dist;
+        }
 
-                double eff_well_depth = elem_spacing / rCellPopulation.GetIntrinsicSpacing();
+        double* const p_forces = &mPairForces[2u * DIM * pair_idx];
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            const double component = vec_a2b[dim] * force_magnitude;
+            p_forces[dim] = component * scale_a;
+            p_forces[DIM + dim] = component * scale_b;
+        }
+    }
+}
 
-                if (normed_dist < eff_rest_length)
-                {
-                    eff_well_depth *= mRepulsionWellDepth;
-                }
-                else if (a_elem_labelled && b_elem_labelled)
-                {
-                    eff_well_depth *= mAdhesionBtoBWellDepth;
-                }
-                else if (a_elem_labelled || b_elem_labelled)
-                {
-                    eff_well_depth *= mAdhesionAtoBWellDepth;
-                }
-                else
-                {
-                    eff_well_depth *= mAdhesionAtoAWellDepth;
-                }
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::CalculateElementPairConstants(
+        const typename ImmersedBoundaryNodePairList<DIM>::ElementPair& rElementPair,
+        double* pConstants) const
+{
+    const ElementSnapshot& r_elem_a = mElementSnapshot[rElementPair.mElemA];
+    const ElementSnapshot& r_elem_b = mElementSnapshot[rElementPair.mElemB];
 
-                const double morse_exp = std::exp((eff_rest_length - normed_dist) / eff_well_width);
+    const double elem_spacing = 0.5 * (r_elem_a.mNodeSpacing + r_elem_b.mNodeSpacing);
+    const double spacing_ratio = 0.5 * (r_elem_a.mSpacingRatio + r_elem_b.mSpacingRatio);
 
-                /*
-                 * We must scale each applied force by a factor of elem_spacing / local spacing, so that forces
-                 * balance when spread to the grid later (where the multiplicative factor is the local spacing)
-                 */
-                vec_a2b *= 2.0 * eff_well_width * eff_well_depth * morse_exp * (1.0 - morse_exp) / normed_dist;
+    double repulsion_well_depth = spacing_ratio;
+    double adhesion_well_depth = spacing_ratio;
+    if (mUseTabulatedPotential)
+    {
+        repulsion_well_depth *= mWellDepthByClass[0];
+        adhesion_well_depth *= mWellDepthByClass[1u + static_cast<unsigned>(r_elem_a.mIsLabelled) +
+                                                 static_cast<unsigned>(r_elem_b.mIsLabelled)];
+    }
+    else
+    {
+        repulsion_well_depth *= mRepulsionWellDepth;
+        if (r_elem_a.mIsLabelled && r_elem_b.mIsLabelled)
+        {
+            adhesion_well_depth *= mAdhesionBtoBWellDepth;
+        }
+        else if (r_elem_a.mIsLabelled || r_elem_b.mIsLabelled)
+        {
+            adhesion_well_depth *= mAdhesionAtoBWellDepth;
+        }
+        else
+        {
+            adhesion_well_depth *= mAdhesionAtoAWellDepth;
+        }
+    }
 
-                c_vector<double, DIM> force_a2b = vec_a2b * (elem_spacing / node_a_elem_spacing);
-                p_node_a->AddAppliedForceContribution(force_a2b);
+    pConstants[0] = elem_spacing / r_elem_a.mNodeSpacing;
+    pConstants[1] = -1.0 * elem_spacing / r_elem_b.mNodeSpacing;
+    pConstants[2] = repulsion_well_depth;
+    pConstants[3] = adhesion_well_depth;
+}
 
-                c_vector<double, DIM> force_b2a = vec_a2b * (-1.0 * elem_spacing / node_b_elem_spacing);
-                p_node_b->AddAppliedForceContribution(force_b2a);
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::AddDeviceForceContribution(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    if (!mpDeviceState)
+    {
+        mpDeviceState = our::make_unique<DeviceState>();
+    }
+    DeviceState& r_state = *mpDeviceState;
+
+    const unsigned num_nodes = rMesh.GetNumNodes();
+    const auto& r_element_pairs = mVerletPairs.rGetElementPairs();
+    const auto& r_node_pairs = mVerletPairs.rGetNodePairs();
+    const unsigned num_element_pairs = r_element_pairs.size();
+    const unsigned num_pairs = r_node_pairs.size();
+
+    if (num_pairs == 0u)
+    {
+        return;
+    }
+
+    // The pairs, and the pairs each node is in, only change when mVerletPairs is rebuilt
+    if (r_state.mPairsAreStale)
+    {
+        r_state.mNodePairs.Resize(2u * num_pairs);
+        r_state.mPairElementPairs.Resize(num_pairs);
+        for (unsigned group_idx = 0; group_idx < num_element_pairs; ++group_idx)
+        {
+            for (unsigned pair_idx = r_element_pairs[group_idx].mFirstNodePair;
+                 pair_idx < r_element_pairs[group_idx].mEndNodePair;
+                 ++pair_idx)
+            {
+                r_state.mNodePairs[2u * pair_idx] = r_node_pairs[pair_idx].mNodeA;
+                r_state.mNodePairs[2u * pair_idx + 1u] = r_node_pairs[pair_idx].mNodeB;
+                r_state.mPairElementPairs[pair_idx] = group_idx;
             }
         }
+
+        // Each node lists its pairs in pair order, so that it sums their forces in the same order as the host
+        r_state.mNodePairOffsets.Resize(num_nodes + 1u);
+        std::fill_n(r_state.mNodePairOffsets.data(), num_nodes + 1u, 0u);
+        for (unsigned pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+        {
+            ++r_state.mNodePairOffsets[r_node_pairs[pair_idx].mNodeA + 1u];
+            ++r_state.mNodePairOffsets[r_node_pairs[pair_idx].mNodeB + 1u];
+        }
+        std::partial_sum(r_state.mNodePairOffsets.data(), r_state.mNodePairOffsets.data() + num_nodes + 1u,
+                         r_state.mNodePairOffsets.data());
+
+        std::vector<unsigned> next_entries(r_state.mNodePairOffsets.data(), r_state.mNodePairOffsets.data() + num_nodes);
+        r_state.mNodePairEntries.Resize(2u * num_pairs);
+        for (unsigned pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+        {
+            r_state.mNodePairEntries[next_entries[r_node_pairs[pair_idx].mNodeA]++] = 2u * pair_idx;
+            r_state.mNodePairEntries[next_entries[r_node_pairs[pair_idx].mNodeB]++] = 2u * pair_idx + 1u;
+        }
+
+        r_state.mPairForces.Resize(2u * DIM * num_pairs);
+        r_state.mNodePairs.CopyToDevice();
+        r_state.mPairElementPairs.CopyToDevice();
+        r_state.mNodePairOffsets.CopyToDevice();
+        r_state.mNodePairEntries.CopyToDevice();
+        r_state.mPairsAreStale = false;
+    }
+
+    if (mUseTabulatedPotential && r_state.mPotentialTableIsStale)
+    {
+        r_state.mPotentialTable.Resize(mPotentialTable.size());
+        std::copy(mPotentialTable.begin(), mPotentialTable.end(), r_state.mPotentialTable.data());
+        r_state.mPotentialTable.CopyToDevice();
+        r_state.mPotentialTableIsStale = false;
+    }
+
+    // Node locations and the element pair quantities change every time step
+    r_state.mNodeLocations.Resize(DIM * num_nodes);
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, DIM>& r_location = rMesh.GetNode(node_idx)->rGetLocation();
+        std::copy(r_location.begin(), r_location.end(), &r_state.mNodeLocations[DIM * node_idx]);
+    }
+    r_state.mNodeLocations.CopyToDevice();
+
+    r_state.mElementPairConstants.Resize(4u * num_element_pairs);
+    for (unsigned group_idx = 0; group_idx < num_element_pairs; ++group_idx)
+    {
+        CalculateElementPairConstants(r_element_pairs[group_idx], &r_state.mElementPairConstants[4u * group_idx]);
+    }
+    r_state.mElementPairConstants.CopyToDevice();
+
+    r_state.mNodeForces.Resize(DIM * num_nodes);
+
+    // Kernels may only use plain pointers and values
+    const double* const p_locations = r_state.mNodeLocations.data();
+    const unsigned* const p_node_pairs = r_state.mNodePairs.data();
+    const unsigned* const p_pair_groups = r_state.mPairElementPairs.data();
+    const double* const p_group_constants = r_state.mElementPairConstants.data();
+    double* const p_pair_forces = r_state.mPairForces.data();
+    const unsigned* const p_node_offsets = r_state.mNodePairOffsets.data();
+    const unsigned* const p_node_entries = r_state.mNodePairEntries.data();
+    double* const p_node_forces = r_state.mNodeForces.data();
+    const double* const p_table = r_state.mPotentialTable.data();
+
+    const unsigned num_groups = num_element_pairs;
+    const unsigned table_size = r_state.mPotentialTable.size();
+    const bool use_table = mUseTabulatedPotential;
+    const double table_one_over_spacing = mPotentialTableOneOverSpacing;
+    const double interaction_distance = mInteractionDistance;
+    const double rest_length = mEffectiveRestLength;
+    const double well_width = mEffectiveWellWidth;
+
+    // Each pair writes only to its own slots; pairs that do not interact get zero forces
+#ifdef _OPENMP
+#pragma omp target teams distribute parallel for \
+        map(alloc: p_locations[0:DIM * num_nodes], p_node_pairs[0:2u * num_pairs], p_pair_groups[0:num_pairs], \
+                   p_group_constants[0:4u * num_groups], p_pair_forces[0:2u * DIM * num_pairs], p_table[0:table_size])
+#endif
+    for (unsigned pair_idx = 0; pair_idx < num_pairs; ++pair_idx)
+    {
+        const double* const p_location_a = &p_locations[DIM * p_node_pairs[2u * pair_idx]];
+        const double* const p_location_b = &p_locations[DIM * p_node_pairs[2u * pair_idx + 1u]];
+        const double* const p_constants = &p_group_constants[4u * p_pair_groups[pair_idx]];
+
+        // As in CalculateVectorFromAtoB()
+        double vec_a2b[DIM];
+        double normed_dist_squared = 0.0;
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            vec_a2b[dim] = CalculatePeriodicDifference(p_location_a[dim], p_location_b[dim]);
+            normed_dist_squared += vec_a2b[dim] * vec_a2b[dim];
+        }
+        const double normed_dist = std::sqrt(normed_dist_squared);
+
+        double force_magnitude = 0.0;
+        if (normed_dist < interaction_distance)
+        {
+            const double eff_well_depth = normed_dist < rest_length ? p_constants[2] : p_constants[3];
+
+            if (use_table)
+            {
+                // As in InterpolateMorseProfile()
+                const double position = normed_dist * table_one_over_spacing;
+                const unsigned truncated_idx = static_cast<unsigned>(position);
+                const unsigned lower_idx = truncated_idx < table_size - 2u ? truncated_idx : table_size - 2u;
+                const double fraction = position - lower_idx;
+                const double profile = p_table[lower_idx] + fraction * (p_table[lower_idx + 1u] - p_table[lower_idx]);
+
+                force_magnitude = eff_well_depth * profile / normed_dist;
+            }
+            else
+            {
+                const double morse_exp = std::exp((rest_length - normed_dist) / well_width);
+                force_magnitude = 2.0 * well_width * eff_well_depth * morse_exp * (1.0 - morse_exp) / normed_dist;
+            }
+        }
+
+        double* const p_forces = &p_pair_forces[2u * DIM * pair_idx];
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            const double component = vec_a2b[dim] * force_magnitude;
+            p_forces[dim] = component * p_constants[0];
+            p_forces[DIM + dim] = component * p_constants[1];
+        }
+    }
+
+    // Each node gathers the forces of its own pairs, so no two threads write to one node
+#ifdef _OPENMP
+#pragma omp target teams distribute parallel for \
+        map(alloc: p_pair_forces[0:2u * DIM * num_pairs], p_node_offsets[0:num_nodes + 1u], \
+                   p_node_entries[0:2u * num_pairs], p_node_forces[0:DIM * num_nodes])
+#endif
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        double force[DIM];
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            force[dim] = 0.0;
+        }
+
+        for (unsigned entry_idx = p_node_offsets[node_idx]; entry_idx < p_node_offsets[node_idx + 1u]; ++entry_idx)
+        {
+            const unsigned entry = p_node_entries[entry_idx];
+            const double* const p_forces = &p_pair_forces[2u * DIM * (entry >> 1u) + DIM * (entry & 1u)];
+            for (unsigned dim = 0; dim < DIM; ++dim)
+            {
+                force[dim] += p_forces[dim];
+            }
+        }
+
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            p_node_forces[DIM * node_idx + dim] = force[dim];
+        }
+    }
+
+    r_state.mNodeForces.CopyFromDevice();
+
+    c_vector<double, DIM> force;
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        std::copy_n(&r_state.mNodeForces[DIM * node_idx], DIM, force.begin());
+        rMesh.GetNode(node_idx)->AddAppliedForceContribution(force);
+    }
+}
+
+template <unsigned DIM>
+bool ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::CalculatePairForce(
+        const std::pair<Node<DIM>*, Node<DIM>*>& rNodePair,
+        ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+        c_vector<double, DIM>& rForceOnA,
+        c_vector<double, DIM>& rForceOnB) const
+{
+    Node<DIM>* const p_node_a = rNodePair.first;
+    Node<DIM>* const p_node_b = rNodePair.second;
+
+    // Interactions only exist between pairs of nodes that are not in the same boundary / lamina
+    if (!rMesh.NodesInDifferentElementOrLamina(p_node_a, p_node_b))
+    {
+        return false;
+    }
+
+    c_vector<double, DIM> vec_a2b = rMesh.GetVectorFromAtoB(p_node_a->rGetLocation(), p_node_b->rGetLocation());
+    const double normed_dist = norm_2(vec_a2b);
+
+    // Force non-zero only within interaction distance, by definition
+    if (normed_dist >= mInteractionDistance)
+    {
+        return false;
+    }
+
+    const ElementSnapshot& r_elem_a = mElementSnapshot[*(p_node_a->ContainingElementsBegin())];
+    const ElementSnapshot& r_elem_b = mElementSnapshot[*(p_node_b->ContainingElementsBegin())];
+
+    const double elem_spacing = 0.5 * (r_elem_a.mNodeSpacing + r_elem_b.mNodeSpacing);
+
+    double eff_well_depth = 0.5 * (r_elem_a.mSpacingRatio + r_elem_b.mSpacingRatio);
+
+    if (mUseTabulatedPotential)
+    {
+        // Class 0 is repulsion, and otherwise the number of labelled cells selects one of A-A, A-B or B-B
+        const unsigned interaction_class = normed_dist < mEffectiveRestLength
+                ? 0u
+                : 1u + static_cast<unsigned>(r_elem_a.mIsLabelled) + static_cast<unsigned>(r_elem_b.mIsLabelled);
+
+        eff_well_depth *= mWellDepthByClass[interaction_class];
+        vec_a2b *= eff_well_depth * InterpolateMorseProfile(normed_dist) / normed_dist;
+    }
+    else
+    {
+        if (normed_dist < mEffectiveRestLength)
+        {
+            eff_well_depth *= mRepulsionWellDepth;
+        }
+        else if (r_elem_a.mIsLabelled && r_elem_b.mIsLabelled)
+        {
+            eff_well_depth *= mAdhesionBtoBWellDepth;
+        }
+        else if (r_elem_a.mIsLabelled || r_elem_b.mIsLabelled)
+        {
+            eff_well_depth *= mAdhesionAtoBWellDepth;
+        }
+        else
+        {
+            eff_well_depth *= mAdhesionAtoAWellDepth;
+        }
+
+        const double morse_exp = std::exp((mEffectiveRestLength - normed_dist) / mEffectiveWellWidth);
+
+        vec_a2b *= 2.0 * mEffectiveWellWidth * eff_well_depth * morse_exp * (1.0 - morse_exp) / normed_dist;
+    }
+
+    /*
+     * We must scale each applied force by a factor of elem_spacing / local spacing, so that forces
+     * balance when spread to the grid later (where the multiplicative factor is the local spacing)
+     */
+    rForceOnA = vec_a2b * (elem_spacing / r_elem_a.mNodeSpacing);
+    rForceOnB = vec_a2b * (-1.0 * elem_spacing / r_elem_b.mNodeSpacing);
+
+    return true;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::UpdateVerletPairsIfStale(
+        const std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+        ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    const unsigned num_nodes = rMesh.GetNumNodes();
+
+    // The pairs hold node indices, so must also be rebuilt if nodes have been renumbered
+    bool is_stale = mVerletInteractionDistance != mInteractionDistance || mVerletReferenceNodes != rMesh.rGetNodes();
+
+    /*
+     * If no node has moved more than half the skin, no two nodes have closed by more than the skin, so every pair now
+     * within the interaction distance was within the interaction distance plus the skin when the list was built
+     */
+    const double max_displacement_squared = 0.25 * mVerletSkin * mVerletSkin;
+    c_vector<double, DIM> reference_location;
+
+    for (unsigned node_idx = 0; node_idx < num_nodes && !is_stale; ++node_idx)
+    {
+        std::copy_n(&mVerletReferenceLocations[DIM * node_idx], DIM, reference_location.begin());
+
+        const c_vector<double, DIM> displacement =
+                rMesh.GetVectorFromAtoB(reference_location, rMesh.GetNode(node_idx)->rGetLocation());
+
+        is_stale = inner_prod(displacement, displacement) > max_displacement_squared;
+    }
+
+    if (!is_stale)
+    {
+        return;
+    }
+
+    const double verlet_dist = mInteractionDistance + mVerletSkin;
+    if (rMesh.GetNeighbourDist() < verlet_dist)
+    {
+        EXCEPTION("The mesh neighbour distance must be at least the interaction distance plus the Verlet skin, "
+                  << verlet_dist << ", to use a Verlet list.");
+    }
+
+    mVerletPairs.Build(rNodePairs, rMesh, verlet_dist);
+    if (mpDeviceState)
+    {
+        mpDeviceState->mPairsAreStale = true;
+    }
+
+    mVerletReferenceNodes = rMesh.rGetNodes();
+    mVerletReferenceLocations.resize(DIM * num_nodes);
+    for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+    {
+        const c_vector<double, DIM>& r_location = rMesh.GetNode(node_idx)->rGetLocation();
+        std::copy(r_location.begin(), r_location.end(), &mVerletReferenceLocations[DIM * node_idx]);
+    }
+
+    mVerletInteractionDistance = mInteractionDistance;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::UpdatePotentialTableIfStale()
+{
+    if (mTabulatedInteractionDistance == mInteractionDistance)
+    {
+        return;
+    }
+
+    mWellDepthByClass = {{mRepulsionWellDepth, mAdhesionAtoAWellDepth, mAdhesionAtoBWellDepth, mAdhesionBtoBWellDepth}};
+
+    /*
+     * Start with a coarse table and double the number of intervals until the interpolation error, measured at the
+     * midpoint of each interval, is within tolerance.  The profile is smooth, so the midpoint error of linear
+     * interpolation is a good estimate of the maximum error in each interval.
+     */
+    const unsigned max_num_intervals = 1u << 20;
+    unsigned num_intervals = 64u;
+
+    while (true)
+    {
+        const double spacing = mInteractionDistance / num_intervals;
+
+        mPotentialTable.resize(num_intervals + 1u);
+        for (unsigned i = 0; i < mPotentialTable.size(); ++i)
+        {
+            mPotentialTable[i] = EvaluateMorseProfile(i * spacing);
+        }
+
+        const double max_magnitude = std::fabs(*std::max_element(mPotentialTable.begin(), mPotentialTable.end(),
+                                 [](double a, double b) { return std::fabs(a) < std::fabs(b); }));
+
+        double max_error = 0.0;
+        for (unsigned i = 0; i < num_intervals; ++i)
+        {
+            const double midpoint_value = 0.5 * (mPotentialTable[i] + mPotentialTable[i + 1u]);
+            max_error = std::max(max_error, std::fabs(midpoint_value - EvaluateMorseProfile((i + 0.5) * spacing)));
+        }
+
+        if (max_error <= mTabulationTolerance * max_magnitude)
+        {
+            mPotentialTableOneOverSpacing = 1.0 / spacing;
+            break;
+        }
+
+        if (2u * num_intervals > max_num_intervals)
+        {
+            EXCEPTION("Unable to tabulate the Morse potential to within tolerance " << mTabulationTolerance);
+        }
+        num_intervals *= 2u;
+    }
+
+    mTabulatedInteractionDistance = mInteractionDistance;
+    if (mpDeviceState)
+    {
+        mpDeviceState->mPotentialTableIsStale = true;
+    }
+}
+
+template <unsigned DIM>
+double ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::EvaluateMorseProfile(double dist) const
+{
+    const double morse_exp = std::exp((mEffectiveRestLength - dist) / mEffectiveWellWidth);
+    return 2.0 * mEffectiveWellWidth * morse_exp * (1.0 - morse_exp);
+}
+
+template <unsigned DIM>
+double ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::InterpolateMorseProfile(double dist) const
+{
+    assert(dist >= 0.0 && dist < mTabulatedInteractionDistance);
+
+    // Guard against rounding placing a distance just below the interaction distance beyond the final interval
+    const double position = dist * mPotentialTableOneOverSpacing;
+    const unsigned lower_idx = std::min(static_cast<unsigned>(position), static_cast<unsigned>(mPotentialTable.size() - 2u));
+    const double fraction = position - lower_idx;
+
+    return mPotentialTable[lower_idx] + fraction * (mPotentialTable[lower_idx + 1u] - mPotentialTable[lower_idx]);
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::UpdateElementSnapshot(
+        ImmersedBoundaryCellPopulation<DIM>& rCellPopulation)
+{
+    ImmersedBoundaryMesh<DIM, DIM>& r_mesh = rCellPopulation.rGetMesh();
+    const double intrinsic_spacing = rCellPopulation.GetIntrinsicSpacing();
+
+    if (!mpGeometryCache || &(mpGeometryCache->rGetMesh()) != &r_mesh)
+    {
+        mpGeometryCache = ImmersedBoundaryGeometryCache<DIM>::GetForMesh(r_mesh);
+    }
+
+    // The vector only reallocates if the number of elements grows
+    mElementSnapshot.resize(r_mesh.GetNumAllElements());
+
+    for (auto elem_it = r_mesh.GetElementIteratorBegin(); elem_it != r_mesh.GetElementIteratorEnd(); ++elem_it)
+    {
+        const unsigned elem_idx = elem_it->GetIndex();
+        ElementSnapshot& r_snapshot = mElementSnapshot[elem_idx];
+
+        r_snapshot.mIsLabelled = rCellPopulation.GetCellUsingLocationIndex(elem_idx)->template HasCellProperty<CellLabel>();
+        r_snapshot.mNodeSpacing = mpGeometryCache->GetAverageNodeSpacingOfElement(elem_idx);
+        r_snapshot.mSpacingRatio = r_snapshot.mNodeSpacing / intrinsic_spacing;
     }
 }
 
@@ -134,6 +865,11 @@ void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::OutputImmersedBoundary
     *rParamsFile << "\t\t\t<AdhesionBtoBWellDepth>" << mAdhesionBtoBWellDepth << "</AdhesionBtoBWellDepth>\n";
     *rParamsFile << "\t\t\t<RestLength>" << mRestLength << "</RestLength>\n";
     *rParamsFile << "\t\t\t<WellWidth>" << mWellWidth << "</WellWidth>\n";
+    *rParamsFile << "\t\t\t<NumThreads>" << mNumThreads << "</NumThreads>\n";
+    *rParamsFile << "\t\t\t<UseTabulatedPotential>" << mUseTabulatedPotential << "</UseTabulatedPotential>\n";
+    *rParamsFile << "\t\t\t<TabulationTolerance>" << mTabulationTolerance << "</TabulationTolerance>\n";
+    *rParamsFile << "\t\t\t<VerletSkin>" << mVerletSkin << "</VerletSkin>\n";
+    *rParamsFile << "\t\t\t<UseDeviceOffload>" << mUseDeviceOffload << "</UseDeviceOffload>\n";
 
     // Call method on direct parent class
     AbstractImmersedBoundaryForce<DIM>::OutputImmersedBoundaryForceParameters(rParamsFile);
@@ -149,6 +885,7 @@ template<unsigned int DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetRepulsionWellDepth(double repulsionWellDepth)
 {
     mRepulsionWellDepth = repulsionWellDepth;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
 }
 
 template<unsigned int DIM>
@@ -161,6 +898,7 @@ template<unsigned int DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetAdhesionAtoAWellDepth(double adhesionAtoAWellDepth)
 {
     mAdhesionAtoAWellDepth = adhesionAtoAWellDepth;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
 }
 
 template<unsigned int DIM>
@@ -173,6 +911,7 @@ template<unsigned int DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetAdhesionAtoBWellDepth(double adhesionAtoBWellDepth)
 {
     mAdhesionAtoBWellDepth = adhesionAtoBWellDepth;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
 }
 
 template<unsigned int DIM>
@@ -185,6 +924,7 @@ template<unsigned int DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetAdhesionBtoBWellDepth(double adhesionBtoBWellDepth)
 {
     mAdhesionBtoBWellDepth = adhesionBtoBWellDepth;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
 }
 
 template <unsigned DIM>
@@ -197,6 +937,7 @@ template <unsigned DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetRestLength(double restLength)
 {
     mRestLength = restLength;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
 }
 
 template <unsigned DIM>
@@ -209,6 +950,85 @@ template <unsigned DIM>
 void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetWellWidth(double wellWidth)
 {
     mWellWidth = wellWidth;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
+}
+
+template <unsigned DIM>
+unsigned ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::GetNumThreads() const
+{
+    return mNumThreads;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetNumThreads(unsigned numThreads)
+{
+    if (numThreads == 0u)
+    {
+        EXCEPTION("The number of threads must be at least 1.");
+    }
+    mNumThreads = numThreads;
+}
+
+template <unsigned DIM>
+bool ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::GetUseTabulatedPotential() const
+{
+    return mUseTabulatedPotential;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetUseTabulatedPotential(bool useTabulatedPotential)
+{
+    mUseTabulatedPotential = useTabulatedPotential;
+}
+
+template <unsigned DIM>
+double ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::GetTabulationTolerance() const
+{
+    return mTabulationTolerance;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetTabulationTolerance(double tabulationTolerance)
+{
+    if (tabulationTolerance <= 0.0)
+    {
+        EXCEPTION("The tabulation tolerance must be positive.");
+    }
+    mTabulationTolerance = tabulationTolerance;
+    mTabulatedInteractionDistance = DOUBLE_UNSET;
+}
+
+template <unsigned DIM>
+double ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::GetVerletSkin() const
+{
+    return mVerletSkin;
+}
+
+template <unsigned DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetVerletSkin(double verletSkin)
+{
+    if (verletSkin < 0.0)
+    {
+        EXCEPTION("The Verlet skin must be non-negative.");
+    }
+    mVerletSkin = verletSkin;
+    mVerletInteractionDistance = DOUBLE_UNSET;
+}
+
+template<unsigned int DIM>
+bool ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::GetUseDeviceOffload() const
+{
+    return mUseDeviceOffload;
+}
+
+template<unsigned int DIM>
+void ImmersedBoundaryMorseDifferentialAdhesionForce<DIM>::SetUseDeviceOffload(bool useDeviceOffload)
+{
+    if (useDeviceOffload && DIM != 2u)
+    {
+        EXCEPTION("Device offload is only available in 2D.");
+    }
+    mUseDeviceOffload = useDeviceOffload;
 }
 
 // Explicit instantiation
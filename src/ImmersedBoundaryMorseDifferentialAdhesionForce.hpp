@@ -38,13 +38,18 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/serialization/base_object.hpp>
 #include "ChasteSerialization.hpp"
+#include "ChasteSerializationVersion.hpp"
 #include "Exception.hpp"
 
 #include "AbstractImmersedBoundaryForce.hpp"
 #include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryGeometryCache.hpp"
+#include "ImmersedBoundaryNodePairList.hpp"
 #include "ImmersedBoundaryMesh.hpp"
 
+#include <array>
 #include <iostream>
+#include <memory>
 
 /**
  * A force class for use in immersed boundary simulations. This force implements Morse-potential-like links between
@@ -77,6 +82,16 @@ private:
         archive& mAdhesionBtoBWellDepth;
         archive& mRestLength;
         archive& mWellWidth;
+
+        // Archives of version 0 predate threading, tabulation, the Verlet list and offload, which keep their defaults
+        if (version > 0)
+        {
+            archive& mNumThreads;
+            archive& mUseTabulatedPotential;
+            archive& mTabulationTolerance;
+            archive& mVerletSkin;
+            archive& mUseDeviceOffload;
+        }
     }
 
     /** The basic interaction strength for interactions closer than the rest length */
@@ -97,6 +112,251 @@ private:
     /** The well width as a fraction of the cell population's interaction distance */
     double mWellWidth;
 
+    /**
+     * Per-element quantities needed by every interacting pair, gathered once each time step so that the pair loop
+     * does not need to query the cell population or the mesh.
+     */
+    struct ElementSnapshot
+    {
+        /** Whether the cell associated with the element has the CellLabel property */
+        bool mIsLabelled;
+
+        /** The average node spacing of the element */
+        double mNodeSpacing;
+
+        /** The ratio of the average node spacing of the element to the intrinsic spacing of the population */
+        double mSpacingRatio;
+    };
+
+    /** Snapshot of per-element data, indexed by element index and refreshed in UpdateElementSnapshot() */
+    std::vector<ElementSnapshot> mElementSnapshot;
+
+    /** The element geometry cache shared by all users of the mesh */
+    std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> mpGeometryCache;
+
+    /** The number of threads used to evaluate the pair loop.  Has no effect unless built with OpenMP. */
+    unsigned mNumThreads;
+
+    /** The interaction distance of the cell population, set every time step in AddImmersedBoundaryForceContribution() */
+    double mInteractionDistance;
+
+    /** The absolute rest length, set every time step in AddImmersedBoundaryForceContribution() */
+    double mEffectiveRestLength;
+
+    /** The absolute well width, set every time step in AddImmersedBoundaryForceContribution() */
+    double mEffectiveWellWidth;
+
+    /**
+     * Per-pair forces used by the multi-threaded pair loop: 2 * DIM entries per pair, holding the force on the first
+     * node followed by the force on the second.
+     */
+    std::vector<double> mPairForces;
+
+    /** Whether each pair in the multi-threaded pair loop interacts, and so whether its entry in mPairForces is set */
+    std::vector<char> mPairInteracts;
+
+    /** Whether to interpolate the Morse profile from mPotentialTable, rather than evaluating it directly */
+    bool mUseTabulatedPotential;
+
+    /** The maximum interpolation error of mPotentialTable, relative to the largest magnitude of the tabulated profile */
+    double mTabulationTolerance;
+
+    /**
+     * The Morse profile 2 * w * e * (1 - e), where e = exp((rest length - dist) / w) and w is the well width, at
+     * evenly spaced distances on [0, interaction distance].  The well depth multiplies this profile and is looked up
+     * separately in mWellDepthByClass.
+     */
+    std::vector<double> mPotentialTable;
+
+    /** The reciprocal of the distance between consecutive entries of mPotentialTable */
+    double mPotentialTableOneOverSpacing;
+
+    /** The well depth for each interaction class: repulsion, A-A, A-B and B-B, in that order */
+    std::array<double, 4> mWellDepthByClass;
+
+    /** The interaction distance for which mPotentialTable was built, or DOUBLE_UNSET if it must be rebuilt */
+    double mTabulatedInteractionDistance;
+
+    /**
+     * The Verlet skin, as an absolute distance.  If positive, the pairs closer than the interaction distance plus the
+     * skin are kept in mVerletPairs and reused until a node has moved more than half the skin.  Zero disables the
+     * Verlet list, and every pair in the population's list is checked every time step.
+     */
+    double mVerletSkin;
+
+    /** The pairs of nodes in different elements that were within the interaction distance plus the Verlet skin */
+    ImmersedBoundaryNodePairList<DIM> mVerletPairs;
+
+    /** The location of every node, DIM entries per node, gathered each time step for the Verlet pair loop */
+    std::vector<double> mNodeLocations;
+
+    /** The force on every node, DIM entries per node, accumulated by the Verlet pair loop */
+    std::vector<double> mNodeForces;
+
+    /** The location of every node, DIM entries per node, at the time mVerletPairs was built */
+    std::vector<double> mVerletReferenceLocations;
+
+    /** The nodes of the mesh, in index order, at the time mVerletPairs was built */
+    std::vector<Node<DIM>*> mVerletReferenceNodes;
+
+    /** The interaction distance for which mVerletPairs was built, or DOUBLE_UNSET if it must be rebuilt */
+    double mVerletInteractionDistance;
+
+    /** Whether to evaluate the Verlet pair loop on the default OpenMP target device, rather than on the host */
+    bool mUseDeviceOffload;
+
+    /** The arrays kept on the device by AddDeviceForceContribution(), defined with it */
+    struct DeviceState;
+
+    /** The device state, created on first use of the device */
+    std::unique_ptr<DeviceState> mpDeviceState;
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Refresh mElementSnapshot from the current state of the cell population.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateElementSnapshot(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Calculate the force between a pair of nodes.  This method does not modify any state, and so may be called
+     * concurrently for different pairs.
+     *
+     * @param rNodePair the pair of nodes
+     * @param rMesh the immersed boundary mesh
+     * @param rForceOnA filled with the force on the first node of the pair
+     * @param rForceOnB filled with the force on the second node of the pair
+     * @return whether the nodes interact; if not, the force vectors are left unset
+     */
+    bool CalculatePairForce(const std::pair<Node<DIM>*, Node<DIM>*>& rNodePair,
+                            ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+                            c_vector<double, DIM>& rForceOnA,
+                            c_vector<double, DIM>& rForceOnB) const;
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Evaluate pair forces concurrently into mPairForces, then apply them to the nodes serially in pair order.  The
+     * node forces are therefore bitwise identical to those of the single-threaded loop, for any number of threads.
+     *
+     * @param rNodePairs reference to a vector set of node pairs between which to contribute the force
+     * @param rMesh the immersed boundary mesh
+     */
+    void AddForceContributionMultiThreaded(std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+                                           ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Add the forces between the pairs of nodes in mVerletPairs.  Node locations are gathered into mNodeLocations,
+     * pair forces are evaluated one element pair at a time into mPairForces, concurrently if mNumThreads > 1, and
+     * then accumulated serially in pair order into mNodeForces, so the result does not depend on the number of
+     * threads.
+     *
+     * @param rMesh the immersed boundary mesh
+     */
+    void AddVerletForceContribution(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for AddVerletForceContribution().
+     *
+     * Calculate the forces between the pairs of nodes in one element pair into mPairForces and mPairInteracts.  The
+     * quantities that depend only on the two elements are calculated once for the whole range of pairs.  This
+     * method writes only to the entries of its own pairs, and so may be called concurrently for different element
+     * pairs.
+     *
+     * @param rElementPair the element pair
+     * @param rMesh the immersed boundary mesh
+     */
+    void CalculateElementPairForces(const typename ImmersedBoundaryNodePairList<DIM>::ElementPair& rElementPair,
+                                    ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for CalculateElementPairForces() and AddDeviceForceContribution().
+     *
+     * Calculate the quantities shared by every node pair of an element pair: the scale factors of the forces on the
+     * first and second nodes, and the repulsion and adhesion well depths.
+     *
+     * @param rElementPair the element pair
+     * @param pConstants filled with the four quantities, in that order
+     */
+    void CalculateElementPairConstants(const typename ImmersedBoundaryNodePairList<DIM>::ElementPair& rElementPair,
+                                       double* pConstants) const;
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Add the forces between the pairs of nodes in mVerletPairs, evaluated on the default OpenMP target device.  The
+     * pairs, and the table of any tabulated potential, stay on the device until they are rebuilt.  Each time step
+     * only the node locations and the element pair quantities are copied to the device, and only the accumulated
+     * node forces are copied back.  Each node sums its pair forces in pair order, as AddVerletForceContribution()
+     * does, so results match the host up to differences in the device's exp() and sqrt().  The periodic unit square
+     * is wrapped directly, so this is only used in 2D.
+     *
+     * @param rMesh the immersed boundary mesh
+     */
+    void AddDeviceForceContribution(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for CalculateElementPairForces().
+     *
+     * Calculate the vector between two node locations in mNodeLocations, as ImmersedBoundaryMesh::GetVectorFromAtoB()
+     * does.  The general case defers to the mesh; the specialisation for DIM=2 wraps on the periodic unit square
+     * directly with CalculatePeriodicDifference(), as the device kernel does, without the temporaries of the mesh
+     * method.
+     *
+     * @param pLocationA the DIM components of the location of the first node
+     * @param pLocationB the DIM components of the location of the second node
+     * @param rMesh the immersed boundary mesh
+     * @param pVecA2B filled with the DIM components of the vector from the first node to the second
+     */
+    void CalculateVectorFromAtoB(const double* pLocationA,
+                                 const double* pLocationB,
+                                 ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+                                 double* pVecA2B) const;
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Rebuild mVerletPairs from the population's node pairs if the interaction distance or the nodes, or their
+     * numbering, have changed since it was last built, or if any node has moved more than half the Verlet skin.  Until then, no pair
+     * missing from mVerletPairs can have come within the interaction distance.
+     *
+     * @param rNodePairs reference to the population's node pairs, which must include every pair of nodes within the
+     *     interaction distance plus the Verlet skin
+     * @param rMesh the immersed boundary mesh
+     */
+    void UpdateVerletPairsIfStale(const std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+                                  ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for AddImmersedBoundaryForceContribution().
+     *
+     * Rebuild mPotentialTable and mWellDepthByClass if a parameter, or the interaction distance, has changed since
+     * they were last built.  The table is refined until linear interpolation meets mTabulationTolerance.
+     */
+    void UpdatePotentialTableIfStale();
+
+    /**
+     * Evaluate the Morse profile 2 * w * e * (1 - e) directly.
+     *
+     * @param dist the distance between the nodes
+     * @return the profile at distance dist
+     */
+    double EvaluateMorseProfile(double dist) const;
+
+    /**
+     * Linearly interpolate the Morse profile from mPotentialTable.
+     *
+     * @param dist the distance between the nodes, which must lie in [0, interaction distance)
+     * @return the interpolated profile at distance dist
+     */
+    double InterpolateMorseProfile(double dist) const;
+
 public:
     /**
      * Constructor.
@@ -106,7 +366,7 @@ public:
     /**
      * Destructor.
      */
-    virtual ~ImmersedBoundaryMorseDifferentialAdhesionForce() = default;
+    virtual ~ImmersedBoundaryMorseDifferentialAdhesionForce();
 
     /**
      * Overridden AddImmersedBoundaryForceContribution() method.
@@ -161,9 +421,67 @@ public:
 
     /** @param wellWidth the new value of mWellWidth */
     void SetWellWidth(double wellWidth);
+
+    /** @return mNumThreads */
+    unsigned GetNumThreads() const;
+
+    /** @param numThreads the new value of mNumThreads; must be at least 1 */
+    void SetNumThreads(unsigned numThreads);
+
+    /** @return mUseTabulatedPotential */
+    bool GetUseTabulatedPotential() const;
+
+    /** @param useTabulatedPotential the new value of mUseTabulatedPotential */
+    void SetUseTabulatedPotential(bool useTabulatedPotential);
+
+    /** @return mTabulationTolerance */
+    double GetTabulationTolerance() const;
+
+    /** @param tabulationTolerance the new value of mTabulationTolerance; must be positive */
+    void SetTabulationTolerance(double tabulationTolerance);
+
+    /** @return mVerletSkin */
+    double GetVerletSkin() const;
+
+    /**
+     * Set the Verlet skin.  If positive, the mesh neighbour distance must be at least the interaction distance plus
+     * the skin, so that the population's node pairs include every pair the Verlet list may need.
+     *
+     * @param verletSkin the new value of mVerletSkin; must be non-negative
+     */
+    void SetVerletSkin(double verletSkin);
+
+    /** @return mUseDeviceOffload */
+    bool GetUseDeviceOffload() const;
+
+    /**
+     * Set whether to evaluate the Verlet pair loop on the default OpenMP target device.  This needs a positive
+     * Verlet skin, and is only available in 2D.  The host loop remains the reference.  Build with
+     * VertexIbComp_USE_OPENMP and offload flags for a device; otherwise OpenMP runs the device loop on the host.
+     *
+     * @param useDeviceOffload the new value of mUseDeviceOffload
+     */
+    void SetUseDeviceOffload(bool useDeviceOffload);
 };
 
 #include "SerializationExportWrapper.hpp"
 EXPORT_TEMPLATE_CLASS_SAME_DIMS(ImmersedBoundaryMorseDifferentialAdhesionForce)
 
+namespace boost
+{
+namespace serialization
+{
+/**
+ * Specify a version number for this templated class, as BOOST_CLASS_VERSION does not work for templates.
+ * Version 1 adds the number of threads, the tabulated potential, the Verlet skin and device offload.
+ */
+template<unsigned DIM>
+struct version<ImmersedBoundaryMorseDifferentialAdhesionForce<DIM> >
+{
+    /// Macro to set the version number of templated archive in known versions of Boost
+    CHASTE_VERSION_CONTENT(1);
+};
+} // namespace serialization
+} // namespace boost
+
 #endif /*IMMERSEDBOUNDARYMORSEDIFFERENTIALADHESIONFORCE_HPP_*/
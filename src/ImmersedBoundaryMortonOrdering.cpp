@@ -0,0 +1,123 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryMortonOrdering.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "Node.hpp"
+
+template<unsigned DIM>
+constexpr unsigned ImmersedBoundaryMortonOrdering<DIM>::BITS_PER_DIM;
+
+template<unsigned DIM>
+std::uint64_t ImmersedBoundaryMortonOrdering<DIM>::CalculateMortonCode(const c_vector<double, DIM>& rLocation)
+{
+    const std::uint64_t max_quantised = (std::uint64_t(1) << BITS_PER_DIM) - 1u;
+
+    std::uint64_t quantised[DIM];
+    for (unsigned dim = 0; dim < DIM; ++dim)
+    {
+        const double clamped = std::min(std::max(rLocation[dim], 0.0), 1.0);
+        quantised[dim] = std::min(static_cast<std::uint64_t>(clamped * (max_quantised + 1u)), max_quantised);
+    }
+
+    // Take one bit from each coordinate in turn, most significant first
+    std::uint64_t code = 0u;
+    for (unsigned bit = BITS_PER_DIM; bit-- > 0u;)
+    {
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            code = (code << 1u) | ((quantised[dim] >> bit) & 1u);
+        }
+    }
+
+    return code;
+}
+
+template<unsigned DIM>
+std::vector<unsigned> ImmersedBoundaryMortonOrdering<DIM>::CalculateOrdering(
+        const std::vector<c_vector<double, DIM>>& rLocations)
+{
+    std::vector<std::pair<std::uint64_t, unsigned>> codes(rLocations.size());
+    for (unsigned idx = 0; idx < rLocations.size(); ++idx)
+    {
+        codes[idx] = std::make_pair(CalculateMortonCode(rLocations[idx]), idx);
+    }
+
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<unsigned> ordering(codes.size());
+    for (unsigned idx = 0; idx < codes.size(); ++idx)
+    {
+        ordering[idx] = codes[idx].second;
+    }
+
+    return ordering;
+}
+
+template<unsigned DIM>
+bool ImmersedBoundaryMortonOrdering<DIM>::RenumberNodes(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    std::vector<Node<DIM>*>& r_nodes = rMesh.rGetNodes();
+
+    std::vector<c_vector<double, DIM>> locations;
+    locations.reserve(r_nodes.size());
+    for (const auto& p_node : r_nodes)
+    {
+        locations.emplace_back(p_node->rGetLocation());
+    }
+
+    const std::vector<unsigned> ordering = CalculateOrdering(locations);
+
+    std::vector<Node<DIM>*> renumbered_nodes(r_nodes.size());
+    bool any_renumbered = false;
+    for (unsigned new_idx = 0; new_idx < ordering.size(); ++new_idx)
+    {
+        renumbered_nodes[new_idx] = r_nodes[ordering[new_idx]];
+        renumbered_nodes[new_idx]->SetIndex(new_idx);
+        any_renumbered = any_renumbered || ordering[new_idx] != new_idx;
+    }
+
+    r_nodes.swap(renumbered_nodes);
+
+    return any_renumbered;
+}
+
+// Explicit instantiation
+template class ImmersedBoundaryMortonOrdering<1>;
+template class ImmersedBoundaryMortonOrdering<2>;
+template class ImmersedBoundaryMortonOrdering<3>;
@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYMORTONORDERING_HPP_
+#define IMMERSEDBOUNDARYMORTONORDERING_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "ImmersedBoundaryMesh.hpp"
+#include "UblasCustomFunctions.hpp"
+
+/**
+ * Ordering of points in an immersed boundary domain, the unit square or cube, along a Morton (Z-order) space-filling
+ * curve.  Points close together on the curve are close together in space, so numbering nodes in this order keeps
+ * nodes that interact, or that spread to the same fluid grid points, close together in memory.
+ */
+template<unsigned DIM>
+class ImmersedBoundaryMortonOrdering
+{
+public:
+
+    /** The number of bits per dimension in a Morton code */
+    static constexpr unsigned BITS_PER_DIM = DIM == 1u ? 32u : 64u / DIM;
+
+    /**
+     * @param rLocation a location, which is clamped to the unit square or cube
+     * @return the Morton code of rLocation, interleaving BITS_PER_DIM bits of each coordinate
+     */
+    static std::uint64_t CalculateMortonCode(const c_vector<double, DIM>& rLocation);
+
+    /**
+     * @param rLocations a set of locations
+     * @return the indices of rLocations in order of Morton code, with ties in order of index
+     */
+    static std::vector<unsigned> CalculateOrdering(const std::vector<c_vector<double, DIM>>& rLocations);
+
+    /**
+     * Renumber the nodes of a mesh in order of the Morton codes of their locations.  Elements and the order of nodes
+     * within each element are unchanged, as elements refer to their nodes by pointer; only the global node indices,
+     * and the order of rGetNodes(), change.  Anything holding node indices across the call must rebuild them.
+     *
+     * @param rMesh the mesh
+     * @return whether any node was renumbered
+     */
+    static bool RenumberNodes(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+};
+
+#endif /*IMMERSEDBOUNDARYMORTONORDERING_HPP_*/
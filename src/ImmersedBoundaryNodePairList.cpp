@@ -0,0 +1,115 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryNodePairList.hpp"
+
+#include <algorithm>
+
+template<unsigned DIM>
+void ImmersedBoundaryNodePairList<DIM>::Build(const std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+                                              ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+                                              double maxDist)
+{
+    assert(rMesh.GetNumLaminas() == 0u);
+
+    mScratch.clear();
+    for (const auto& node_pair : rNodePairs)
+    {
+        Node<DIM>* const p_node_a = node_pair.first;
+        Node<DIM>* const p_node_b = node_pair.second;
+
+        if (!rMesh.NodesInDifferentElementOrLamina(p_node_a, p_node_b) ||
+            norm_2(rMesh.GetVectorFromAtoB(p_node_a->rGetLocation(), p_node_b->rGetLocation())) >= maxDist)
+        {
+            continue;
+        }
+
+        const unsigned elem_a = *(p_node_a->ContainingElementsBegin());
+        const unsigned elem_b = *(p_node_b->ContainingElementsBegin());
+
+        if (elem_a < elem_b)
+        {
+            mScratch.push_back({{elem_a, elem_b, p_node_a->GetIndex(), p_node_b->GetIndex()}});
+        }
+        else
+        {
+            mScratch.push_back({{elem_b, elem_a, p_node_b->GetIndex(), p_node_a->GetIndex()}});
+        }
+    }
+
+    // Lexicographic order groups pairs by element pair, and fixes the order within each group
+    std::sort(mScratch.begin(), mScratch.end());
+
+    mNodePairs.resize(mScratch.size());
+    mElementPairs.clear();
+
+    for (unsigned pair_idx = 0; pair_idx < mScratch.size(); ++pair_idx)
+    {
+        const std::array<unsigned, 4>& r_entry = mScratch[pair_idx];
+        mNodePairs[pair_idx] = {r_entry[2], r_entry[3]};
+
+        if (mElementPairs.empty() || mElementPairs.back().mElemA != r_entry[0] || mElementPairs.back().mElemB != r_entry[1])
+        {
+            mElementPairs.push_back({r_entry[0], r_entry[1], pair_idx, pair_idx});
+        }
+        mElementPairs.back().mEndNodePair = pair_idx + 1u;
+    }
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryNodePairList<DIM>::Clear()
+{
+    mNodePairs.clear();
+    mElementPairs.clear();
+}
+
+template<unsigned DIM>
+const std::vector<typename ImmersedBoundaryNodePairList<DIM>::NodePair>&
+ImmersedBoundaryNodePairList<DIM>::rGetNodePairs() const
+{
+    return mNodePairs;
+}
+
+template<unsigned DIM>
+const std::vector<typename ImmersedBoundaryNodePairList<DIM>::ElementPair>&
+ImmersedBoundaryNodePairList<DIM>::rGetElementPairs() const
+{
+    return mElementPairs;
+}
+
+// Explicit instantiation
+template class ImmersedBoundaryNodePairList<1>;
+template class ImmersedBoundaryNodePairList<2>;
+template class ImmersedBoundaryNodePairList<3>;
@@ -0,0 +1,122 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYNODEPAIRLIST_HPP_
+#define IMMERSEDBOUNDARYNODEPAIRLIST_HPP_
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "ImmersedBoundaryMesh.hpp"
+#include "Node.hpp"
+
+/**
+ * A compact list of interacting node pairs in an immersed boundary mesh, for force classes that visit the same pairs
+ * over many time steps.
+ *
+ * Pairs are stored as 32-bit node indices rather than Node pointers, with pairs of nodes in the same element removed,
+ * and sorted by the indices of their elements.  Pairs sharing the same two elements are contiguous and described by
+ * an ElementPair, so that per-element quantities can be looked up once for each pair of elements rather than for
+ * each pair of nodes.  Within each pair, the node in the element with the lower index comes first.
+ *
+ * We assume the mesh has no laminas and each node is in exactly one element, as in the force classes that use it.
+ */
+template<unsigned DIM>
+class ImmersedBoundaryNodePairList
+{
+public:
+
+    /** A pair of nodes, by global node index */
+    struct NodePair
+    {
+        /** The index of the node in the element with the lower index */
+        unsigned mNodeA;
+
+        /** The index of the node in the element with the higher index */
+        unsigned mNodeB;
+    };
+
+    /** A contiguous range of node pairs whose nodes are in the same two elements */
+    struct ElementPair
+    {
+        /** The lower of the two element indices */
+        unsigned mElemA;
+
+        /** The higher of the two element indices */
+        unsigned mElemB;
+
+        /** The index in rGetNodePairs() of the first node pair in the range */
+        unsigned mFirstNodePair;
+
+        /** One past the index in rGetNodePairs() of the last node pair in the range */
+        unsigned mEndNodePair;
+    };
+
+private:
+
+    /** The node pairs, sorted by element pair and then by node indices */
+    std::vector<NodePair> mNodePairs;
+
+    /** The element pairs, in the same order as mNodePairs */
+    std::vector<ElementPair> mElementPairs;
+
+    /** Scratch storage for Build(): each pair's element indices followed by its node indices */
+    std::vector<std::array<unsigned, 4>> mScratch;
+
+public:
+
+    /**
+     * Rebuild the list from the node pairs of a cell population.
+     *
+     * @param rNodePairs the population's node pairs
+     * @param rMesh the immersed boundary mesh
+     * @param maxDist only pairs of nodes closer than this distance are kept
+     */
+    void Build(const std::vector<std::pair<Node<DIM>*, Node<DIM>*> >& rNodePairs,
+               ImmersedBoundaryMesh<DIM, DIM>& rMesh,
+               double maxDist);
+
+    /** Remove all pairs. */
+    void Clear();
+
+    /** @return the node pairs, sorted by element pair */
+    const std::vector<NodePair>& rGetNodePairs() const;
+
+    /** @return the element pairs, each describing a contiguous range of rGetNodePairs() */
+    const std::vector<ElementPair>& rGetElementPairs() const;
+};
+
+#endif /*IMMERSEDBOUNDARYNODEPAIRLIST_HPP_*/
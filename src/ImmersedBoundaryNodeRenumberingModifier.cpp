@@ -0,0 +1,102 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryNodeRenumberingModifier.hpp"
+
+#include "Exception.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryMortonOrdering.hpp"
+#include "SimulationTime.hpp"
+
+template<unsigned DIM>
+void ImmersedBoundaryNodeRenumberingModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    auto& r_population = static_cast<ImmersedBoundaryCellPopulation<DIM>&>(rCellPopulation);
+    const unsigned interval = mRenumberingInterval > 0u ? mRenumberingInterval : r_population.GetReMeshFrequency();
+
+    if (interval > 0u && SimulationTime::Instance()->GetTimeStepsElapsed() % interval == 0u)
+    {
+        RenumberNodes(rCellPopulation);
+    }
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryNodeRenumberingModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    if (dynamic_cast<ImmersedBoundaryCellPopulation<DIM>*>(&rCellPopulation) == nullptr)
+    {
+        EXCEPTION("This modifier is only for use with Immersed Boundary cell populations.");
+    }
+
+    RenumberNodes(rCellPopulation);
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryNodeRenumberingModifier<DIM>::RenumberNodes(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    // Element geometry, and so the shared geometry cache, does not depend on node numbering
+    ImmersedBoundaryMortonOrdering<DIM>::RenumberNodes(
+            static_cast<ImmersedBoundaryCellPopulation<DIM>&>(rCellPopulation).rGetMesh());
+}
+
+template<unsigned DIM>
+unsigned ImmersedBoundaryNodeRenumberingModifier<DIM>::GetRenumberingInterval() const noexcept
+{
+    return mRenumberingInterval;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryNodeRenumberingModifier<DIM>::SetRenumberingInterval(unsigned renumberingInterval) noexcept
+{
+    mRenumberingInterval = renumberingInterval;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryNodeRenumberingModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<RenumberingInterval>" << mRenumberingInterval << "</RenumberingInterval>\n";
+
+    // Next, call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class ImmersedBoundaryNodeRenumberingModifier<1>;
+template class ImmersedBoundaryNodeRenumberingModifier<2>;
+template class ImmersedBoundaryNodeRenumberingModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ImmersedBoundaryNodeRenumberingModifier)
@@ -0,0 +1,131 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYNODERENUMBERINGMODIFIER_HPP_
+#define IMMERSEDBOUNDARYNODERENUMBERINGMODIFIER_HPP_
+
+#include <boost/serialization/base_object.hpp>
+#include "ChasteSerialization.hpp"
+
+#include <string>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier class that renumbers the nodes of an immersed boundary cell population along a Morton space-filling
+ * curve (see ImmersedBoundaryMortonOrdering), before the first time step and then after every remesh.
+ *
+ * Nodes drift away from the positions they were numbered at, and remeshing keeps each node's index, so renumbering
+ * at the remesh frequency keeps spatially adjacent nodes close together in memory.  Elements, and so the mapping
+ * between cells and elements, are unchanged.
+ */
+template<unsigned DIM>
+class ImmersedBoundaryNodeRenumberingModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mRenumberingInterval;
+    }
+
+protected:
+
+    /**
+     * The number of time steps between renumberings, or zero to renumber at the remesh frequency of the population.
+     * Nothing is renumbered after the first time step if this is zero and the population does not remesh.
+     */
+    unsigned mRenumberingInterval = 0u;
+
+    /**
+     * Helper method to renumber the nodes of the population's mesh.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void RenumberNodes(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+public:
+
+    /** Default constructor */
+    ImmersedBoundaryNodeRenumberingModifier() = default;
+
+    /** Default destructor */
+    virtual ~ImmersedBoundaryNodeRenumberingModifier() = default;
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     * Specify what to do in the simulation at the end of each time step.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     * Specify what to do in the simulation before the start of the time loop.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /** @return mRenumberingInterval */
+    unsigned GetRenumberingInterval() const noexcept;
+
+    /** @param renumberingInterval the new value of mRenumberingInterval; zero follows the remesh frequency */
+    void SetRenumberingInterval(unsigned renumberingInterval) noexcept;
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ImmersedBoundaryNodeRenumberingModifier)
+
+#endif /*IMMERSEDBOUNDARYNODERENUMBERINGMODIFIER_HPP_*/
@@ -0,0 +1,70 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef IMMERSEDBOUNDARYPERIODICDIFFERENCE_HPP_
+#define IMMERSEDBOUNDARYPERIODICDIFFERENCE_HPP_
+
+#include <cassert>
+
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+
+/**
+ * Calculate one component of the vector between two node locations, as ImmersedBoundaryMesh::GetVectorFromAtoB()
+ * does, for the kernels of force classes that work on plain arrays of coordinates, on the host or on an OpenMP target
+ * device.
+ *
+ * The immersed boundary domain is periodic on the unit square, and every node location lies within it, so the
+ * difference of two coordinates is less than one in magnitude and a single wrap gives its image closest to zero.
+ *
+ * @param coordA the coordinate of the first node
+ * @param coordB the same coordinate of the second node
+ * @return the component of the vector from the first node to the second
+ */
+inline double CalculatePeriodicDifference(double coordA, double coordB)
+{
+    assert(coordA >= 0.0 && coordA <= 1.0 && coordB >= 0.0 && coordB <= 1.0);
+
+    const double diff = coordB - coordA;
+    return diff > 0.5 ? diff - 1.0 : (diff < -0.5 ? diff + 1.0 : diff);
+}
+
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
+
+#endif /*IMMERSEDBOUNDARYPERIODICDIFFERENCE_HPP_*/
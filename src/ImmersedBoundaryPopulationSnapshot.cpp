@@ -0,0 +1,235 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryPopulationSnapshot.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryGeometryCache.hpp"
+
+template<unsigned DIM>
+ImmersedBoundaryPopulationSnapshot<DIM>::ImmersedBoundaryPopulationSnapshot(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation)
+{
+    Capture(rCellPopulation);
+}
+
+template<unsigned DIM>
+unsigned ImmersedBoundaryPopulationSnapshot<DIM>::GetSnapshotIndex(unsigned cellId) const
+{
+    const auto it = std::lower_bound(mCellIds.begin(), mCellIds.end(), cellId);
+    return it != mCellIds.end() && *it == cellId ? static_cast<unsigned>(it - mCellIds.begin()) : mCellIds.size();
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryPopulationSnapshot<DIM>::Capture(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation)
+{
+    ImmersedBoundaryMesh<DIM, DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    if (r_mesh.GetNumLaminas() > 0u)
+    {
+        EXCEPTION("Cannot take a snapshot of a population whose mesh has laminas.");
+    }
+
+    // Cells are stored in order of ID, so that they can be found again whatever elements they are then associated with
+    std::vector<std::pair<unsigned, CellPtr>> cells_by_id;
+    cells_by_id.reserve(rCellPopulation.rGetCells().size());
+    for (const CellPtr& rp_cell : rCellPopulation.rGetCells())
+    {
+        cells_by_id.emplace_back(rp_cell->GetCellId(), rp_cell);
+    }
+    std::sort(cells_by_id.begin(), cells_by_id.end(),
+              [](const std::pair<unsigned, CellPtr>& rA, const std::pair<unsigned, CellPtr>& rB)
+              {
+                  return rA.first < rB.first;
+              });
+
+    const unsigned num_cells = cells_by_id.size();
+    mCellIds.resize(num_cells);
+    mElementNodeOffsets.assign(1u, 0u);
+    mElementNodeOffsets.reserve(num_cells + 1u);
+    mNodeLocations.clear();
+    mNodeLocations.reserve(DIM * r_mesh.GetNumNodes());
+    mCellDataKeys.resize(num_cells);
+    mCellDataValues.resize(num_cells);
+    mCellIsLabelled.resize(num_cells);
+    for (unsigned snapshot_idx = 0; snapshot_idx < num_cells; ++snapshot_idx)
+    {
+        const CellPtr& rp_cell = cells_by_id[snapshot_idx].second;
+        mCellIds[snapshot_idx] = cells_by_id[snapshot_idx].first;
+
+        // The element's nodes, in its own order, which renumbering either nodes or elements leaves unchanged
+        const unsigned elem_idx = rCellPopulation.GetLocationIndexUsingCell(rp_cell);
+        ImmersedBoundaryElement<DIM, DIM>* p_elem = r_mesh.GetElement(elem_idx);
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+        {
+            const c_vector<double, DIM>& r_location = p_elem->GetNode(local_idx)->rGetLocation();
+            mNodeLocations.insert(mNodeLocations.end(), r_location.begin(), r_location.end());
+        }
+        mElementNodeOffsets.emplace_back(mNodeLocations.size() / DIM);
+
+        const boost::shared_ptr<CellData> p_cell_data = rp_cell->GetCellData();
+        mCellDataKeys[snapshot_idx] = p_cell_data->GetKeys();
+        mCellDataValues[snapshot_idx].resize(mCellDataKeys[snapshot_idx].size());
+        for (unsigned key_idx = 0; key_idx < mCellDataKeys[snapshot_idx].size(); ++key_idx)
+        {
+            mCellDataValues[snapshot_idx][key_idx] = p_cell_data->GetItem(mCellDataKeys[snapshot_idx][key_idx]);
+        }
+
+        mCellIsLabelled[snapshot_idx] = rp_cell->HasCellProperty<CellLabel>();
+    }
+
+    const boost::multi_array<double, 3>& r_grids = r_mesh.rGet2dVelocityGrids();
+    mVelocityGrids.resize(boost::extents[r_grids.shape()[0]][r_grids.shape()[1]][r_grids.shape()[2]]);
+    mVelocityGrids = r_grids;
+
+    auto CaptureSources = [](const std::vector<FluidSource<DIM>*>& rSources,
+                             std::vector<double>& rLocations,
+                             std::vector<double>& rStrengths)
+    {
+        rLocations.resize(DIM * rSources.size());
+        rStrengths.resize(rSources.size());
+        for (unsigned source_idx = 0; source_idx < rSources.size(); ++source_idx)
+        {
+            const c_vector<double, DIM>& r_location = rSources[source_idx]->rGetLocation();
+            std::copy(r_location.begin(), r_location.end(), rLocations.begin() + DIM * source_idx);
+            rStrengths[source_idx] = rSources[source_idx]->GetStrength();
+        }
+    };
+    CaptureSources(r_mesh.rGetElementFluidSources(), mElementSourceLocations, mElementSourceStrengths);
+    CaptureSources(r_mesh.rGetBalancingFluidSources(), mBalancingSourceLocations, mBalancingSourceStrengths);
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryPopulationSnapshot<DIM>::Restore(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation) const
+{
+    ImmersedBoundaryMesh<DIM, DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    if (rCellPopulation.rGetCells().size() != mCellIds.size() ||
+        DIM * r_mesh.GetNumNodes() != mNodeLocations.size() ||
+        r_mesh.rGetElementFluidSources().size() != mElementSourceStrengths.size() ||
+        r_mesh.rGetBalancingFluidSources().size() != mBalancingSourceStrengths.size())
+    {
+        EXCEPTION("Cannot restore a snapshot into a population with a different mesh structure.");
+    }
+
+    boost::multi_array<double, 3>& r_grids = r_mesh.rGetModifiable2dVelocityGrids();
+    if (!std::equal(mVelocityGrids.shape(), mVelocityGrids.shape() + 3, r_grids.shape()))
+    {
+        EXCEPTION("Cannot restore a snapshot into a population with a different fluid grid.");
+    }
+
+    // Check every cell before changing anything, so that a mismatched population is left as it was
+    std::vector<std::pair<CellPtr, unsigned>> cells_with_snapshot_idx;
+    cells_with_snapshot_idx.reserve(mCellIds.size());
+    for (const CellPtr& rp_cell : rCellPopulation.rGetCells())
+    {
+        const unsigned snapshot_idx = GetSnapshotIndex(rp_cell->GetCellId());
+        if (snapshot_idx == mCellIds.size())
+        {
+            EXCEPTION("Cannot restore a snapshot into a population with cell " + std::to_string(rp_cell->GetCellId()) +
+                      ", which is not in the snapshot.");
+        }
+
+        const unsigned elem_idx = rCellPopulation.GetLocationIndexUsingCell(rp_cell);
+        const unsigned num_nodes = mElementNodeOffsets[snapshot_idx + 1u] - mElementNodeOffsets[snapshot_idx];
+        if (r_mesh.GetElement(elem_idx)->GetNumNodes() != num_nodes)
+        {
+            EXCEPTION("Cannot restore a snapshot into a population in which the element of cell " +
+                      std::to_string(rp_cell->GetCellId()) + " has a different number of nodes.");
+        }
+        cells_with_snapshot_idx.emplace_back(rp_cell, snapshot_idx);
+    }
+
+    // The registry is cleared between runs in a sweep, so look up the label afresh each time
+    boost::shared_ptr<AbstractCellProperty> p_label = CellPropertyRegistry::Instance()->Get<CellLabel>();
+
+    for (const auto& r_cell_with_snapshot_idx : cells_with_snapshot_idx)
+    {
+        const CellPtr& rp_cell = r_cell_with_snapshot_idx.first;
+        const unsigned snapshot_idx = r_cell_with_snapshot_idx.second;
+
+        const unsigned elem_idx = rCellPopulation.GetLocationIndexUsingCell(rp_cell);
+        ImmersedBoundaryElement<DIM, DIM>* p_elem = r_mesh.GetElement(elem_idx);
+        const double* p_location = mNodeLocations.data() + DIM * mElementNodeOffsets[snapshot_idx];
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx, p_location += DIM)
+        {
+            std::copy(p_location, p_location + DIM, p_elem->GetNode(local_idx)->rGetModifiableLocation().begin());
+        }
+
+        const boost::shared_ptr<CellData> p_cell_data = rp_cell->GetCellData();
+        for (unsigned key_idx = 0; key_idx < mCellDataKeys[snapshot_idx].size(); ++key_idx)
+        {
+            p_cell_data->SetItem(mCellDataKeys[snapshot_idx][key_idx], mCellDataValues[snapshot_idx][key_idx]);
+        }
+
+        if (rp_cell->HasCellProperty<CellLabel>())
+        {
+            rp_cell->RemoveCellProperty<CellLabel>();
+        }
+        if (mCellIsLabelled[snapshot_idx])
+        {
+            rp_cell->AddCellProperty(p_label);
+        }
+    }
+
+    std::copy(mVelocityGrids.data(), mVelocityGrids.data() + mVelocityGrids.num_elements(), r_grids.data());
+
+    auto RestoreSources = [](std::vector<FluidSource<DIM>*>& rSources,
+                             const std::vector<double>& rLocations,
+                             const std::vector<double>& rStrengths)
+    {
+        for (unsigned source_idx = 0; source_idx < rSources.size(); ++source_idx)
+        {
+            c_vector<double, DIM>& r_location = rSources[source_idx]->rGetModifiableLocation();
+            std::copy(rLocations.begin() + DIM * source_idx, rLocations.begin() + DIM * (source_idx + 1u), r_location.begin());
+            rSources[source_idx]->SetStrength(rStrengths[source_idx]);
+        }
+    };
+    RestoreSources(r_mesh.rGetElementFluidSources(), mElementSourceLocations, mElementSourceStrengths);
+    RestoreSources(r_mesh.rGetBalancingFluidSources(), mBalancingSourceLocations, mBalancingSourceStrengths);
+
+    // Geometry cached for the current time step no longer matches the node locations
+    ImmersedBoundaryGeometryCache<DIM>::GetForMesh(r_mesh)->Invalidate();
+}
+
+// Explicit instantiation
+template class ImmersedBoundaryPopulationSnapshot<1>;
+template class ImmersedBoundaryPopulationSnapshot<2>;
+template class ImmersedBoundaryPopulationSnapshot<3>;
@@ -0,0 +1,133 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_
+#define IMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/multi_array.hpp>
+
+#include "ImmersedBoundaryCellPopulation.hpp"
+
+/**
+ * A snapshot of the mutable state of an immersed boundary cell population: node locations, fluid velocity grids,
+ * fluid source locations and strengths, and the cell data and label of each cell.
+ *
+ * A sweep that only changes noise parameters or seeds can generate its mesh and population once, take a snapshot,
+ * and restore it before each run instead of reconstructing everything.  Restoring copies flat arrays straight back
+ * into the existing nodes, grids and cells, so the population must have the same cells, each with the same number of
+ * nodes in its element, as when the snapshot was taken.  State is matched by cell ID, and node locations by position
+ * within each cell's element, rather than by index, so a snapshot can be restored after nodes or elements have been
+ * renumbered, for instance by ImmersedBoundaryNodeRenumberingModifier.  Fluid sources are matched by index, as
+ * nothing renumbers them.  Singletons such as SimulationTime and RandomNumberGenerator are not captured; reset these
+ * as usual between runs.
+ */
+template<unsigned DIM>
+class ImmersedBoundaryPopulationSnapshot
+{
+private:
+
+    /** The ID of each cell in the snapshot, in increasing order */
+    std::vector<unsigned> mCellIds;
+
+    /**
+     * The offset in mNodeLocations, divided by DIM, of the nodes of the element of each cell, in the order of
+     * mCellIds, with one more entry than there are cells
+     */
+    std::vector<unsigned> mElementNodeOffsets;
+
+    /** The location of each node of the element of each cell, in the order of the element's nodes, DIM at a time */
+    std::vector<double> mNodeLocations;
+
+    /** The fluid velocity grids */
+    boost::multi_array<double, 3> mVelocityGrids;
+
+    /** The location of each element fluid source, DIM components at a time */
+    std::vector<double> mElementSourceLocations;
+
+    /** The strength of each element fluid source */
+    std::vector<double> mElementSourceStrengths;
+
+    /** The location of each balancing fluid source, DIM components at a time */
+    std::vector<double> mBalancingSourceLocations;
+
+    /** The strength of each balancing fluid source */
+    std::vector<double> mBalancingSourceStrengths;
+
+    /** The cell data keys of each cell, in the order of mCellIds */
+    std::vector<std::vector<std::string>> mCellDataKeys;
+
+    /** The cell data values of each cell, in the order of mCellIds and then of mCellDataKeys */
+    std::vector<std::vector<double>> mCellDataValues;
+
+    /** Whether each cell, in the order of mCellIds, has a CellLabel */
+    std::vector<char> mCellIsLabelled;
+
+    /**
+     * @param cellId the ID of a cell
+     * @return the position of the cell in mCellIds, or mCellIds.size() if it is not in the snapshot
+     */
+    unsigned GetSnapshotIndex(unsigned cellId) const;
+
+public:
+
+    /**
+     * Constructor.  Take a snapshot of the current state of a population.
+     *
+     * @param rCellPopulation the population to take a snapshot of
+     */
+    explicit ImmersedBoundaryPopulationSnapshot(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Overwrite the stored state with the current state of a population.  The mesh must not have laminas, whose
+     * nodes belong to no cell.
+     *
+     * @param rCellPopulation the population to take a snapshot of
+     */
+    void Capture(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Restore the stored state into a population.  This is the population the snapshot was taken of, or one with the
+     * same cells, each of whose element has as many nodes as when the snapshot was taken, and the same fluid grid and
+     * sources.  Nodes and elements may have been renumbered in between.
+     *
+     * @param rCellPopulation the population to restore
+     */
+    void Restore(ImmersedBoundaryCellPopulation<DIM>& rCellPopulation) const;
+};
+
+#endif /*IMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_*/
@@ -0,0 +1,212 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ImmersedBoundaryProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+#include "OutputFileHandler.hpp"
+
+namespace
+{
+
+/** The records of one thread, looked up by name pointer as names are string literals */
+struct ThreadRecords
+{
+    /** Guards mRecords against being read while the owning thread writes to it */
+    std::mutex mMutex;
+
+    /** The records, in order of first use */
+    std::vector<ImmersedBoundaryProfiler::Record> mRecords;
+};
+
+/** Guards gAllThreadRecords */
+std::mutex gAllThreadRecordsMutex;
+
+/** The records of every thread that has used the profiler, which outlive the threads */
+std::vector<std::unique_ptr<ThreadRecords>> gAllThreadRecords;
+
+/** @return the records of the calling thread, registering them on first use */
+ThreadRecords& rGetThreadRecords()
+{
+    thread_local ThreadRecords* p_records = nullptr;
+    if (p_records == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(gAllThreadRecordsMutex);
+        gAllThreadRecords.emplace_back(new ThreadRecords());
+        p_records = gAllThreadRecords.back().get();
+    }
+    return *p_records;
+}
+
+/**
+ * @param rString a string
+ * @return rString with any double quotes and backslashes escaped, for JSON output
+ */
+std::string EscapeForJson(const std::string& rString)
+{
+    std::string escaped;
+    for (const char c : rString)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+ImmersedBoundaryProfiler::ScopedTimer::ScopedTimer(const char* pName)
+        : mpName(pName),
+          mStart(std::chrono::steady_clock::now()),
+          mNumPairs(0u),
+          mNumNodes(0u)
+{
+}
+
+ImmersedBoundaryProfiler::ScopedTimer::~ScopedTimer()
+{
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+    AddToRecord(mpName, elapsed.count(), mNumPairs, mNumNodes);
+}
+
+void ImmersedBoundaryProfiler::ScopedTimer::AddPairs(std::size_t numPairs)
+{
+    mNumPairs += numPairs;
+}
+
+void ImmersedBoundaryProfiler::ScopedTimer::AddNodes(std::size_t numNodes)
+{
+    mNumNodes += numNodes;
+}
+
+void ImmersedBoundaryProfiler::AddToRecord(const char* pName, double wallTime, std::size_t numPairs, std::size_t numNodes)
+{
+    ThreadRecords& r_thread_records = rGetThreadRecords();
+
+    // Uncontended except while the records are read or reset
+    std::lock_guard<std::mutex> lock(r_thread_records.mMutex);
+
+    std::vector<Record>& r_records = r_thread_records.mRecords;
+    auto record_it = std::find_if(r_records.begin(), r_records.end(),
+                                  [pName](const Record& rRecord) { return rRecord.mName == pName; });
+    if (record_it == r_records.end())
+    {
+        r_records.push_back({pName, 0u, 0.0, 0u, 0u});
+        record_it = r_records.end() - 1;
+    }
+
+    record_it->mNumCalls += 1u;
+    record_it->mWallTime += wallTime;
+    record_it->mNumPairs += numPairs;
+    record_it->mNumNodes += numNodes;
+}
+
+void ImmersedBoundaryProfiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(gAllThreadRecordsMutex);
+    for (auto& p_thread_records : gAllThreadRecords)
+    {
+        std::lock_guard<std::mutex> thread_lock(p_thread_records->mMutex);
+        p_thread_records->mRecords.clear();
+    }
+}
+
+std::vector<ImmersedBoundaryProfiler::Record> ImmersedBoundaryProfiler::GetRecords()
+{
+    std::vector<Record> merged;
+
+    std::lock_guard<std::mutex> lock(gAllThreadRecordsMutex);
+    for (auto& p_thread_records : gAllThreadRecords)
+    {
+        std::lock_guard<std::mutex> thread_lock(p_thread_records->mMutex);
+        for (const Record& r_record : p_thread_records->mRecords)
+        {
+            // The same literal may have different addresses in different translation units, so merge by content
+            auto merged_it = std::find_if(merged.begin(), merged.end(), [&r_record](const Record& rMerged)
+                                          { return std::strcmp(rMerged.mName, r_record.mName) == 0; });
+            if (merged_it == merged.end())
+            {
+                merged.push_back(r_record);
+            }
+            else
+            {
+                merged_it->mNumCalls += r_record.mNumCalls;
+                merged_it->mWallTime += r_record.mWallTime;
+                merged_it->mNumPairs += r_record.mNumPairs;
+                merged_it->mNumNodes += r_record.mNumNodes;
+            }
+        }
+    }
+
+    std::sort(merged.begin(), merged.end(), [](const Record& rA, const Record& rB)
+              { return std::strcmp(rA.mName, rB.mName) < 0; });
+
+    return merged;
+}
+
+void ImmersedBoundaryProfiler::WriteSummary(const std::string& rDirectory, const std::string& rFileName)
+{
+    const std::vector<Record> records = GetRecords();
+
+    OutputFileHandler output_file_handler(rDirectory, false);
+    out_stream p_file = output_file_handler.OpenOutputFile(rFileName);
+
+    *p_file << std::setprecision(9) << "{\n";
+    *p_file << "  \"enabled\": " << (IsEnabled() ? "true" : "false") << ",\n";
+    *p_file << "  \"records\": [";
+    for (unsigned record_idx = 0; record_idx < records.size(); ++record_idx)
+    {
+        const Record& r_record = records[record_idx];
+        *p_file << (record_idx == 0u ? "\n" : ",\n");
+        *p_file << "    {\"name\": \"" << EscapeForJson(r_record.mName) << "\", "
+                << "\"calls\": " << r_record.mNumCalls << ", "
+                << "\"wall_time_s\": " << r_record.mWallTime << ", "
+                << "\"mean_wall_time_s\": " << r_record.mWallTime / r_record.mNumCalls << ", "
+                << "\"pairs\": " << r_record.mNumPairs << ", "
+                << "\"nodes\": " << r_record.mNumNodes << "}";
+    }
+    *p_file << (records.empty() ? "]\n" : "\n  ]\n");
+    *p_file << "}\n";
+
+    p_file->close();
+}
@@ -0,0 +1,163 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYPROFILER_HPP_
+#define IMMERSEDBOUNDARYPROFILER_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Low-overhead timing of the force classes and modifiers of immersed boundary simulations.
+ *
+ * Code is instrumented with the IB_PROFILE_* macros below, which only do anything if the project is built with the
+ * VertexIbComp_USE_PROFILING CMake option (defining VERTEXIBCOMP_USE_PROFILING); otherwise they expand to nothing
+ * and their arguments are not evaluated.  Each thread accumulates into its own records, so timers may be used inside
+ * parallel regions without contention, and the records of all threads are merged by name on output.
+ *
+ * For each name, the number of calls, the total wall time, and the numbers of node pairs and nodes processed are
+ * recorded.  ImmersedBoundaryProfilingModifier resets the records before a simulation and writes them, with the total
+ * time step duration, as a JSON summary in the output directory after it.
+ */
+class ImmersedBoundaryProfiler
+{
+public:
+
+    /** The accumulated timings for one name */
+    struct Record
+    {
+        /** The name of the timed code, which must be a string literal */
+        const char* mName;
+
+        /** The number of times the code was timed */
+        unsigned long long mNumCalls;
+
+        /** The total wall time, in seconds */
+        double mWallTime;
+
+        /** The total number of node pairs processed */
+        unsigned long long mNumPairs;
+
+        /** The total number of nodes processed */
+        unsigned long long mNumNodes;
+    };
+
+    /** A timer that adds to the record for its name when it goes out of scope */
+    class ScopedTimer
+    {
+    private:
+
+        /** The name of the timed code */
+        const char* mpName;
+
+        /** When the timer was created */
+        std::chrono::steady_clock::time_point mStart;
+
+        /** The number of node pairs processed so far */
+        std::size_t mNumPairs;
+
+        /** The number of nodes processed so far */
+        std::size_t mNumNodes;
+
+    public:
+
+        /**
+         * Constructor.  Start timing.
+         *
+         * @param pName the name of the timed code, which must be a string literal
+         */
+        explicit ScopedTimer(const char* pName);
+
+        /** Destructor.  Stop timing, and add to the record for the name. */
+        ~ScopedTimer();
+
+        /** @param numPairs the number of node pairs processed, added to the total */
+        void AddPairs(std::size_t numPairs);
+
+        /** @param numNodes the number of nodes processed, added to the total */
+        void AddNodes(std::size_t numNodes);
+    };
+
+    /**
+     * Add to the record for a name on the calling thread, for intervals that ScopedTimer cannot cover.
+     *
+     * @param pName the name of the timed code, which must be a string literal
+     * @param wallTime the wall time, in seconds
+     * @param numPairs the number of node pairs processed
+     * @param numNodes the number of nodes processed
+     */
+    static void AddToRecord(const char* pName, double wallTime, std::size_t numPairs, std::size_t numNodes);
+
+    /** Clear the records of every thread.  No timer may be running. */
+    static void Reset();
+
+    /** @return the records of every thread, merged by name and sorted by name */
+    static std::vector<Record> GetRecords();
+
+    /**
+     * Write the merged records as JSON.
+     *
+     * @param rDirectory the output directory, relative to $CHASTE_TEST_OUTPUT; it is not cleaned
+     * @param rFileName the name of the file to write in rDirectory
+     */
+    static void WriteSummary(const std::string& rDirectory, const std::string& rFileName="ib_timing_summary.json");
+
+    /** @return whether the project was built with profiling enabled */
+    static constexpr bool IsEnabled()
+    {
+#ifdef VERTEXIBCOMP_USE_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+#ifdef VERTEXIBCOMP_USE_PROFILING
+/** Time the rest of the enclosing scope with a ScopedTimer called TIMER, under NAME */
+#define IB_PROFILE_SCOPE(TIMER, NAME) ImmersedBoundaryProfiler::ScopedTimer TIMER(NAME)
+/** Add NUM to the node pairs processed by the ScopedTimer called TIMER */
+#define IB_PROFILE_ADD_PAIRS(TIMER, NUM) TIMER.AddPairs(NUM)
+/** Add NUM to the nodes processed by the ScopedTimer called TIMER */
+#define IB_PROFILE_ADD_NODES(TIMER, NUM) TIMER.AddNodes(NUM)
+#else
+#define IB_PROFILE_SCOPE(TIMER, NAME) static_cast<void>(0)
+#define IB_PROFILE_ADD_PAIRS(TIMER, NUM) static_cast<void>(0)
+#define IB_PROFILE_ADD_NODES(TIMER, NUM) static_cast<void>(0)
+#endif
+
+#endif /*IMMERSEDBOUNDARYPROFILER_HPP_*/
@@ -0,0 +1,129 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef IMMERSEDBOUNDARYPROFILINGMODIFIER_HPP_
+#define IMMERSEDBOUNDARYPROFILINGMODIFIER_HPP_
+
+#include <boost/serialization/base_object.hpp>
+#include "ChasteSerialization.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier class that collects the timings of ImmersedBoundaryProfiler over each solve of a simulation, and writes
+ * them to ib_timing_summary.json in the results directory of that solve, results_from_time_<t> in the simulation
+ * output directory.  Each stage of a simulation solved in stages, such as to label cells after reaching steady state,
+ * so has its own summary, and no stage overwrites another's.
+ *
+ * The records are reset in SetupSolve(), and the modifier adds a "TimeStep" record covering the whole of every time
+ * step, so that the time spent outside the instrumented force classes and modifiers can be found by difference.  The
+ * upstream fluid solve is timed on its own only if the main modifier is a ProfiledImmersedBoundarySimulationModifier,
+ * as in CellSortingSimulation.  Unless built with VertexIbComp_USE_PROFILING this writes an empty summary.
+ */
+template<unsigned DIM>
+class ImmersedBoundaryProfilingModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+    }
+
+protected:
+
+    /** The results directory of the current solve, relative to $CHASTE_TEST_OUTPUT */
+    std::string mOutputDirectory;
+
+    /** When the previous time step ended, or SetupSolve() was called */
+    std::chrono::steady_clock::time_point mLastTimeStepEnd;
+
+public:
+
+    /** Default constructor */
+    ImmersedBoundaryProfilingModifier() = default;
+
+    /** Default destructor */
+    virtual ~ImmersedBoundaryProfilingModifier() = default;
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     * Specify what to do in the simulation at the end of each time step.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     * Reset the records, so that the summary of this solve covers it alone.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     * Write the summary of this solve to its results directory.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ImmersedBoundaryProfilingModifier)
+
+#endif /*IMMERSEDBOUNDARYPROFILINGMODIFIER_HPP_*/
@@ -36,17 +36,21 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ImmersedBoundaryTargetAreaModifier.hpp"
 
 #include <algorithm>
-#include <numeric>
+#include <cmath>
 
 #include "Exception.hpp"
 #include "ImmersedBoundaryCellPopulation.hpp"
 #include "ImmersedBoundaryMesh.hpp"
 #include "ImmersedBoundaryElement.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
 #include "SimulationTime.hpp"
 
 template<unsigned DIM>
 void ImmersedBoundaryTargetAreaModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
 {
+    IB_PROFILE_SCOPE(timer, "ImmersedBoundaryTargetAreaModifier");
+    IB_PROFILE_ADD_NODES(timer, rCellPopulation.GetNumNodes());
+
     UpdateTargetAreas(rCellPopulation);
 }
 
@@ -63,15 +67,22 @@ void ImmersedBoundaryTargetAreaModifier<DIM>::SetupSolve(AbstractCellPopulation<
         EXCEPTION("This modifier is only for use with Immersed Boundary cell populations.");
     }
 
+    // Resolve the cell data of each element afresh, in case this modifier is reused with a different population
+    mCellDataHandles.clear();
+
     // Set initial target area with the current cell volume
+    ImmersedBoundaryGeometryCache<DIM>& r_geometry = rGetGeometryCache(
+            static_cast<ImmersedBoundaryCellPopulation<DIM>&>(rCellPopulation).rGetMesh());
+
     for (const auto& p_cell : rCellPopulation.rGetCells())
     {
-        p_cell->GetCellData()->SetItem("target area", rCellPopulation.GetVolumeOfCell(p_cell));
+        const unsigned elem_idx = rCellPopulation.GetLocationIndexUsingCell(p_cell);
+        p_cell->GetCellData()->SetItem("target area", r_geometry.GetVolumeOfElement(elem_idx));
     }
 
     UpdateTargetAreas(rCellPopulation);
 }
-#include "Debug.hpp"
+
 template<unsigned DIM>
 void ImmersedBoundaryTargetAreaModifier<DIM>::UpdateTargetAreas(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
 {
@@ -87,53 +98,161 @@ void ImmersedBoundaryTargetAreaModifier<DIM>::UpdateTargetAreas(AbstractCellPopu
     auto p_cell_population = dynamic_cast<ImmersedBoundaryCellPopulation<DIM>*>(&rCellPopulation);
     ImmersedBoundaryMesh<DIM, DIM>& r_mesh = p_cell_population->rGetMesh();
 
-    std::vector<double> crowding;
-    crowding.reserve(r_mesh.GetNumElements());
+    UpdateCrowding(r_mesh);
 
-    for (unsigned elem_idx = 0; elem_idx < r_mesh.GetNumElements(); ++elem_idx)
+    // Single pass (Welford's method) for the mean and standard deviation of crowding
+    double crowding_mean = 0.0;
+    double crowding_sum_sq_diffs = 0.0;
+    for (unsigned elem_idx = 0; elem_idx < mCrowding.size(); ++elem_idx)
     {
-        crowding.emplace_back(r_mesh.GetVoronoiSurfaceAreaOfElement(elem_idx) / r_mesh.GetSurfaceAreaOfElement(elem_idx));
+        const double diff_from_old_mean = mCrowding[elem_idx] - crowding_mean;
+        crowding_mean += diff_from_old_mean / (elem_idx + 1u);
+        crowding_sum_sq_diffs += diff_from_old_mean * (mCrowding[elem_idx] - crowding_mean);
     }
+    const double crowding_std = std::sqrt(crowding_sum_sq_diffs / mCrowding.size());
 
-    const double crowding_mean = std::accumulate(crowding.begin(), crowding.end(), 0.0) / crowding.size();
-    const double crowding_std = std::sqrt(
-            std::inner_product(crowding.begin(), crowding.end(), crowding.begin(), 0.0) / crowding.size() - crowding_mean * crowding_mean);
-
-    std::vector<double> deviations(crowding.size());
-    std::transform(crowding.begin(), crowding.end(), deviations.begin(), [&](const double c){
-        return (c - crowding_mean) / crowding_std;
-    });
-
-    const double old_total_target_area = GetTotalTargetArea(rCellPopulation);
+    UpdateCellDataHandles(rCellPopulation);
 
     // The response rate ought to be independent of timestep
     const double response = mResponseSpeed * SimulationTime::Instance()->GetTimeStep();
     assert(response < 1.0);
 
-    for (unsigned elem_idx = 0; elem_idx < r_mesh.GetNumElements(); ++elem_idx)
+    // Update each target area in turn, keeping track of the change in total target area
+    double old_total_target_area = 0.0;
+    double new_total_target_area = 0.0;
+
+    mTargetAreas.resize(mCellDataHandles.size());
+    for (unsigned elem_idx = 0; elem_idx < mCellDataHandles.size(); ++elem_idx)
     {
-        auto p_cell = rCellPopulation.GetCellUsingLocationIndex(elem_idx);
+        const double old_area = mCellDataHandles[elem_idx]->GetItem("target area");
+        const double deviation = (mCrowding[elem_idx] - crowding_mean) / crowding_std;
+
+        const double t_area = old_area * (1.0 + response * deviation);
+        mTargetAreas[elem_idx] = t_area < mMinTargetArea ? mMinTargetArea : t_area > mMaxTargetArea ? mMaxTargetArea : t_area;
 
-        const double t_area = p_cell->GetCellData()->GetItem("target area") * (1.0 + response * deviations[elem_idx]);
-        const double actual_area = t_area < mMinTargetArea ? mMinTargetArea : t_area > mMaxTargetArea ? mMaxTargetArea : t_area;
-        p_cell->GetCellData()->SetItem("target area", actual_area);
+        old_total_target_area += old_area;
+        new_total_target_area += mTargetAreas[elem_idx];
     }
 
-    const double tweak = (old_total_target_area - GetTotalTargetArea(rCellPopulation)) / p_cell_population->GetNumAllCells();
+    // Spread any change in total target area evenly, so that the total is conserved
+    const double tweak = (old_total_target_area - new_total_target_area) / mCellDataHandles.size();
 
-    for (const auto& p_cell : p_cell_population->rGetCells())
+    for (unsigned elem_idx = 0; elem_idx < mCellDataHandles.size(); ++elem_idx)
     {
-        p_cell->GetCellData()->SetItem("target area", tweak + p_cell->GetCellData()->GetItem("target area"));
+        mCellDataHandles[elem_idx]->SetItem("target area", mTargetAreas[elem_idx] + tweak);
     }
 }
 
 template<unsigned DIM>
-double ImmersedBoundaryTargetAreaModifier<DIM>::GetTotalTargetArea(AbstractCellPopulation<DIM,DIM>& rCellPopulation) const noexcept
+void ImmersedBoundaryTargetAreaModifier<DIM>::UpdateCellDataHandles(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
 {
-    return std::accumulate(
-        rCellPopulation.rGetCells().begin(), rCellPopulation.rGetCells().end(), 0.0, [](double val, CellPtr p_cell) {
-            return val + p_cell->GetCellData()->GetItem("target area");
-        });
+    const unsigned num_elems = static_cast<ImmersedBoundaryCellPopulation<DIM>&>(rCellPopulation).rGetMesh().GetNumElements();
+
+    // There are no births or deaths in populations using this modifier, so the handles only need resolving once
+    if (mCellDataHandles.size() != num_elems)
+    {
+        mCellDataHandles.resize(num_elems);
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            mCellDataHandles[elem_idx] = rCellPopulation.GetCellUsingLocationIndex(elem_idx)->GetCellData();
+        }
+    }
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryTargetAreaModifier<DIM>::UpdateCrowding(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    const unsigned num_elems = rMesh.GetNumElements();
+    const unsigned time_step = SimulationTime::Instance()->GetTimeStepsElapsed();
+
+    // An exact evaluation is needed if there is none yet, time has been reset, or the number of elements has changed
+    const bool exact_needed = mLastExactCrowdingTimeStep == UNSIGNED_UNSET ||
+                              time_step < mLastExactCrowdingTimeStep ||
+                              mLastExactCrowding.size() != num_elems;
+
+    const bool interval_elapsed = exact_needed || time_step - mLastExactCrowdingTimeStep >= mCrowdingUpdateInterval;
+
+    if (interval_elapsed && (exact_needed || HasMovedBeyondTolerance(rMesh)))
+    {
+        ImmersedBoundaryGeometryCache<DIM>& r_geometry = rGetGeometryCache(rMesh);
+
+        mPreviousExactCrowding.swap(mLastExactCrowding);
+        mLastExactCrowding.resize(num_elems);
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            mLastExactCrowding[elem_idx] = rMesh.GetVoronoiSurfaceAreaOfElement(elem_idx) / r_geometry.GetSurfaceAreaOfElement(elem_idx);
+        }
+
+        mPreviousExactCrowdingTimeStep = exact_needed ? UNSIGNED_UNSET : mLastExactCrowdingTimeStep;
+        mLastExactCrowdingTimeStep = time_step;
+
+        if (mCrowdingDisplacementTolerance > 0.0)
+        {
+            mLastExactNodeLocations.resize(DIM * rMesh.GetNumNodes());
+            for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+            {
+                const c_vector<double, DIM>& r_location = rMesh.GetNode(node_idx)->rGetLocation();
+                std::copy(r_location.begin(), r_location.end(), mLastExactNodeLocations.begin() + DIM * node_idx);
+            }
+        }
+
+        mCrowding = mLastExactCrowding;
+    }
+    else if (interval_elapsed || mPreviousExactCrowdingTimeStep == UNSIGNED_UNSET)
+    {
+        // Nodes have barely moved, or there is only one exact evaluation to go on: crowding is taken to be unchanged
+        mCrowding = mLastExactCrowding;
+    }
+    else
+    {
+        // Extrapolate linearly, in time steps, from the two most recent exact evaluations
+        const double fraction = static_cast<double>(time_step - mLastExactCrowdingTimeStep) /
+                                static_cast<double>(mLastExactCrowdingTimeStep - mPreviousExactCrowdingTimeStep);
+
+        mCrowding.resize(num_elems);
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            mCrowding[elem_idx] = mLastExactCrowding[elem_idx] +
+                                  fraction * (mLastExactCrowding[elem_idx] - mPreviousExactCrowding[elem_idx]);
+        }
+    }
+}
+
+template<unsigned DIM>
+bool ImmersedBoundaryTargetAreaModifier<DIM>::HasMovedBeyondTolerance(ImmersedBoundaryMesh<DIM, DIM>& rMesh) const
+{
+    if (mCrowdingDisplacementTolerance <= 0.0 || mLastExactNodeLocations.size() != DIM * rMesh.GetNumNodes())
+    {
+        return true;
+    }
+
+    const double tolerance_squared = mCrowdingDisplacementTolerance * mCrowdingDisplacementTolerance;
+
+    c_vector<double, DIM> last_location;
+    for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+    {
+        std::copy(mLastExactNodeLocations.begin() + DIM * node_idx,
+                  mLastExactNodeLocations.begin() + DIM * (node_idx + 1u),
+                  last_location.begin());
+
+        const c_vector<double, DIM> displacement = rMesh.GetVectorFromAtoB(last_location, rMesh.GetNode(node_idx)->rGetLocation());
+        if (inner_prod(displacement, displacement) > tolerance_squared)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<unsigned DIM>
+ImmersedBoundaryGeometryCache<DIM>& ImmersedBoundaryTargetAreaModifier<DIM>::rGetGeometryCache(ImmersedBoundaryMesh<DIM, DIM>& rMesh)
+{
+    if (!mpGeometryCache || &(mpGeometryCache->rGetMesh()) != &rMesh)
+    {
+        mpGeometryCache = ImmersedBoundaryGeometryCache<DIM>::GetForMesh(rMesh);
+    }
+    return *mpGeometryCache;
 }
 
 template<unsigned DIM>
@@ -162,11 +281,45 @@ void ImmersedBoundaryTargetAreaModifier<DIM>::SetMaxTargetArea(double maxTargetA
     mMaxTargetArea = maxTargetArea;
 }
 
+template<unsigned DIM>
+unsigned ImmersedBoundaryTargetAreaModifier<DIM>::GetCrowdingUpdateInterval() const noexcept
+{
+    return mCrowdingUpdateInterval;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryTargetAreaModifier<DIM>::SetCrowdingUpdateInterval(unsigned crowdingUpdateInterval)
+{
+    if (crowdingUpdateInterval == 0u)
+    {
+        EXCEPTION("The crowding update interval must be at least 1.");
+    }
+    mCrowdingUpdateInterval = crowdingUpdateInterval;
+}
+
+template<unsigned DIM>
+double ImmersedBoundaryTargetAreaModifier<DIM>::GetCrowdingDisplacementTolerance() const noexcept
+{
+    return mCrowdingDisplacementTolerance;
+}
+
+template<unsigned DIM>
+void ImmersedBoundaryTargetAreaModifier<DIM>::SetCrowdingDisplacementTolerance(double crowdingDisplacementTolerance)
+{
+    if (crowdingDisplacementTolerance < 0.0)
+    {
+        EXCEPTION("The crowding displacement tolerance must be non-negative.");
+    }
+    mCrowdingDisplacementTolerance = crowdingDisplacementTolerance;
+}
+
 template<unsigned DIM>
 void ImmersedBoundaryTargetAreaModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
 {
     *rParamsFile << "\t\t\t<MinTargetArea>" << mMinTargetArea << "</MinTargetArea>\n";
     *rParamsFile << "\t\t\t<MaxTargetArea>" << mMaxTargetArea << "</MaxTargetArea>\n";
+    *rParamsFile << "\t\t\t<CrowdingUpdateInterval>" << mCrowdingUpdateInterval << "</CrowdingUpdateInterval>\n";
+    *rParamsFile << "\t\t\t<CrowdingDisplacementTolerance>" << mCrowdingDisplacementTolerance << "</CrowdingDisplacementTolerance>\n";
 
     // Next, call method on direct parent class
     AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
@@ -37,9 +37,15 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define IMMERSEDBOUNDARYTARGETAREAMODIFIER_HPP_
 
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/vector.hpp>
 #include "ChasteSerialization.hpp"
+#include "ChasteSerializationVersion.hpp"
+
+#include <vector>
 
 #include "AbstractCellBasedSimulationModifier.hpp"
+#include "CellData.hpp"
+#include "ImmersedBoundaryGeometryCache.hpp"
 
 /**
  * A modifier class in which the target area property of each cell is updated.
@@ -63,6 +69,22 @@ class ImmersedBoundaryTargetAreaModifier : public AbstractCellBasedSimulationMod
         archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
         archive & mMinTargetArea;
         archive & mMaxTargetArea;
+
+        // Archives of version 0 hold neither the response speed nor any crowding state, which keep their defaults
+        if (version > 0)
+        {
+            archive & mResponseSpeed;
+            archive & mCrowdingUpdateInterval;
+            archive & mCrowdingDisplacementTolerance;
+
+            // The crowding extrapolation state, so a resumed simulation extrapolates exactly as an uninterrupted one
+            archive & mCrowding;
+            archive & mLastExactCrowding;
+            archive & mPreviousExactCrowding;
+            archive & mLastExactCrowdingTimeStep;
+            archive & mPreviousExactCrowdingTimeStep;
+            archive & mLastExactNodeLocations;
+        }
     }
 
 protected:
@@ -76,13 +98,80 @@ protected:
     /** The speed (per unit time) with which target area responds to crowding */
     double mResponseSpeed = 0.001;
 
+    /** The element geometry cache shared by all users of the mesh */
+    std::shared_ptr<ImmersedBoundaryGeometryCache<DIM>> mpGeometryCache;
+
+    /**
+     * The number of time steps between exact evaluations of crowding, which needs a Voronoi tessellation of every
+     * node in the mesh.  In between, crowding is extrapolated linearly from the two most recent exact evaluations.
+     */
+    unsigned mCrowdingUpdateInterval = 1u;
+
+    /**
+     * If positive, crowding is only re-evaluated once some node has moved further than this distance since the last
+     * exact evaluation; until then the last exact value is reused.
+     */
+    double mCrowdingDisplacementTolerance = 0.0;
+
+    /** The crowding of each element, used in UpdateTargetAreas() */
+    std::vector<double> mCrowding;
+
+    /** The crowding of each element at the most recent exact evaluation */
+    std::vector<double> mLastExactCrowding;
+
+    /** The crowding of each element at the exact evaluation before the most recent one */
+    std::vector<double> mPreviousExactCrowding;
+
+    /** The number of time steps elapsed at the most recent exact evaluation, or UNSIGNED_UNSET if there has been none */
+    unsigned mLastExactCrowdingTimeStep = UNSIGNED_UNSET;
+
+    /** The number of time steps elapsed at the exact evaluation before the most recent one, or UNSIGNED_UNSET */
+    unsigned mPreviousExactCrowdingTimeStep = UNSIGNED_UNSET;
+
+    /** The location of each node at the most recent exact evaluation, one node after another */
+    std::vector<double> mLastExactNodeLocations;
+
     /**
      * Helper method for UpdateTargetAreas().
      *
+     * Fill mCrowding, either exactly or by extrapolation, according to mCrowdingUpdateInterval and
+     * mCrowdingDisplacementTolerance.
+     *
+     * @param rMesh the mesh of the immersed boundary cell population
+     */
+    void UpdateCrowding(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Helper method for UpdateCrowding().
+     *
+     * @param rMesh the mesh of the immersed boundary cell population
+     * @return whether any node has moved further than mCrowdingDisplacementTolerance since the last exact evaluation
+     */
+    bool HasMovedBeyondTolerance(ImmersedBoundaryMesh<DIM, DIM>& rMesh) const;
+
+    /**
+     * Helper method to get the geometry cache for a population's mesh, setting mpGeometryCache if necessary.
+     *
+     * @param rMesh the mesh of the immersed boundary cell population
+     * @return the cache for rMesh
+     */
+    ImmersedBoundaryGeometryCache<DIM>& rGetGeometryCache(ImmersedBoundaryMesh<DIM, DIM>& rMesh);
+
+    /** The cell data of the cell associated with each element, indexed by element index */
+    std::vector<boost::shared_ptr<CellData>> mCellDataHandles;
+
+    /** The new target area of each element, before the correction that conserves total target area */
+    std::vector<double> mTargetAreas;
+
+    /**
+     * Helper method for UpdateTargetAreas().
+     *
+     * Fill mCellDataHandles, if it is not already filled, so that target areas can be read and written without
+     * looking up each cell and its cell data every time step.
+     *
      * @param rCellPopulation the cell population
-     * @return the sum of the target areas of every cell
      */
-    double GetTotalTargetArea(AbstractCellPopulation<DIM,DIM>& rCellPopulation) const noexcept;
+    void UpdateCellDataHandles(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
 
 public:
 
@@ -121,6 +210,18 @@ public:
     /** @param maxTargetArea the new value of mMaxTargetArea */
     void SetMaxTargetArea(double maxTargetArea) noexcept;
 
+    /** @return the number of time steps between exact evaluations of crowding */
+    unsigned GetCrowdingUpdateInterval() const noexcept;
+
+    /** @param crowdingUpdateInterval the new value of mCrowdingUpdateInterval; must be at least 1 */
+    void SetCrowdingUpdateInterval(unsigned crowdingUpdateInterval);
+
+    /** @return the node displacement below which crowding is not re-evaluated */
+    double GetCrowdingDisplacementTolerance() const noexcept;
+
+    /** @param crowdingDisplacementTolerance the new value of mCrowdingDisplacementTolerance; zero to disable */
+    void SetCrowdingDisplacementTolerance(double crowdingDisplacementTolerance);
+
     /**
      * Helper method to update the target area property of all cells in the population.
      *
@@ -137,4 +238,21 @@ public:
     virtual void OutputSimulationModifierParameters(out_stream& rParamsFile);
 };
 
+namespace boost
+{
+namespace serialization
+{
+/**
+ * Specify a version number for this templated class, as BOOST_CLASS_VERSION does not work for templates.
+ * Version 1 adds the response speed, the crowding update cadence and the crowding extrapolation state.
+ */
+template<unsigned DIM>
+struct version<ImmersedBoundaryTargetAreaModifier<DIM> >
+{
+    /// Macro to set the version number of templated archive in known versions of Boost
+    CHASTE_VERSION_CONTENT(1);
+};
+} // namespace serialization
+} // namespace boost
+
 #endif /*IMMERSEDBOUNDARYTARGETAREAMODIFIER_HPP_*/
@@ -1,8 +1,13 @@
 #include "OffLatticeRandomFieldForce.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
 
-#include "ChasteMakeUnique.hpp"
+#include "CounterBasedNormalGenerator.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryProfiler.hpp"
 
 #include "RandomNumberGenerator.hpp"
 #include "SimulationTime.hpp"
@@ -11,30 +16,66 @@
 template<unsigned DIM>
 OffLatticeRandomFieldForce<DIM>::OffLatticeRandomFieldForce()
     : AbstractForce<DIM>(),
-      mDiffusionStrength(0.01)
+      mDiffusionStrength(0.01),
+      mpRandomFieldGenerator(nullptr),
+      mUseCounterBasedNoise(false),
+      mCounterBasedNoiseKeyIsSet(false),
+      mCounterBasedNoiseKey(0u),
+      mNumCounterBasedNoiseSteps(0u)
 {
 }
 
 template <unsigned DIM>
 void OffLatticeRandomFieldForce<DIM>::SetUpRandomFieldGenerator(const std::string cachedFieldName)
 {
+    mCachedFieldName = cachedFieldName;
+
     if (cachedFieldName.empty())
     {
         mpRandomFieldGenerator = nullptr;
     }
     else
     {
-        mpRandomFieldGenerator = our::make_unique<UniformGridRandomFieldGenerator<DIM>>(cachedFieldName);
+        mpRandomFieldGenerator = GetSharedRandomFieldGenerator(cachedFieldName);
     }
+
+    // Any nodes already located were located on the grid of the previous generator
+    mGridIndexField.clear();
+}
+
+template <unsigned DIM>
+std::shared_ptr<UniformGridRandomFieldGenerator<DIM>> OffLatticeRandomFieldForce<DIM>::GetSharedRandomFieldGenerator(
+        const std::string& rCachedFieldName)
+{
+    // Cached fields never change, so generators are kept rather than reloaded by the next simulation in the process
+    static std::map<std::string, std::shared_ptr<UniformGridRandomFieldGenerator<DIM>>> generators;
+
+    std::shared_ptr<UniformGridRandomFieldGenerator<DIM>>& rp_generator = generators[rCachedFieldName];
+    if (!rp_generator)
+    {
+        rp_generator = std::make_shared<UniformGridRandomFieldGenerator<DIM>>(rCachedFieldName);
+    }
+
+    return rp_generator;
 }
 
 template<unsigned DIM>
 void OffLatticeRandomFieldForce<DIM>::AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation)
 {
+    IB_PROFILE_SCOPE(timer, "OffLatticeRandomFieldForce");
+    IB_PROFILE_ADD_NODES(timer, rCellPopulation.GetNumNodes());
+
     // If the field is null, the noise lengthscale is zero and we add uncorrelated random noise
     if (mpRandomFieldGenerator == nullptr)
     {
-        AddUncorrelatedForce(rCellPopulation);
+        if (mUseCounterBasedNoise)
+        {
+            AddCounterBasedUncorrelatedForce(rCellPopulation);
+        }
+        else
+        {
+            AddUncorrelatedForce(rCellPopulation);
+        }
     }
     else
     {
@@ -61,24 +102,102 @@ void OffLatticeRandomFieldForce<DIM>::AddUncorrelatedForce(AbstractCellPopulatio
 }
 
 template<unsigned DIM>
-void OffLatticeRandomFieldForce<DIM>::AddCorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation) const noexcept
+void OffLatticeRandomFieldForce<DIM>::AddCounterBasedUncorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation)
+{
+    // Draw the key on first use, rather than on construction, so that it follows any reseeding before the simulation
+    if (!mCounterBasedNoiseKeyIsSet)
+    {
+        RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+        const std::uint64_t key_hi = p_gen->randMod(std::numeric_limits<unsigned>::max());
+        const std::uint64_t key_lo = p_gen->randMod(std::numeric_limits<unsigned>::max());
+        mCounterBasedNoiseKey = (key_hi << 32u) | key_lo;
+        mCounterBasedNoiseKeyIsSet = true;
+    }
+
+    // The multiplicative pre-factor applied to each element from the random field
+    const double force_scale_factor = std::sqrt(2.0 * mDiffusionStrength / SimulationTime::Instance()->GetTimeStep());
+
+    const std::size_t num_nodes = rCellPopulation.rGetMesh().rGetNodes().size();
+    mNoiseBuffer.resize(DIM * num_nodes);
+
+    const CounterBasedNormalGenerator generator(mCounterBasedNoiseKey);
+    generator.FillStandardNormals(mNumCounterBasedNoiseSteps++, 0u, mNoiseBuffer.size(), mNoiseBuffer.data());
+
+    std::size_t node_idx = 0;
+    for (auto& p_node : rCellPopulation.rGetMesh().rGetNodes())
+    {
+        c_vector<double, DIM> force;
+        for (unsigned dim = 0; dim < DIM; ++dim)
+        {
+            force[dim] = force_scale_factor * mNoiseBuffer[DIM * node_idx + dim];
+        }
+
+        p_node->AddAppliedForceContribution(force);
+        ++node_idx;
+    }
+}
+
+template<unsigned DIM>
+void OffLatticeRandomFieldForce<DIM>::AddCorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation)
 {
     // We need to sample a random field for each dimension
     std::vector<std::vector<double>> random_fields(DIM);
-    std::generate(random_fields.begin(), random_fields.end(), [&](){return mpRandomFieldGenerator->SampleRandomField();});
+    std::generate(random_fields.begin(), random_fields.end(),
+                  [&](){return mpRandomFieldGenerator->SampleRandomField();});
 
     // The multiplicative pre-factor applied to each element from the random field
     const double force_scale_factor = std::sqrt(2.0 * mDiffusionStrength / SimulationTime::Instance()->GetTimeStep());
 
+    // Locate each node on the grid once, rather than once per field
+    UpdateNodeGridIndices(rCellPopulation, random_fields[0].size());
+
+    // Gather every field, one at a time, into the contiguous force array
+    const std::size_t num_nodes = mNodeGridIndices.size();
+    mNodeForces.resize(DIM * num_nodes);
+    for (unsigned dim = 0; dim < DIM; ++dim)
+    {
+        const double* const p_field = random_fields[dim].data();
+        for (std::size_t node_idx = 0; node_idx < num_nodes; ++node_idx)
+        {
+            mNodeForces[DIM * node_idx + dim] = force_scale_factor * p_field[mNodeGridIndices[node_idx]];
+        }
+    }
+
+    std::size_t node_idx = 0;
     for (auto& p_node : rCellPopulation.rGetMesh().rGetNodes())
     {
         c_vector<double, DIM> force;
         for (unsigned dim = 0; dim < DIM; ++dim)
         {
-            force[dim] = force_scale_factor * mpRandomFieldGenerator->Interpolate(random_fields[dim], p_node->rGetLocation());
+            force[dim] = mNodeForces[DIM * node_idx + dim];
         }
 
         p_node->AddAppliedForceContribution(force);
+        ++node_idx;
+    }
+}
+
+template<unsigned DIM>
+void OffLatticeRandomFieldForce<DIM>::UpdateNodeGridIndices(AbstractCellPopulation<DIM>& rCellPopulation,
+                                                            std::size_t numGridPoints)
+{
+    // Interpolation takes the value at the nearest grid point, so interpolating a field of grid indices gives
+    // exactly the grid point each field is sampled at
+    if (mGridIndexField.size() != numGridPoints)
+    {
+        mGridIndexField.resize(numGridPoints);
+        for (std::size_t grid_idx = 0; grid_idx < numGridPoints; ++grid_idx)
+        {
+            mGridIndexField[grid_idx] = static_cast<double>(grid_idx);
+        }
+    }
+
+    mNodeGridIndices.clear();
+    mNodeGridIndices.reserve(rCellPopulation.rGetMesh().rGetNodes().size());
+    for (auto& p_node : rCellPopulation.rGetMesh().rGetNodes())
+    {
+        const double grid_idx = mpRandomFieldGenerator->Interpolate(mGridIndexField, p_node->rGetLocation());
+        mNodeGridIndices.emplace_back(static_cast<unsigned>(std::lround(grid_idx)));
     }
 }
 
@@ -86,6 +205,7 @@ template<unsigned DIM>
 void OffLatticeRandomFieldForce<DIM>::OutputForceParameters(out_stream& rParamsFile)
 {
     *rParamsFile << "\t\t\t<DiffusionStrength>" << mDiffusionStrength << "</DiffusionStrength> \n";
+    *rParamsFile << "\t\t\t<UseCounterBasedNoise>" << mUseCounterBasedNoise << "</UseCounterBasedNoise> \n";
 
     // Call direct parent class
     AbstractForce<DIM>::OutputForceParameters(rParamsFile);
@@ -103,6 +223,26 @@ void OffLatticeRandomFieldForce<DIM>::SetDiffusionStrength(double diffusionStren
     mDiffusionStrength = diffusionStrength;
 }
 
+template<unsigned int DIM>
+bool OffLatticeRandomFieldForce<DIM>::GetUseCounterBasedNoise() const
+{
+    return mUseCounterBasedNoise;
+}
+
+template<unsigned int DIM>
+void OffLatticeRandomFieldForce<DIM>::SetUseCounterBasedNoise(bool useCounterBasedNoise)
+{
+    mUseCounterBasedNoise = useCounterBasedNoise;
+}
+
+template<unsigned int DIM>
+void OffLatticeRandomFieldForce<DIM>::ResetCounterBasedNoise()
+{
+    mCounterBasedNoiseKeyIsSet = false;
+    mCounterBasedNoiseKey = 0u;
+    mNumCounterBasedNoiseSteps = 0u;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Explicit instantiation
 /////////////////////////////////////////////////////////////////////////////
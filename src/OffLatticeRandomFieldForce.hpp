@@ -2,7 +2,15 @@
 #define OFFLATTICERANDOMFIELDFORCE_HPP_
 
 #include "ChasteSerialization.hpp"
+#include "ChasteSerializationVersion.hpp"
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "AbstractForce.hpp"
 #include "AbstractCellPopulation.hpp"
@@ -19,8 +27,51 @@ private:
     /** The strength of the force on each node such that F = sqrt(2 * mDiffusionStrength / dt) * x, for x~N(0,1) */
     double mDiffusionStrength;
 
-    /** An owning pointer to the random field generator that creates appropriate correlation between nodes */
-    std::unique_ptr<UniformGridRandomFieldGenerator<DIM>> mpRandomFieldGenerator;
+    /**
+     * The random field generator that creates appropriate correlation between nodes, shared with every other force
+     * in the process set up from the same cached field
+     */
+    std::shared_ptr<UniformGridRandomFieldGenerator<DIM>> mpRandomFieldGenerator;
+
+    /** The cached field mpRandomFieldGenerator was set up from, or empty if there is none, so it can be archived */
+    std::string mCachedFieldName;
+
+    /** A field whose value at each grid point is that grid point's index, used to locate nodes on the grid */
+    std::vector<double> mGridIndexField;
+
+    /** For each node, in the order of rGetNodes(), the index of the grid point whose field value it takes */
+    std::vector<unsigned> mNodeGridIndices;
+
+    /** Contiguous DIM-strided scratch array of the correlated force on each node, in the order of rGetNodes() */
+    std::vector<double> mNodeForces;
+
+    /**
+     * Helper method for AddCorrelatedForce.  Locate every node on the random field grid once, so the location
+     * can be reused for each of the DIM fields.
+     *
+     * @param rCellPopulation the cell population whose nodes to locate
+     * @param numGridPoints the number of grid points in each random field
+     */
+    void UpdateNodeGridIndices(AbstractCellPopulation<DIM>& rCellPopulation, std::size_t numGridPoints);
+
+    /** Whether uncorrelated noise is drawn in bulk from a counter-based generator, rather than node by node */
+    bool mUseCounterBasedNoise;
+
+    /** Whether mCounterBasedNoiseKey has been drawn from the RandomNumberGenerator yet */
+    bool mCounterBasedNoiseKeyIsSet;
+
+    /** The key of the counter-based generator, drawn once from the RandomNumberGenerator so it follows the seed */
+    std::uint64_t mCounterBasedNoiseKey;
+
+    /**
+     * The number of time steps for which counter-based noise has been drawn, used as the counter.  Unlike the number
+     * of time steps elapsed, this is not reset by each Solve(), so a simulation solved in stages never repeats its
+     * noise.
+     */
+    std::uint64_t mNumCounterBasedNoiseSteps;
+
+    /** Contiguous DIM-strided buffer of standard normal deviates for each node, in the order of rGetNodes() */
+    std::vector<double> mNoiseBuffer;
 
     /**
      * Helper method for AddForceContribution.  Add uncorrelated noise in the case of no random field.
@@ -28,11 +79,20 @@ private:
      */
     void AddUncorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation) const noexcept;
 
+    /**
+     * Helper method for AddForceContribution.  Add uncorrelated noise in the case of no random field, drawing every
+     * deviate for the time step at once from a counter-based generator.  Deviate DIM * i + d for node i and
+     * dimension d depends only on the key, the number of time steps drawn for so far, i and d.
+     *
+     * @param rCellPopulation the cell population to add noise to
+     */
+    void AddCounterBasedUncorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation);
+
     /**
      * Helper method for AddForceContribution.  Add correlated noise sampled from the random field.
      * @param rCellPopulation the cell population to add noise to
      */
-    void AddCorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation) const noexcept;
+    void AddCorrelatedForce(AbstractCellPopulation<DIM>& rCellPopulation);
 
     /** Archiving */
     friend class boost::serialization::access;
@@ -49,6 +109,36 @@ private:
     {
         archive & boost::serialization::base_object<AbstractForce<DIM> >(*this);
         archive & mDiffusionStrength;
+
+        // Archives of version 0 hold only the diffusion strength, and no random field generator
+        if (version > 0)
+        {
+            // Archives of version 1 also hold a field batch size, and the fields of the batch, which are discarded
+            unsigned field_batch_size = 1u;
+            if (version == 1)
+            {
+                archive & field_batch_size;
+            }
+            archive & mUseCounterBasedNoise;
+            archive & mCounterBasedNoiseKeyIsSet;
+            archive & mCounterBasedNoiseKey;
+            archive & mNumCounterBasedNoiseSteps;
+
+            // The generator is archived as the cached field it came from
+            archive & mCachedFieldName;
+            if (Archive::is_loading::value)
+            {
+                SetUpRandomFieldGenerator(mCachedFieldName);
+            }
+
+            std::vector<std::vector<double>> field_batch;
+            unsigned next_field_batch_idx = 0u;
+            if (version == 1)
+            {
+                archive & field_batch;
+                archive & next_field_batch_idx;
+            }
+        }
     }
 
 public:
@@ -60,12 +150,26 @@ public:
     ~OffLatticeRandomFieldForce() = default;
 
     /**
-     * Set up the random field generator, from a cached field.
+     * Set up the random field generator, from a cached field.  The cached field must still exist when a
+     * checkpoint of this force is loaded.
      *
      * @param cachedFieldName the filename of a cached random field, relative to $CHASTE_TEST_OUTPUT
      */
     void SetUpRandomFieldGenerator(const std::string cachedFieldName);
 
+    /**
+     * Get the random field generator for a cached field, loading it the first time it is requested in this process
+     * and keeping it until the process exits.  Each generator holds the full eigen-decomposition of its field, so
+     * this is shared by every force set up from the same cached field.  A parent process that calls this before
+     * forking shares the loaded generator with its children, copy-on-write, so that they neither load nor hold
+     * their own copies.
+     *
+     * @param rCachedFieldName the filename of a cached random field, relative to $CHASTE_TEST_OUTPUT
+     * @return the shared generator
+     */
+    static std::shared_ptr<UniformGridRandomFieldGenerator<DIM>> GetSharedRandomFieldGenerator(
+            const std::string& rCachedFieldName);
+
     /**
      * Overridden AddForceContribution() method.
      *
@@ -79,6 +183,24 @@ public:
     /** @paramm diffusionStrength the new value of mDiffusionStrength */
     void SetDiffusionStrength(double diffusionStrength);
 
+    /** @return mUseCounterBasedNoise */
+    bool GetUseCounterBasedNoise() const;
+
+    /**
+     * Set whether uncorrelated noise is drawn in bulk from a counter-based generator.  The noise then does not
+     * depend on how, or by how many threads, it is generated, but differs from that drawn node by node.
+     *
+     * @param useCounterBasedNoise the new value of mUseCounterBasedNoise
+     */
+    void SetUseCounterBasedNoise(bool useCounterBasedNoise);
+
+    /**
+     * Forget the key and counter of counter-based noise, as on construction, so the key is drawn afresh from the
+     * RandomNumberGenerator on next use.  Call this after reseeding, for instance when forking variants from one
+     * checkpoint, so that each variant draws noise of its own.
+     */
+    void ResetCounterBasedNoise();
+
     /**
      * Overridden OutputForceParameters() method.
      *
@@ -90,4 +212,21 @@ public:
 #include "SerializationExportWrapper.hpp"
 EXPORT_TEMPLATE_CLASS_SAME_DIMS(OffLatticeRandomFieldForce)
 
+namespace boost
+{
+namespace serialization
+{
+/**
+ * Specify a version number for this templated class, as BOOST_CLASS_VERSION does not work for templates.
+ * Version 1 adds field batching, counter-based noise and the cached random field.  Version 2 removes field batching.
+ */
+template<unsigned DIM>
+struct version<OffLatticeRandomFieldForce<DIM> >
+{
+    /// Macro to set the version number of templated archive in known versions of Boost
+    CHASTE_VERSION_CONTENT(2);
+};
+} // namespace serialization
+} // namespace boost
+
 #endif /*OFFLATTICERANDOMFIELDFORCE_HPP_*/
@@ -0,0 +1,184 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef OFFLOADBUFFER_HPP_
+#define OFFLOADBUFFER_HPP_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * A host array with a persistent copy on the default OpenMP target device, for kernels offloaded with "omp target".
+ *
+ * The device copy is allocated when the buffer is resized and kept until it is resized again or destroyed, so data
+ * that changes rarely need only be copied to the device when it does, and kernels map the array with map(alloc:) to
+ * use the copy already there.  Copies between host and device are explicit, through CopyToDevice() and
+ * CopyFromDevice().
+ *
+ * Built without OpenMP, every operation on the device copy does nothing and kernels run on the host.  Built with
+ * OpenMP but run without a device, OpenMP runs kernels on the host and the device copy is the host array itself.
+ */
+template<typename T>
+class OffloadBuffer
+{
+private:
+
+    /** The host array */
+    std::vector<T> mData;
+
+    /** Allocate the device copy of the host array, if it is not empty. */
+    void MapToDevice()
+    {
+        T* const p_data = mData.data();
+        const std::size_t size = mData.size();
+        if (size > 0u)
+        {
+#ifdef _OPENMP
+#pragma omp target enter data map(alloc: p_data[0:size])
+#endif
+        }
+    }
+
+    /** Free the device copy of the host array, if it is not empty. */
+    void UnmapFromDevice()
+    {
+        T* const p_data = mData.data();
+        const std::size_t size = mData.size();
+        if (size > 0u)
+        {
+#ifdef _OPENMP
+#pragma omp target exit data map(delete: p_data[0:size])
+#endif
+        }
+    }
+
+public:
+
+    /** Default constructor. */
+    OffloadBuffer() = default;
+
+    /** The device copy is tied to the address of the host array, so buffers cannot be copied. */
+    OffloadBuffer(const OffloadBuffer&) = delete;
+
+    /** The device copy is tied to the address of the host array, so buffers cannot be copied. */
+    OffloadBuffer& operator=(const OffloadBuffer&) = delete;
+
+    /** Destructor.  Free the device copy. */
+    ~OffloadBuffer()
+    {
+        UnmapFromDevice();
+    }
+
+    /**
+     * Resize the array.  If the size changes, the device copy is reallocated and its contents are undefined until
+     * the next CopyToDevice() or kernel writing to it.
+     *
+     * @param size the new number of entries
+     */
+    void Resize(std::size_t size)
+    {
+        if (size != mData.size())
+        {
+            UnmapFromDevice();
+            mData.resize(size);
+            MapToDevice();
+        }
+    }
+
+    /** Copy the host array to the device. */
+    void CopyToDevice()
+    {
+        T* const p_data = mData.data();
+        const std::size_t size = mData.size();
+        if (size > 0u)
+        {
+#ifdef _OPENMP
+#pragma omp target update to(p_data[0:size])
+#endif
+        }
+    }
+
+    /** Copy the device copy back to the host array. */
+    void CopyFromDevice()
+    {
+        T* const p_data = mData.data();
+        const std::size_t size = mData.size();
+        if (size > 0u)
+        {
+#ifdef _OPENMP
+#pragma omp target update from(p_data[0:size])
+#endif
+        }
+    }
+
+    /** @return the number of entries */
+    std::size_t size() const noexcept
+    {
+        return mData.size();
+    }
+
+    /** @return the host array */
+    T* data() noexcept
+    {
+        return mData.data();
+    }
+
+    /** @return the host array */
+    const T* data() const noexcept
+    {
+        return mData.data();
+    }
+
+    /**
+     * @param index the index of an entry
+     * @return the entry of the host array
+     */
+    T& operator[](std::size_t index) noexcept
+    {
+        return mData[index];
+    }
+
+    /**
+     * @param index the index of an entry
+     * @return the entry of the host array
+     */
+    const T& operator[](std::size_t index) const noexcept
+    {
+        return mData[index];
+    }
+};
+
+#endif /*OFFLOADBUFFER_HPP_*/
@@ -0,0 +1,91 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PROFILEDIMMERSEDBOUNDARYSIMULATIONMODIFIER_HPP_
+#define PROFILEDIMMERSEDBOUNDARYSIMULATIONMODIFIER_HPP_
+
+#include <boost/serialization/base_object.hpp>
+#include "ChasteSerialization.hpp"
+
+#include "ImmersedBoundarySimulationModifier.hpp"
+
+/**
+ * An ImmersedBoundarySimulationModifier that times each of its updates under an "ImmersedBoundarySimulationModifier"
+ * record of ImmersedBoundaryProfiler, and is otherwise identical.  The update calculates the immersed boundary
+ * forces, spreads them onto the fluid grid and solves the fluid flow, so the upstream fluid solve, together with any
+ * upstream force such as ImmersedBoundaryMorseMembraneForce, takes this record less those of the instrumented
+ * forces, ImmersedBoundaryMorseDifferentialAdhesionForce and AngularVariationMembraneForce.  Unless built with
+ * VertexIbComp_USE_PROFILING this adds no record.
+ */
+template<unsigned DIM>
+class ProfiledImmersedBoundarySimulationModifier : public ImmersedBoundarySimulationModifier<DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<ImmersedBoundarySimulationModifier<DIM> >(*this);
+    }
+
+public:
+
+    /** Default constructor */
+    ProfiledImmersedBoundarySimulationModifier() = default;
+
+    /** Default destructor */
+    virtual ~ProfiledImmersedBoundarySimulationModifier() = default;
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     * Time the update of the parent class.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfiledImmersedBoundarySimulationModifier)
+
+#endif /*PROFILEDIMMERSEDBOUNDARYSIMULATIONMODIFIER_HPP_*/
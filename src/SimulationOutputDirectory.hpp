@@ -0,0 +1,68 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef SIMULATIONOUTPUTDIRECTORY_HPP_
+#define SIMULATIONOUTPUTDIRECTORY_HPP_
+
+#include <string>
+
+/**
+ * Each Solve() of a cell-based simulation passes its modifiers the results directory results_from_time_<t> within
+ * the simulation output directory, so a simulation solved in stages, such as to label cells after reaching steady
+ * state, gives each stage a different directory.  Modifiers that continue one file across stages compare, and write
+ * to, the simulation output directory instead.
+ *
+ * @param rResultsDirectory the results directory passed to SetupSolve(), relative to where Chaste output is stored
+ * @return the simulation output directory, without any trailing slash, or rResultsDirectory if it is not a results
+ *     directory
+ */
+inline std::string GetSimulationOutputDirectory(const std::string& rResultsDirectory)
+{
+    const std::string results_prefix = "results_from_time_";
+
+    const std::size_t slash_pos = rResultsDirectory.find_last_of('/');
+    const std::size_t name_pos = slash_pos == std::string::npos ? 0u : slash_pos + 1u;
+    if (rResultsDirectory.compare(name_pos, results_prefix.size(), results_prefix) != 0)
+    {
+        return rResultsDirectory;
+    }
+
+    // Chaste joins the directories with a slash even if the simulation output directory already ends in one
+    const std::size_t parent_end = rResultsDirectory.find_last_not_of('/', name_pos == 0u ? 0u : name_pos - 1u);
+    return parent_end == std::string::npos || name_pos == 0u ? "" : rResultsDirectory.substr(0, parent_end + 1u);
+}
+
+#endif /*SIMULATIONOUTPUTDIRECTORY_HPP_*/
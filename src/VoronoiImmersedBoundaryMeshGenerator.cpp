@@ -36,17 +36,68 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "VoronoiImmersedBoundaryMeshGenerator.hpp"
 
 #include "ChasteMakeUnique.hpp"
+#include "CheckpointArchiveTypes.hpp"
+#include "Exception.hpp"
 #include "ImmersedBoundaryElement.hpp"
+#include "ImmersedBoundaryMortonOrdering.hpp"
 #include "MeshUtilityFunctions.hpp"
 #include "MutableVertexMesh.hpp"
 #include "Node.hpp"
+#include "OutputFileHandler.hpp"
+#include "RandomNumberGenerator.hpp"
 #include "UblasCustomFunctions.hpp"
 #include "VertexElement.hpp"
 #include "VoronoiVertexMeshGenerator.hpp"
 
-#include <boost/geometry.hpp>
-#include <boost/geometry/geometries/segment.hpp>
-#include <boost/geometry/geometries/point.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A Voronoi vertex mesh generator that can hand over ownership of the mesh it generates, so the mesh need not be
+ * copied before the generator goes out of scope and deletes it.
+ */
+class ReleasableVoronoiVertexMeshGenerator : public VoronoiVertexMeshGenerator
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param numElementsX the number of elements requested across the mesh
+     * @param numElementsY the number of elements requested up the mesh
+     * @param numRelaxationSteps the number of Lloyd's relaxation steps in the Voronoi iteration
+     * @param elementTargetArea the requested average target area of elements in the mesh
+     */
+    ReleasableVoronoiVertexMeshGenerator(unsigned numElementsX,
+                                         unsigned numElementsY,
+                                         unsigned numRelaxationSteps,
+                                         double elementTargetArea)
+        : VoronoiVertexMeshGenerator(numElementsX, numElementsY, numRelaxationSteps, elementTargetArea)
+    {
+    }
+
+    /**
+     * Release ownership of the generated mesh.  The generator no longer refers to the mesh, and will not delete it.
+     *
+     * @return an owning pointer to the generated mesh
+     */
+    std::unique_ptr<MutableVertexMesh<2, 2>> ReleaseMesh()
+    {
+        std::unique_ptr<MutableVertexMesh<2, 2>> p_mesh(mpMesh);
+        mpMesh = nullptr;
+        return p_mesh;
+    }
+};
 
 VoronoiImmersedBoundaryMeshGenerator::VoronoiImmersedBoundaryMeshGenerator(unsigned numElementsX,
                                                                            unsigned numElementsY,
@@ -54,7 +105,10 @@ VoronoiImmersedBoundaryMeshGenerator::VoronoiImmersedBoundaryMeshGenerator(unsig
                                                                            unsigned numFluidGridPoints,
                                                                            double maxWidthOrHeightOfMesh,
                                                                            double absoluteGapBetweenElements,
-                                                                           double targetNodeSpacingRatio)
+                                                                           double targetNodeSpacingRatio,
+                                                                           unsigned numThreads,
+                                                                           bool useMeshCache,
+                                                                           bool useMortonOrdering)
         : mpIbMesh(nullptr),
           mpVertexMesh(nullptr),
           mNumElementsX(numElementsX),
@@ -63,7 +117,11 @@ VoronoiImmersedBoundaryMeshGenerator::VoronoiImmersedBoundaryMeshGenerator(unsig
           mNumFluidGridPoints(numFluidGridPoints),
           mMaxWidthOrHeightOfMesh(maxWidthOrHeightOfMesh),
           mAbsoluteGapBetweenElements(absoluteGapBetweenElements),
-          mTargetNodeSpacingRatio(targetNodeSpacingRatio)
+          mTargetNodeSpacingRatio(targetNodeSpacingRatio),
+          mNumThreads(numThreads),
+          mUseMortonOrdering(useMortonOrdering),
+          mMeshCacheDirectory("CachedImmersedBoundaryMeshes/"),
+          mMeshCacheFileName("")
 {
     assert(maxWidthOrHeightOfMesh > 0.0);
     assert(maxWidthOrHeightOfMesh <= 1.0);
@@ -71,259 +129,716 @@ VoronoiImmersedBoundaryMeshGenerator::VoronoiImmersedBoundaryMeshGenerator(unsig
     assert(absoluteGapBetweenElements > 0.0);
     assert(absoluteGapBetweenElements < 1.0);
 
+    if (numThreads == 0u)
+    {
+        EXCEPTION("The number of threads must be at least 1.");
+    }
+
     // Scaling necessary to correctly pre-size the vertex mesh to lie in a subset of [0, maxWidthOrHeightOfMesh]^2
     const auto max_x_y = std::max(numElementsX, numElementsY);
     const double target_area = (mMaxWidthOrHeightOfMesh * mMaxWidthOrHeightOfMesh) / (max_x_y * max_x_y);
 
-    // Get a Mutable Vertex Mesh from the existing voronoi generator, and perform a deep copy into mpVertexMesh
+    // A previous generator with the same parameters, starting from the same random number generator state, may
+    // already have produced this mesh
+    if (useMeshCache)
     {
-        VoronoiVertexMeshGenerator vertex_mesh_gen(mNumElementsX, mNumElementsY, mNumRelaxationSteps, target_area);
-        DeepCopyAndRepositionVertexMesh(vertex_mesh_gen.GetMesh());
+        OutputFileHandler cache_handler(mMeshCacheDirectory, false);
+        mMeshCacheFileName = cache_handler.GetOutputDirectoryFullPath() + GetMeshCacheKey() + ".bin";
+
+        if (LoadFromMeshCache(mMeshCacheFileName))
+        {
+            return;
+        }
+    }
+
+    // Get a Mutable Vertex Mesh from the existing voronoi generator, and take ownership of it in mpVertexMesh
+    {
+        ReleasableVoronoiVertexMeshGenerator vertex_mesh_gen(mNumElementsX, mNumElementsY, mNumRelaxationSteps, target_area);
+        RepositionVertexMesh(vertex_mesh_gen.ReleaseMesh());
     }
 
     // Use mpVertexMesh to create an IB mesh in mpIbMesh with the same geometry
     GenerateImmersedBoundaryMesh();
+
+    if (useMeshCache)
+    {
+        SaveToMeshCache(mMeshCacheFileName);
+    }
 }
 
-void VoronoiImmersedBoundaryMeshGenerator::DeepCopyAndRepositionVertexMesh(MutableVertexMesh<2, 2>* pMeshToCopy)
+c_vector<double, 2> VoronoiImmersedBoundaryMeshGenerator::GetRepositioningVector() const
 {
-    assert(pMeshToCopy != nullptr);
-
-    // We need to construct new nodes and elements so we don't have mpVertexMesh sharing data with pMeshToCopy
-    std::vector<Node<2>*> new_nodes;
-    std::vector<VertexElement<2,2>*> new_elems;
-
-    // Determine the vector necessary to reposition the mesh to the centre of [0,1]x[0,1]
     const bool longer_in_x = mNumElementsY < mNumElementsX;
     const double length_ratio = longer_in_x ? (double) mNumElementsY / mNumElementsX : (double) mNumElementsX / mNumElementsY;
 
     const double long_margin = 0.5 * (1.0 - mMaxWidthOrHeightOfMesh);
     const double short_margin = 0.5 * (1.0 - (mMaxWidthOrHeightOfMesh * length_ratio));
 
-    const auto correction = longer_in_x ? Create_c_vector(short_margin, long_margin) : Create_c_vector(long_margin, short_margin);
+    return longer_in_x ? Create_c_vector(short_margin, long_margin) : Create_c_vector(long_margin, short_margin);
+}
 
-    // Copy nodes
-    for (unsigned node_idx = 0 ; node_idx < pMeshToCopy->GetNumNodes() ; node_idx++)
+void VoronoiImmersedBoundaryMeshGenerator::RepositionVertexMesh(std::unique_ptr<MutableVertexMesh<2, 2>> pMesh)
+{
+    assert(pMesh != nullptr);
+
+    // Translate the nodes in place to the centre of [0,1]x[0,1]
+    const c_vector<double, 2> correction = GetRepositioningVector();
+    for (unsigned node_idx = 0; node_idx < pMesh->GetNumNodes(); ++node_idx)
     {
-        const Node<2>* p_node_to_copy = pMeshToCopy->GetNode(node_idx);
+        pMesh->GetNode(node_idx)->rGetModifiableLocation() += correction;
+    }
+
+    mpVertexMesh = std::move(pMesh);
+}
 
-        // Get all the information about the node we are copying
-        const unsigned copy_index = p_node_to_copy->GetIndex();
-        const bool copy_is_boundary = p_node_to_copy->IsBoundaryNode();
-        const c_vector<double, 2>& copy_location = p_node_to_copy->rGetLocation();
+void VoronoiImmersedBoundaryMeshGenerator::GenerateImmersedBoundaryMesh()
+{
+    assert(mpVertexMesh != nullptr);
 
-        // We assume the nodes are sequentially ordered. This should be the case as the mesh is from a generator.
-        assert(copy_index == node_idx);
+    // Containers in which to store the new nodes and elements
+    std::vector<Node<2>*> new_nodes;
+    std::vector<ImmersedBoundaryElement<2,2>*> new_elems;
+
+    const unsigned num_elems = mpVertexMesh->GetNumElements();
 
-        // Create a new node and emplace it at the back of new_nodes, with corrected location
-        new_nodes.emplace_back(new Node<2>(copy_index, copy_location + correction, copy_is_boundary));
+    // Shrink every polygon.  Elements are independent, so this may be shared between threads.
+    std::vector<std::vector<c_vector<double, 2>>> vertex_locations_by_elem(num_elems);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(mNumThreads)
+#endif
+    {
+        // Workspace reused for every element handled by this thread
+        std::vector<c_vector<double, 2>> shrink_scratch;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            VertexElement<2, 2>* const p_vertex_elem = mpVertexMesh->GetElement(elem_idx);
+
+            // Get the original locations of nodes in the current element
+            std::vector<c_vector<double, 2>>& r_vertex_locations = vertex_locations_by_elem[elem_idx];
+            r_vertex_locations.reserve(p_vertex_elem->GetNumNodes());
+            for (unsigned local_idx = 0; local_idx < p_vertex_elem->GetNumNodes(); ++local_idx)
+            {
+                r_vertex_locations.emplace_back(p_vertex_elem->GetNode(local_idx)->rGetLocation());
+            }
+
+            ShrinkPolygon(r_vertex_locations, shrink_scratch);
+        }
     }
 
-    // Copy elements
-    for (unsigned elem_idx = 0; elem_idx < pMeshToCopy->GetNumElements(); elem_idx++)
+    // Calculate the IB node locations by evenly spacing along the path defined by the vertex locations.  Permuting
+    // the path draws from the RandomNumberGenerator, so this is done in element order on a single thread.
+    const bool closed_path = true;
+    const bool permute_path = true;  // permute the path to remove any bias from consistent starting location
+    const double ideal_node_spacing = mTargetNodeSpacingRatio / mNumFluidGridPoints;
+
+    std::vector<std::vector<c_vector<double, 2>>> ib_node_locations_by_elem(num_elems);
+    std::vector<unsigned> first_node_idx_by_elem(num_elems + 1u, 0u);
+    for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
     {
-        const VertexElement<2,2>* p_elem_to_copy = pMeshToCopy->GetElement(elem_idx);
+        ib_node_locations_by_elem[elem_idx] = EvenlySpaceAlongPath(vertex_locations_by_elem[elem_idx],
+                                                                   closed_path,
+                                                                   permute_path,
+                                                                   0u,
+                                                                   ideal_node_spacing);
+
+        // Prefix sum of node counts gives each element's nodes the same global indices as if created one by one
+        first_node_idx_by_elem[elem_idx + 1u] = first_node_idx_by_elem[elem_idx] +
+                                                ib_node_locations_by_elem[elem_idx].size();
+    }
 
-        // Get the information relating to the element we are copying
-        const unsigned copy_index     = p_elem_to_copy->GetIndex();
-        const unsigned copy_num_nodes = p_elem_to_copy->GetNumNodes();
+    // The index given to each node, in the order created above, which is the identity unless reordering.  Elements
+    // are never reordered, so that each keeps the index of the vertex element it was generated from.
+    std::vector<unsigned> new_node_idx_by_node(first_node_idx_by_elem.back());
+    std::iota(new_node_idx_by_node.begin(), new_node_idx_by_node.end(), 0u);
 
-        // The vertex element is created from a vector of nodes
-        std::vector<Node<2>*> nodes_this_elem;
+    if (mUseMortonOrdering)
+    {
+        std::vector<c_vector<double, 2>> node_locations(first_node_idx_by_elem.back());
+        for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+        {
+            for (unsigned local_idx = 0; local_idx < ib_node_locations_by_elem[elem_idx].size(); ++local_idx)
+            {
+                node_locations[first_node_idx_by_elem[elem_idx] + local_idx] =
+                        RepositionToUnitSquare(ib_node_locations_by_elem[elem_idx][local_idx]);
+            }
+        }
 
-        // Loop through the nodes in p_elem_to_copy and add the corresponding nodes that we have already copied
-        for (unsigned node_local_idx = 0 ; node_local_idx < copy_num_nodes ; node_local_idx++)
+        const std::vector<unsigned> node_ordering = ImmersedBoundaryMortonOrdering<2>::CalculateOrdering(node_locations);
+        for (unsigned new_idx = 0; new_idx < node_ordering.size(); ++new_idx)
         {
-            const Node<2>* p_local_node = p_elem_to_copy->GetNode(node_local_idx);
-            const unsigned local_node_global_idx = p_local_node->GetIndex();
+            new_node_idx_by_node[node_ordering[new_idx]] = new_idx;
+        }
+    }
+
+    new_nodes.resize(first_node_idx_by_elem.back(), nullptr);
+    new_elems.resize(num_elems, nullptr);
 
-            nodes_this_elem.emplace_back(new_nodes[local_node_global_idx]);
+    // Create the nodes and elements.  Each element only touches its own nodes and slots in new_nodes and new_elems.
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(mNumThreads) schedule(dynamic, 16)
+#endif
+    for (unsigned elem_idx = 0; elem_idx < num_elems; ++elem_idx)
+    {
+        const std::vector<c_vector<double, 2>>& r_ib_node_locations = ib_node_locations_by_elem[elem_idx];
+
+        // Evaluate the splines at equally-spaced points to create new nodes for the IB mesh at required locations
+        std::vector<Node<2>*> nodes_this_elem;
+        nodes_this_elem.reserve(r_ib_node_locations.size());
+        for (unsigned local_idx = 0; local_idx < r_ib_node_locations.size(); ++local_idx)
+        {
+            const unsigned node_idx = new_node_idx_by_node[first_node_idx_by_elem[elem_idx] + local_idx];
+            new_nodes[node_idx] = new Node<2>(node_idx, RepositionToUnitSquare(r_ib_node_locations[local_idx]), true);
+            nodes_this_elem.emplace_back(new_nodes[node_idx]);
         }
 
-        // Create a new element and emplace it at the back of new_nodes
-        new_elems.emplace_back(new VertexElement<2,2>(copy_index, nodes_this_elem));
+        // Create the element and set whether it is on the boundary or not
+        new_elems[elem_idx] = new ImmersedBoundaryElement<2, 2>(elem_idx, nodes_this_elem);
+        new_elems[elem_idx]->SetIsBoundaryElement(mpVertexMesh->GetElement(elem_idx)->IsElementOnBoundary());
     }
 
-    mpVertexMesh = our::make_unique<MutableVertexMesh<2,2>>(new_nodes, new_elems);
+    // No use case yet for laminas in this type of simulation
+    std::vector<ImmersedBoundaryElement<1,2>*> empty_laminas_vec{};
+
+    mpIbMesh = our::make_unique<ImmersedBoundaryMesh<2, 2>>(new_nodes, new_elems, empty_laminas_vec, mNumFluidGridPoints, mNumFluidGridPoints);
+
+    ReplaceBalancingFluidSources();
 }
 
-void VoronoiImmersedBoundaryMeshGenerator::GenerateImmersedBoundaryMesh()
+c_vector<double, 2> VoronoiImmersedBoundaryMeshGenerator::RepositionToUnitSquare(const c_vector<double, 2>& rLocation)
+{
+    double x = rLocation[0];
+    double y = rLocation[1];
+
+    while(x < 0.0){x += 1.0;}
+    while(x >= 1.0){x -= 1.0;}
+    while(y < 0.0){y += 1.0;}
+    while(y >= 1.0){y -= 1.0;}
+
+    return Create_c_vector(x, y);
+}
+
+void VoronoiImmersedBoundaryMeshGenerator::ReplaceBalancingFluidSources()
 {
+    assert(mpIbMesh != nullptr);
     assert(mpVertexMesh != nullptr);
 
-    // Containers in which to store the new nodes and elements
-    std::vector<Node<2>*> new_nodes;
-    std::vector<ImmersedBoundaryElement<2,2>*> new_elems;
+    // Replace the default balancing fluid sources with a source at each vertex
+    auto& r_balancing_sources = mpIbMesh->rGetBalancingFluidSources();
 
-    // Reposition a c_vector to lie within the unit square
-    auto RepositionToUnitSquare = [](const c_vector<double, 2>& a)->c_vector<double, 2>
+    for (auto& source : r_balancing_sources)
     {
-        double x = a[0];
-        double y = a[1];
+        delete(source);
+    }
+    r_balancing_sources.clear();
 
-        while(x < 0.0){x += 1.0;}
-        while(x >= 1.0){x -= 1.0;}
-        while(y < 0.0){y += 1.0;}
-        while(y >= 1.0){y -= 1.0;}
+    std::vector<c_vector<double, 2>> source_locations;
+    source_locations.reserve(mpVertexMesh->GetNumNodes());
+    for (unsigned node_idx = 0; node_idx < mpVertexMesh->GetNumNodes(); ++node_idx)
+    {
+        source_locations.emplace_back(RepositionToUnitSquare(mpVertexMesh->GetNode(node_idx)->rGetLocation()));
+    }
 
-        return Create_c_vector(x, y);
-    };
+    std::vector<unsigned> source_ordering(source_locations.size());
+    std::iota(source_ordering.begin(), source_ordering.end(), 0u);
+    if (mUseMortonOrdering)
+    {
+        source_ordering = ImmersedBoundaryMortonOrdering<2>::CalculateOrdering(source_locations);
+    }
 
-    for (unsigned elem_idx = 0; elem_idx < mpVertexMesh->GetNumElements(); ++elem_idx)
+    r_balancing_sources.reserve(source_locations.size());
+    for (const unsigned node_idx : source_ordering)
     {
-        VertexElement<2, 2>* const p_vertex_elem = mpVertexMesh->GetElement(elem_idx);
+        const auto idx = r_balancing_sources.size();
+        r_balancing_sources.emplace_back(new FluidSource<2>(idx, source_locations[node_idx]));
+        r_balancing_sources.back()->SetStrength(0.0);
+    }
+}
+
+void VoronoiImmersedBoundaryMeshGenerator::ShrinkPolygon(std::vector<c_vector<double, 2>>& rVertexLocations,
+                                                         std::vector<c_vector<double, 2>>& rScratch) const
+{
+    // Determine the shortest length edge to get a sensible number of steps for performing the reduction
+    double shortest_edge_length = DBL_MAX;
+    for (unsigned local_idx = 0; local_idx < rVertexLocations.size(); ++local_idx)
+    {
+        const unsigned next_idx = AdvanceMod(local_idx, 1, rVertexLocations.size());
+        const double edge_length = norm_2(rVertexLocations[next_idx] - rVertexLocations[local_idx]);
 
-        // Get the original locations of nodes in the current element
-        std::vector<c_vector<double, 2>> vertex_locations;
-        for (unsigned local_idx = 0; local_idx < p_vertex_elem->GetNumNodes(); ++local_idx)
+        if (edge_length < shortest_edge_length)
         {
-            vertex_locations.emplace_back(p_vertex_elem->GetNode(local_idx)->rGetLocation());
+            shortest_edge_length = edge_length;
         }
+    }
+
+    // Proceed with repositioning in small increments so as not to run in to problems of multiple intersections.
+    // We want to move no more than half the shortest edge length in any given step.
+    const auto num_steps = std::lround(std::max(1.0, 2.0 * mAbsoluteGapBetweenElements / shortest_edge_length));
+    const double step_dist = mAbsoluteGapBetweenElements / num_steps;
 
-        // Determine the shortest length edge to get a sensible number of steps for performing the reduction
-        double shortest_edge_length = DBL_MAX;
-        for (unsigned local_idx = 0; local_idx < vertex_locations.size(); ++local_idx)
+    for (unsigned step = 0; step < num_steps; ++step)
+    {
+        for (unsigned node_local_idx = 0; node_local_idx < rVertexLocations.size(); ++node_local_idx)
         {
-            const unsigned next_idx = AdvanceMod(local_idx, 1, vertex_locations.size());
-            const double edge_length = norm_2(vertex_locations[next_idx] - vertex_locations[local_idx]);
+            const unsigned next_idx = AdvanceMod(node_local_idx, 1, rVertexLocations.size());
+            const unsigned prev_idx = AdvanceMod(node_local_idx, -1, rVertexLocations.size());
 
-            if (edge_length < shortest_edge_length)
-            {
-                shortest_edge_length = edge_length;
-            }
+            const c_vector<double, 2>& this_pos = rVertexLocations[node_local_idx];
+            const c_vector<double, 2>& next_pos = rVertexLocations[next_idx];
+            const c_vector<double, 2>& prev_pos = rVertexLocations[prev_idx];
+
+            // We need to bisect the angle that this node makes with the previous and the next, and walk the node in
+            // along the line of bisection
+            const c_vector<double, 2> unit_vec_to_next = (next_pos - this_pos) / norm_2(next_pos - this_pos);
+            const c_vector<double, 2> unit_vec_to_prev = (prev_pos - this_pos) / norm_2(prev_pos - this_pos);
+            const c_vector<double, 2> unit_bisecting_vec = 0.5 * (unit_vec_to_next + unit_vec_to_prev);
+
+            const double angle_of_bisection = std::acos(inner_prod(unit_bisecting_vec, unit_vec_to_prev));
+            const double length = step_dist / std::sin(angle_of_bisection);
+
+            rVertexLocations[node_local_idx] = this_pos + length * unit_bisecting_vec;
         }
 
-        // Proceed with repositioning in small increments so as not to run in to problems of multiple intersections.
-        // We want to move no more than half the shortest edge length in any given step.
-        const auto num_steps = std::lround(std::max(1.0, 2.0 * mAbsoluteGapBetweenElements / shortest_edge_length));
-        const double step_dist = mAbsoluteGapBetweenElements / num_steps;
+        // Now check for intersections caused by small edges becoming inverted due to movement.  Each segment i runs
+        // from vertex i to vertex i+1 as they were before any merging on this step, so test against a snapshot.
+        rScratch.assign(rVertexLocations.begin(), rVertexLocations.end());
+        const unsigned num_segments = rScratch.size();
 
-        for (unsigned step = 0; step < num_steps; ++step)
+        bool intersections_this_elem = false;
+        for (unsigned segment = 0; segment < num_segments; ++segment)
         {
-            for (unsigned node_local_idx = 0; node_local_idx < vertex_locations.size(); ++node_local_idx)
+            const unsigned next_idx = AdvanceMod(segment, 1, num_segments);
+            const unsigned next_next = AdvanceMod(segment, 2, num_segments);
+            const unsigned next_next_next = AdvanceMod(segment, 3, num_segments);
+
+            c_vector<double, 2> merged_location;
+            if (CalculateSegmentIntersection(rScratch[segment], rScratch[next_idx],
+                                             rScratch[next_next], rScratch[next_next_next], merged_location))
             {
-                const unsigned next_idx = AdvanceMod(node_local_idx, 1, vertex_locations.size());
-                const unsigned prev_idx = AdvanceMod(node_local_idx, -1, vertex_locations.size());
+                intersections_this_elem = true;
+
+                // Intersection between segment i and i+2, so segment i+1 needs merging.
+                // Segment i+1 has scaled_location[i+1] & scaled_location[i+2]
+                rVertexLocations[next_idx] = merged_location;
+                rVertexLocations[next_next] = merged_location;
+            }
+        }
 
-                const c_vector<double, 2>& this_pos = vertex_locations[node_local_idx];
-                const c_vector<double, 2>& next_pos = vertex_locations[next_idx];
-                const c_vector<double, 2>& prev_pos = vertex_locations[prev_idx];
+        // Clear out the vertex locations vector of duplicate values
+        if (intersections_this_elem)
+        {
+            // Erase all but the first consecutive identical element
+            auto last = std::unique(rVertexLocations.begin(), rVertexLocations.end(),
+                                    [](const c_vector<double, 2>& a, const c_vector<double, 2>& b)
+                                    {
+                                        return a[0] == b[0] && a[1] == b[1];
+                                    });
+            rVertexLocations.erase(last, rVertexLocations.end());
+        }
+    }
+}
 
-                // We need to bisect the angle that this node makes with the previous and the next, and walk the node in
-                // along the line of bisection
-                const c_vector<double, 2> unit_vec_to_next = (next_pos - this_pos) / norm_2(next_pos - this_pos);
-                const c_vector<double, 2> unit_vec_to_prev = (prev_pos - this_pos) / norm_2(prev_pos - this_pos);
-                const c_vector<double, 2> unit_bisecting_vec = 0.5 * (unit_vec_to_next + unit_vec_to_prev);
+bool VoronoiImmersedBoundaryMeshGenerator::CalculateSegmentIntersection(const c_vector<double, 2>& rA,
+                                                                       const c_vector<double, 2>& rB,
+                                                                       const c_vector<double, 2>& rC,
+                                                                       const c_vector<double, 2>& rD,
+                                                                       c_vector<double, 2>& rIntersection)
+{
+    // Twice the signed area of the triangle pqr: positive if r is to the left of the directed line pq
+    auto Orientation = [](const c_vector<double, 2>& p, const c_vector<double, 2>& q, const c_vector<double, 2>& r)
+    {
+        return (q[0] - p[0]) * (r[1] - p[1]) - (q[1] - p[1]) * (r[0] - p[0]);
+    };
 
-                const double angle_of_bisection = std::acos(inner_prod(unit_bisecting_vec, unit_vec_to_prev));
-                const double length = step_dist / std::sin(angle_of_bisection);
+    // Whether r, known to be collinear with pq, lies within the bounding box of pq
+    auto OnSegment = [](const c_vector<double, 2>& p, const c_vector<double, 2>& q, const c_vector<double, 2>& r)
+    {
+        return std::min(p[0], q[0]) <= r[0] && r[0] <= std::max(p[0], q[0]) &&
+               std::min(p[1], q[1]) <= r[1] && r[1] <= std::max(p[1], q[1]);
+    };
 
-                vertex_locations[node_local_idx] = this_pos + length * unit_bisecting_vec;
-            }
+    const double orient_c = Orientation(rA, rB, rC);
+    const double orient_d = Orientation(rA, rB, rD);
+    const double orient_a = Orientation(rC, rD, rA);
+    const double orient_b = Orientation(rC, rD, rB);
 
-            // Now check for intersections caused by small edges becoming inverted due to movement
-            using geom_point = boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian>;
-            using geom_segment = boost::geometry::model::segment<geom_point>;
+    // Collinear segments either miss each other or overlap along a length, with no unique intersection
+    if (orient_c == 0.0 && orient_d == 0.0)
+    {
+        return false;
+    }
 
-            std::vector<geom_segment> line_segments;
-            line_segments.reserve(vertex_locations.size());
+    const bool straddle_ab = (orient_c > 0.0 && orient_d < 0.0) || (orient_c < 0.0 && orient_d > 0.0);
+    const bool straddle_cd = (orient_a > 0.0 && orient_b < 0.0) || (orient_a < 0.0 && orient_b > 0.0);
 
-            for (unsigned idx = 0; idx < vertex_locations.size(); ++idx)
-            {
-                const c_vector<double, 2>& this_pos = vertex_locations[idx];
-                const c_vector<double, 2>& next_pos = vertex_locations[AdvanceMod(idx, 1, vertex_locations.size())];
+    // Touching cases: an end point of one segment lies on the other
+    if (!(straddle_ab && straddle_cd))
+    {
+        if (orient_c == 0.0 && OnSegment(rA, rB, rC))
+        {
+            rIntersection = rC;
+            return true;
+        }
+        if (orient_d == 0.0 && OnSegment(rA, rB, rD))
+        {
+            rIntersection = rD;
+            return true;
+        }
+        if (orient_a == 0.0 && OnSegment(rC, rD, rA))
+        {
+            rIntersection = rA;
+            return true;
+        }
+        if (orient_b == 0.0 && OnSegment(rC, rD, rB))
+        {
+            rIntersection = rB;
+            return true;
+        }
+        return false;
+    }
 
-                line_segments.emplace_back(geom_point(this_pos[0], this_pos[1]),
-                                           geom_point(next_pos[0], next_pos[1]));
-            }
+    // Proper crossing: the ratio of the signed distances of c and d from ab locates the crossing along cd
+    const double t = orient_c / (orient_c - orient_d);
+    rIntersection = rC + t * (rD - rC);
+    return true;
+}
 
-            bool intersections_this_elem = false;
-            for (unsigned segment = 0; segment < line_segments.size(); ++segment)
-            {
-                unsigned next_next = AdvanceMod(segment, 2, line_segments.size());
+std::string VoronoiImmersedBoundaryMeshGenerator::GetRandomNumberGeneratorState()
+{
+    std::ostringstream state;
+    {
+        boost::archive::text_oarchive output_arch(state);
+        const RandomNumberGenerator& r_gen = *RandomNumberGenerator::Instance();
+        output_arch << r_gen;
+    }
+    return state.str();
+}
 
-                if (boost::geometry::intersects(line_segments[segment], line_segments[next_next]))
-                {
-                    intersections_this_elem = true;
+void VoronoiImmersedBoundaryMeshGenerator::SetRandomNumberGeneratorState(const std::string& rState)
+{
+    std::istringstream state(rState);
+    boost::archive::text_iarchive input_arch(state);
+    RandomNumberGenerator& r_gen = *RandomNumberGenerator::Instance();
+    input_arch >> r_gen;
+}
+
+std::string VoronoiImmersedBoundaryMeshGenerator::GetMeshCacheKey() const
+{
+    // 64-bit FNV-1a hash of everything that determines the generated mesh
+    std::uint64_t hash = 14695981039346656037ull;
+    auto HashBytes = [&hash](const void* pData, std::size_t numBytes)
+    {
+        const unsigned char* p_bytes = static_cast<const unsigned char*>(pData);
+        for (std::size_t byte_idx = 0; byte_idx < numBytes; ++byte_idx)
+        {
+            hash ^= p_bytes[byte_idx];
+            hash *= 1099511628211ull;
+        }
+    };
 
-                    std::vector<geom_point> intersection;
-                    boost::geometry::intersection(line_segments[segment], line_segments[next_next], intersection);
-                    assert(intersection.size() == 1);
+    const std::uint32_t version = MESH_CACHE_VERSION;
+    HashBytes(&version, sizeof(version));
+    HashBytes(&mNumElementsX, sizeof(mNumElementsX));
+    HashBytes(&mNumElementsY, sizeof(mNumElementsY));
+    HashBytes(&mNumRelaxationSteps, sizeof(mNumRelaxationSteps));
+    HashBytes(&mNumFluidGridPoints, sizeof(mNumFluidGridPoints));
+    HashBytes(&mMaxWidthOrHeightOfMesh, sizeof(mMaxWidthOrHeightOfMesh));
+    HashBytes(&mAbsoluteGapBetweenElements, sizeof(mAbsoluteGapBetweenElements));
+    HashBytes(&mTargetNodeSpacingRatio, sizeof(mTargetNodeSpacingRatio));
+    HashBytes(&mUseMortonOrdering, sizeof(mUseMortonOrdering));
+
+    const std::string rng_state = GetRandomNumberGeneratorState();
+    HashBytes(rng_state.data(), rng_state.size());
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
 
-                    // Intersection between segment i and i+2, so segment i+1 needs merging.
-                    // Segment i+1 has scaled_location[i+1] & scaled_location[i+2]
-                    const unsigned start_idx = AdvanceMod(segment, 1, line_segments.size());
-                    const unsigned end_idx = AdvanceMod(segment, 2, line_segments.size());
+void VoronoiImmersedBoundaryMeshGenerator::SaveToMeshCache(const std::string& rFileName) const
+{
+    assert(mpIbMesh != nullptr);
+    assert(mpVertexMesh != nullptr);
 
+    // Flatten both meshes into the arrays stored in the file, in the file order
+    std::vector<double> vertex_node_locations;
+    std::vector<double> ib_node_locations;
+    std::vector<std::uint32_t> vertex_elem_offsets{0u};
+    std::vector<std::uint32_t> vertex_elem_node_indices;
+    std::vector<std::uint32_t> ib_elem_offsets{0u};
+    std::vector<std::uint32_t> ib_elem_node_indices;
+    std::vector<std::uint8_t> vertex_node_is_boundary;
+    std::vector<std::uint8_t> ib_elem_is_boundary;
 
-                    const c_vector<double, 2> merged_location = Create_c_vector(intersection[0].get<0>(),
-                                                                                intersection[0].get<1>());
-                    vertex_locations[start_idx] = merged_location;
-                    vertex_locations[end_idx] = merged_location;
-                }
-            }
+    for (unsigned node_idx = 0; node_idx < mpVertexMesh->GetNumNodes(); ++node_idx)
+    {
+        const Node<2>* p_node = mpVertexMesh->GetNode(node_idx);
+        vertex_node_locations.emplace_back(p_node->rGetLocation()[0]);
+        vertex_node_locations.emplace_back(p_node->rGetLocation()[1]);
+        vertex_node_is_boundary.emplace_back(p_node->IsBoundaryNode() ? 1u : 0u);
+    }
 
-            // Clear out the vertex_locations vector of duplicate values
-            if (intersections_this_elem)
-            {
-                // Erase all but the first consecutive identical element
-                auto last = std::unique(vertex_locations.begin(), vertex_locations.end(),
-                                        [](const c_vector<double, 2>& a, const c_vector<double, 2>& b)
-                                        {
-                                            return a[0] == b[0] && a[1] == b[1];
-                                        });
-                vertex_locations.erase(last, vertex_locations.end());
-            }
+    for (unsigned node_idx = 0; node_idx < mpIbMesh->GetNumNodes(); ++node_idx)
+    {
+        ib_node_locations.emplace_back(mpIbMesh->GetNode(node_idx)->rGetLocation()[0]);
+        ib_node_locations.emplace_back(mpIbMesh->GetNode(node_idx)->rGetLocation()[1]);
+    }
+
+    for (unsigned elem_idx = 0; elem_idx < mpVertexMesh->GetNumElements(); ++elem_idx)
+    {
+        const VertexElement<2, 2>* p_elem = mpVertexMesh->GetElement(elem_idx);
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+        {
+            vertex_elem_node_indices.emplace_back(p_elem->GetNodeGlobalIndex(local_idx));
         }
+        vertex_elem_offsets.emplace_back(vertex_elem_node_indices.size());
+    }
 
-        // Calculate the IB node locations by evenly spacing along the path defined by the vertex locations
-        const bool closed_path = true;
-        const bool permute_path = true;  // permute the path to remove any bias from consistent starting location
-        const double ideal_node_spacing = mTargetNodeSpacingRatio / mNumFluidGridPoints;
-        std::vector<c_vector<double, 2>> ib_node_locations = EvenlySpaceAlongPath(vertex_locations,
-                                                                                  closed_path,
-                                                                                  permute_path,
-                                                                                  0u,
-                                                                                  ideal_node_spacing);
+    for (unsigned elem_idx = 0; elem_idx < mpIbMesh->GetNumElements(); ++elem_idx)
+    {
+        const ImmersedBoundaryElement<2, 2>* p_elem = mpIbMesh->GetElement(elem_idx);
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+        {
+            ib_elem_node_indices.emplace_back(p_elem->GetNodeGlobalIndex(local_idx));
+        }
+        ib_elem_offsets.emplace_back(ib_elem_node_indices.size());
+        ib_elem_is_boundary.emplace_back(p_elem->IsElementOnBoundary() ? 1u : 0u);
+    }
 
+    // The generator state afterwards, so a cache hit leaves the random number generator as generation would
+    const std::string rng_state = GetRandomNumberGeneratorState();
+
+    MeshCacheHeader header;
+    header.mMagic = MESH_CACHE_MAGIC;
+    header.mVersion = MESH_CACHE_VERSION;
+    header.mNumVertexNodes = vertex_node_is_boundary.size();
+    header.mNumVertexElements = vertex_elem_offsets.size() - 1u;
+    header.mNumVertexElementNodeIndices = vertex_elem_node_indices.size();
+    header.mNumIbNodes = ib_node_locations.size() / 2u;
+    header.mNumIbElements = ib_elem_is_boundary.size();
+    header.mNumIbElementNodeIndices = ib_elem_node_indices.size();
+    header.mRngStateLength = rng_state.size();
+
+    // Write to a temporary file and rename it, so that simultaneous runs never see a partially-written cache
+    const std::string temp_file_name = rFileName + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temp_file_name, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            EXCEPTION("Could not open mesh cache file " + temp_file_name + " for writing.");
+        }
 
-        // Evaluate the splines at equally-spaced points to create new nodes for the IB mesh at required locations
-        std::vector<Node<2>*> nodes_this_elem;
-        nodes_this_elem.reserve(ib_node_locations.size());
-        for (const auto& location : ib_node_locations)
+        auto Write = [&file](const void* pData, std::size_t numBytes)
         {
-            new_nodes.emplace_back(new Node<2>(new_nodes.size(), RepositionToUnitSquare(location), true));
-            nodes_this_elem.emplace_back(new_nodes.back());
+            file.write(static_cast<const char*>(pData), numBytes);
+        };
+
+        Write(&header, sizeof(header));
+        Write(vertex_node_locations.data(), vertex_node_locations.size() * sizeof(double));
+        Write(ib_node_locations.data(), ib_node_locations.size() * sizeof(double));
+        Write(vertex_elem_offsets.data(), vertex_elem_offsets.size() * sizeof(std::uint32_t));
+        Write(vertex_elem_node_indices.data(), vertex_elem_node_indices.size() * sizeof(std::uint32_t));
+        Write(ib_elem_offsets.data(), ib_elem_offsets.size() * sizeof(std::uint32_t));
+        Write(ib_elem_node_indices.data(), ib_elem_node_indices.size() * sizeof(std::uint32_t));
+        Write(vertex_node_is_boundary.data(), vertex_node_is_boundary.size());
+        Write(ib_elem_is_boundary.data(), ib_elem_is_boundary.size());
+        Write(rng_state.data(), rng_state.size());
+
+        if (!file)
+        {
+            EXCEPTION("Could not write mesh cache file " + temp_file_name + ".");
         }
+    }
 
-        // Create the element and set whether it is on the boundary or not
-        new_elems.emplace_back(new ImmersedBoundaryElement<2, 2>(new_elems.size(), nodes_this_elem));
-        new_elems.back()->SetIsBoundaryElement(p_vertex_elem->IsElementOnBoundary());
+    if (std::rename(temp_file_name.c_str(), rFileName.c_str()) != 0)
+    {
+        std::remove(temp_file_name.c_str());
+        EXCEPTION("Could not move mesh cache file into place at " + rFileName + ".");
     }
+}
 
-    // No use case yet for laminas in this type of simulation
-    std::vector<ImmersedBoundaryElement<1,2>*> empty_laminas_vec{};
+bool VoronoiImmersedBoundaryMeshGenerator::LoadFromMeshCache(const std::string& rFileName)
+{
+    const int file_descriptor = open(rFileName.c_str(), O_RDONLY);
+    if (file_descriptor < 0)
+    {
+        return false;
+    }
 
-    mpIbMesh = our::make_unique<ImmersedBoundaryMesh<2, 2>>(new_nodes, new_elems, empty_laminas_vec, mNumFluidGridPoints, mNumFluidGridPoints);
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0)
+    {
+        close(file_descriptor);
+        return false;
+    }
+    if (static_cast<std::size_t>(file_status.st_size) < sizeof(MeshCacheHeader))
+    {
+        close(file_descriptor);
+        EXCEPTION("Mesh cache file " + rFileName + " is invalid: it is shorter than its header. Delete it to "
+                  "regenerate the mesh.");
+    }
 
-    // Replace the default balancing fluid sources with a source at each vertex
-    auto& r_balancing_sources = mpIbMesh->rGetBalancingFluidSources();
+    const std::size_t file_size = file_status.st_size;
+    void* const p_map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    close(file_descriptor);
+    if (p_map == MAP_FAILED)
+    {
+        return false;
+    }
 
-    for (auto& source : r_balancing_sources)
+    const char* p_data = static_cast<const char*>(p_map);
+    const MeshCacheHeader& r_header = *reinterpret_cast<const MeshCacheHeader*>(p_data);
+
+    // A file of the right name that is not the cache we wrote is corrupt, and is reported rather than used
+    auto ThrowInvalid = [p_map, file_size, &rFileName](const std::string& rReason)
     {
-        delete(source);
+        munmap(p_map, file_size);
+        EXCEPTION("Mesh cache file " + rFileName + " is invalid: " + rReason + ". Delete it to regenerate the mesh.");
+    };
+
+    if (r_header.mMagic != MESH_CACHE_MAGIC)
+    {
+        ThrowInvalid("it is not a mesh cache file");
+    }
+    if (r_header.mVersion != MESH_CACHE_VERSION)
+    {
+        ThrowInvalid("it has layout version " + std::to_string(r_header.mVersion) + " rather than " +
+                     std::to_string(MESH_CACHE_VERSION));
     }
-    r_balancing_sources.clear();
 
-    r_balancing_sources.reserve(mpVertexMesh->GetNumNodes());
-    for (unsigned node_idx = 0; node_idx < mpVertexMesh->GetNumNodes(); ++node_idx)
+    // Sum in 64 bits, so that no header counts can overflow the expected size into agreement with the file size
+    const std::uint64_t expected_size = sizeof(MeshCacheHeader) +
+            sizeof(double) * 2u * (std::uint64_t(r_header.mNumVertexNodes) + r_header.mNumIbNodes) +
+            sizeof(std::uint32_t) * (std::uint64_t(r_header.mNumVertexElements) + 1u +
+                                     r_header.mNumVertexElementNodeIndices + r_header.mNumIbElements + 1u +
+                                     r_header.mNumIbElementNodeIndices) +
+            std::uint64_t(r_header.mNumVertexNodes) + r_header.mNumIbElements + r_header.mRngStateLength;
+    if (file_size != expected_size)
     {
-        const auto idx = r_balancing_sources.size();
-        const auto location = mpVertexMesh->GetNode(node_idx)->rGetLocation();
+        ThrowInvalid("it has " + std::to_string(file_size) + " bytes rather than the " +
+                     std::to_string(expected_size) + " its header describes");
+    }
 
-        r_balancing_sources.emplace_back(new FluidSource<2>(idx, RepositionToUnitSquare(location)));
-        r_balancing_sources.back()->SetStrength(0.0);
+    // Read each array in place from the mapping, in the file order
+    p_data += sizeof(MeshCacheHeader);
+    auto ReadArray = [&p_data](std::size_t numBytes)
+    {
+        const char* p_array = p_data;
+        p_data += numBytes;
+        return p_array;
+    };
+
+    const double* p_vertex_node_locations = reinterpret_cast<const double*>(ReadArray(sizeof(double) * 2u * r_header.mNumVertexNodes));
+    const double* p_ib_node_locations = reinterpret_cast<const double*>(ReadArray(sizeof(double) * 2u * r_header.mNumIbNodes));
+    const std::uint32_t* p_vertex_elem_offsets = reinterpret_cast<const std::uint32_t*>(ReadArray(sizeof(std::uint32_t) * (r_header.mNumVertexElements + 1u)));
+    const std::uint32_t* p_vertex_elem_node_indices = reinterpret_cast<const std::uint32_t*>(ReadArray(sizeof(std::uint32_t) * r_header.mNumVertexElementNodeIndices));
+    const std::uint32_t* p_ib_elem_offsets = reinterpret_cast<const std::uint32_t*>(ReadArray(sizeof(std::uint32_t) * (r_header.mNumIbElements + 1u)));
+    const std::uint32_t* p_ib_elem_node_indices = reinterpret_cast<const std::uint32_t*>(ReadArray(sizeof(std::uint32_t) * r_header.mNumIbElementNodeIndices));
+    const std::uint8_t* p_vertex_node_is_boundary = reinterpret_cast<const std::uint8_t*>(ReadArray(r_header.mNumVertexNodes));
+    const std::uint8_t* p_ib_elem_is_boundary = reinterpret_cast<const std::uint8_t*>(ReadArray(r_header.mNumIbElements));
+    const std::string rng_state(ReadArray(r_header.mRngStateLength), r_header.mRngStateLength);
+
+    // Check every offset and node index before anything is allocated, so that a corrupt file cannot index out of
+    // the mapping or the node arrays
+    auto CheckElements = [&ThrowInvalid](const std::string& rMeshName,
+                                         const std::uint32_t* pOffsets,
+                                         std::uint32_t numElements,
+                                         const std::uint32_t* pNodeIndices,
+                                         std::uint32_t numNodeIndices,
+                                         std::uint32_t numNodes)
+    {
+        if (pOffsets[0] != 0u || pOffsets[numElements] != numNodeIndices)
+        {
+            ThrowInvalid("the " + rMeshName + " element offsets do not span its element node indices");
+        }
+        for (std::uint32_t elem_idx = 0; elem_idx < numElements; ++elem_idx)
+        {
+            if (pOffsets[elem_idx + 1u] < pOffsets[elem_idx])
+            {
+                ThrowInvalid("the " + rMeshName + " element offsets decrease at element " + std::to_string(elem_idx));
+            }
+        }
+        for (std::uint32_t idx = 0; idx < numNodeIndices; ++idx)
+        {
+            if (pNodeIndices[idx] >= numNodes)
+            {
+                ThrowInvalid("the " + rMeshName + " element node index " + std::to_string(pNodeIndices[idx]) +
+                             " is not less than its " + std::to_string(numNodes) + " nodes");
+            }
+        }
+    };
+
+    CheckElements("vertex", p_vertex_elem_offsets, r_header.mNumVertexElements, p_vertex_elem_node_indices,
+                  r_header.mNumVertexElementNodeIndices, r_header.mNumVertexNodes);
+    CheckElements("immersed boundary", p_ib_elem_offsets, r_header.mNumIbElements, p_ib_elem_node_indices,
+                  r_header.mNumIbElementNodeIndices, r_header.mNumIbNodes);
+
+    // Rebuild the vertex mesh
+    std::vector<Node<2>*> vertex_nodes;
+    vertex_nodes.reserve(r_header.mNumVertexNodes);
+    for (unsigned node_idx = 0; node_idx < r_header.mNumVertexNodes; ++node_idx)
+    {
+        const c_vector<double, 2> location = Create_c_vector(p_vertex_node_locations[2u * node_idx],
+                                                             p_vertex_node_locations[2u * node_idx + 1u]);
+        vertex_nodes.emplace_back(new Node<2>(node_idx, location, p_vertex_node_is_boundary[node_idx] != 0u));
+    }
+
+    std::vector<VertexElement<2, 2>*> vertex_elems;
+    vertex_elems.reserve(r_header.mNumVertexElements);
+    for (unsigned elem_idx = 0; elem_idx < r_header.mNumVertexElements; ++elem_idx)
+    {
+        std::vector<Node<2>*> nodes_this_elem;
+        for (std::uint32_t idx = p_vertex_elem_offsets[elem_idx]; idx < p_vertex_elem_offsets[elem_idx + 1u]; ++idx)
+        {
+            nodes_this_elem.emplace_back(vertex_nodes[p_vertex_elem_node_indices[idx]]);
+        }
+        vertex_elems.emplace_back(new VertexElement<2, 2>(elem_idx, nodes_this_elem));
+    }
+
+    // Rebuild the immersed boundary mesh, whose nodes are all boundary nodes
+    std::vector<Node<2>*> ib_nodes;
+    ib_nodes.reserve(r_header.mNumIbNodes);
+    for (unsigned node_idx = 0; node_idx < r_header.mNumIbNodes; ++node_idx)
+    {
+        const c_vector<double, 2> location = Create_c_vector(p_ib_node_locations[2u * node_idx],
+                                                             p_ib_node_locations[2u * node_idx + 1u]);
+        ib_nodes.emplace_back(new Node<2>(node_idx, location, true));
     }
+
+    std::vector<ImmersedBoundaryElement<2, 2>*> ib_elems;
+    ib_elems.reserve(r_header.mNumIbElements);
+    for (unsigned elem_idx = 0; elem_idx < r_header.mNumIbElements; ++elem_idx)
+    {
+        std::vector<Node<2>*> nodes_this_elem;
+        for (std::uint32_t idx = p_ib_elem_offsets[elem_idx]; idx < p_ib_elem_offsets[elem_idx + 1u]; ++idx)
+        {
+            nodes_this_elem.emplace_back(ib_nodes[p_ib_elem_node_indices[idx]]);
+        }
+        ib_elems.emplace_back(new ImmersedBoundaryElement<2, 2>(elem_idx, nodes_this_elem));
+        ib_elems.back()->SetIsBoundaryElement(p_ib_elem_is_boundary[elem_idx] != 0u);
+    }
+
+    munmap(p_map, file_size);
+
+    mpVertexMesh = our::make_unique<MutableVertexMesh<2, 2>>(vertex_nodes, vertex_elems);
+
+    std::vector<ImmersedBoundaryElement<1,2>*> empty_laminas_vec{};
+    mpIbMesh = our::make_unique<ImmersedBoundaryMesh<2, 2>>(ib_nodes, ib_elems, empty_laminas_vec, mNumFluidGridPoints, mNumFluidGridPoints);
+
+    ReplaceBalancingFluidSources();
+
+    SetRandomNumberGeneratorState(rng_state);
+
+    return true;
+}
+
+const std::string& VoronoiImmersedBoundaryMeshGenerator::rGetMeshCacheFileName() const
+{
+    return mMeshCacheFileName;
 }
 
 ImmersedBoundaryMesh<2,2>* VoronoiImmersedBoundaryMeshGenerator::GetMesh()
@@ -336,42 +851,123 @@ MutableVertexMesh<2,2>* VoronoiImmersedBoundaryMeshGenerator::GetMutableVertexMe
     return mpVertexMesh.get();
 }
 
-std::array<unsigned, 13> VoronoiImmersedBoundaryMeshGenerator::GetVertexMeshPolygonDistribution()
+const ElementAdjacency& VoronoiImmersedBoundaryMeshGenerator::rGetVertexMeshAdjacency()
 {
-    std::array<unsigned, 13> polygon_dist = {{0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u}};
+    if (mpVertexMeshAdjacency)
+    {
+        return *mpVertexMeshAdjacency;
+    }
+
+    auto p_adjacency = our::make_unique<ElementAdjacency>();
+    p_adjacency->mRowOffsets.assign(mpVertexMesh->GetNumAllElements() + 1u, 0u);
 
+    // Each element's neighbours are the other elements containing its nodes, gathered into one reused scratch vector
+    std::vector<unsigned> neighbours;
+    for (auto elem_it = mpVertexMesh->GetElementIteratorBegin(); elem_it != mpVertexMesh->GetElementIteratorEnd(); ++elem_it)
+    {
+        const unsigned elem_idx = elem_it->GetIndex();
+
+        neighbours.clear();
+        for (unsigned node_idx = 0; node_idx < elem_it->GetNumNodes(); ++node_idx)
+        {
+            for (const unsigned containing_elem_idx : elem_it->GetNode(node_idx)->rGetContainingElementIndices())
+            {
+                if (containing_elem_idx != elem_idx)
+                {
+                    neighbours.emplace_back(containing_elem_idx);
+                }
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+        p_adjacency->mRowOffsets[elem_idx + 1u] = static_cast<unsigned>(neighbours.size());
+        p_adjacency->mNeighbours.insert(p_adjacency->mNeighbours.end(), neighbours.begin(), neighbours.end());
+    }
+
+    // The iterator visits elements in index order, so the counts become offsets by a running sum
+    std::partial_sum(p_adjacency->mRowOffsets.begin(), p_adjacency->mRowOffsets.end(), p_adjacency->mRowOffsets.begin());
+
+    mpVertexMeshAdjacency = std::move(p_adjacency);
+    return *mpVertexMeshAdjacency;
+}
+
+const VoronoiMeshStatistics& VoronoiImmersedBoundaryMeshGenerator::rGetStatistics()
+{
+    if (mpStatistics)
+    {
+        return *mpStatistics;
+    }
+
+    auto p_statistics = our::make_unique<VoronoiMeshStatistics>();
+
+    // Polygon distribution of the vertex mesh, accumulating all 12+ sided shapes
+    const ElementAdjacency& r_adjacency = rGetVertexMeshAdjacency();
+    p_statistics->mVertexPolygonDistribution.fill(0u);
+    unsigned num_interior_elems = 0u;
     for (auto elem_it = mpVertexMesh->GetElementIteratorBegin(); elem_it != mpVertexMesh->GetElementIteratorEnd(); ++elem_it)
     {
         if (!elem_it->IsElementOnBoundary())
         {
-            // Accumulate all 12+ sided shapes
-            unsigned num_neighbours = std::min<unsigned>(12u, mpVertexMesh->GetNeighbouringElementIndices(elem_it->GetIndex()).size());
-            polygon_dist[num_neighbours]++;
+            p_statistics->mVertexPolygonDistribution[std::min(12u, r_adjacency.GetNumNeighbours(elem_it->GetIndex()))]++;
+            ++num_interior_elems;
         }
     }
 
-    return polygon_dist;
+    // Agreement with the polygon distribution of the immersed boundary mesh
+    p_statistics->mImmersedBoundaryPolygonDistribution = mpIbMesh->GetPolygonDistribution();
+    double cumulative_difference = 0.0;
+    for (unsigned num_sides = 0; num_sides < 13u; ++num_sides)
+    {
+        cumulative_difference += std::fabs(static_cast<double>(p_statistics->mVertexPolygonDistribution[num_sides]) -
+                                           static_cast<double>(p_statistics->mImmersedBoundaryPolygonDistribution[num_sides]));
+    }
+    p_statistics->mPolygonDistributionDifference =
+            num_interior_elems > 0u ? cumulative_difference / num_interior_elems : 0.0;
+
+    // Area and perimeter of the immersed boundary elements, with Welford's update giving mean and variance in one pass
+    unsigned num_elems = 0u;
+    double area_mean = 0.0;
+    double area_sum_sq_deviations = 0.0;
+    double perimeter_mean = 0.0;
+    double perimeter_sum_sq_deviations = 0.0;
+    for (auto elem_it = mpIbMesh->GetElementIteratorBegin(); elem_it != mpIbMesh->GetElementIteratorEnd(); ++elem_it)
+    {
+        const unsigned elem_idx = elem_it->GetIndex();
+        const double area = mpIbMesh->GetVolumeOfElement(elem_idx);
+        const double perimeter = mpIbMesh->GetSurfaceAreaOfElement(elem_idx);
+        ++num_elems;
+
+        const double area_deviation = area - area_mean;
+        area_mean += area_deviation / num_elems;
+        area_sum_sq_deviations += area_deviation * (area - area_mean);
+
+        const double perimeter_deviation = perimeter - perimeter_mean;
+        perimeter_mean += perimeter_deviation / num_elems;
+        perimeter_sum_sq_deviations += perimeter_deviation * (perimeter - perimeter_mean);
+    }
+
+    p_statistics->mAreaMean = area_mean;
+    p_statistics->mPerimeterMean = perimeter_mean;
+    p_statistics->mAreaCoefficientOfVariation = 0.0;
+    p_statistics->mPerimeterCoefficientOfVariation = 0.0;
+    if (num_elems > 1u)
+    {
+        p_statistics->mAreaCoefficientOfVariation = std::sqrt(area_sum_sq_deviations / (num_elems - 1u)) / area_mean;
+        p_statistics->mPerimeterCoefficientOfVariation =
+                std::sqrt(perimeter_sum_sq_deviations / (num_elems - 1u)) / perimeter_mean;
+    }
+
+    mpStatistics = std::move(p_statistics);
+    return *mpStatistics;
+}
+
+std::array<unsigned, 13> VoronoiImmersedBoundaryMeshGenerator::GetVertexMeshPolygonDistribution()
+{
+    return rGetStatistics().mVertexPolygonDistribution;
 }
 
 double VoronoiImmersedBoundaryMeshGenerator::GetAreaCoefficientOfVariation()
 {
-//    assert(mpMesh != nullptr);
-//
-//    // Number of elements in the mesh, and check there are at least two
-//    unsigned num_elems = mpMesh->GetNumElements();
-//    assert(num_elems > 1);
-//
-//    double var = 0.0;
-//
-//    // Loop over elements in the mesh to get the contributions to the variance
-//    for (unsigned elem_idx = 0 ; elem_idx < num_elems ; elem_idx++)
-//    {
-//        double deviation = mpMesh->GetVolumeOfElement(elem_idx) - mElementTargetArea;
-//        var += deviation * deviation;
-//    }
-//
-//    var /= static_cast<double>(num_elems - 1);
-//
-//    return sqrt(var) / mElementTargetArea;
-    return 0;
+    return rGetStatistics().mAreaCoefficientOfVariation;
 }
@@ -36,8 +36,11 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef VORONOIIMMERSEDBOUNDARYMESHGENERATOR_HPP_
 #define VORONOIIMMERSEDBOUNDARYMESHGENERATOR_HPP_
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "ImmersedBoundaryMesh.hpp"
@@ -45,6 +48,57 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/polygon/voronoi.hpp>
 
+/**
+ * The adjacency of the elements of a mesh in compressed sparse row form: the neighbours of element i are
+ * mNeighbours[mRowOffsets[i]] to mNeighbours[mRowOffsets[i+1] - 1], in increasing order.  Two elements are neighbours
+ * if they share a node.
+ */
+struct ElementAdjacency
+{
+    /** The offset of each element's neighbours in mNeighbours, with one more entry than there are elements */
+    std::vector<unsigned> mRowOffsets;
+
+    /** The indices of the neighbours of every element, grouped by element */
+    std::vector<unsigned> mNeighbours;
+
+    /**
+     * @param elemIdx the index of an element
+     * @return the number of neighbours of the element
+     */
+    unsigned GetNumNeighbours(unsigned elemIdx) const
+    {
+        return mRowOffsets[elemIdx + 1u] - mRowOffsets[elemIdx];
+    }
+};
+
+/** Summary statistics of the meshes made by a VoronoiImmersedBoundaryMeshGenerator */
+struct VoronoiMeshStatistics
+{
+    /** The number of {0, 1, 2,..., 12+}-sided non-boundary elements of the vertex mesh */
+    std::array<unsigned, 13> mVertexPolygonDistribution;
+
+    /** The number of {0, 1, 2,..., 12+}-sided elements of the immersed boundary mesh, from its own neighbour query */
+    std::array<unsigned, 13> mImmersedBoundaryPolygonDistribution;
+
+    /**
+     * The sum of the absolute differences between the two polygon distributions, divided by the number of
+     * non-boundary vertex elements: 0 when the immersed boundary mesh has exactly the polygons of the vertex mesh
+     */
+    double mPolygonDistributionDifference;
+
+    /** The mean area of the elements of the immersed boundary mesh */
+    double mAreaMean;
+
+    /** The sample standard deviation of the element areas divided by their mean, or 0 with under two elements */
+    double mAreaCoefficientOfVariation;
+
+    /** The mean perimeter of the elements of the immersed boundary mesh */
+    double mPerimeterMean;
+
+    /** The sample standard deviation of the element perimeters divided by their mean, or 0 with under two elements */
+    double mPerimeterCoefficientOfVariation;
+};
+
 /**
  * Mesh generator that creates a 2D Voronoi tessellation using a number of Lloyd's relaxation steps
  * (http://en.wikipedia.org/wiki/Lloyd%27s_algorithm).
@@ -84,16 +138,84 @@ protected:
     /** The target ratio between fluid-mesh spacing and node spacing */
     double mTargetNodeSpacingRatio;
 
+    /** The number of OpenMP threads used to generate elements; only has an effect if built with OpenMP */
+    unsigned mNumThreads = 1u;
+
+    /** Whether to number nodes and balancing fluid sources along a Morton space-filling curve */
+    bool mUseMortonOrdering = false;
+
+    /** The directory, relative to $CHASTE_TEST_OUTPUT, in which generated meshes are cached */
+    std::string mMeshCacheDirectory;
+
+    /** The full path of the cache file for this mesh, or empty if the cache is not used */
+    std::string mMeshCacheFileName;
+
+    /** The adjacency of the elements of mpVertexMesh, calculated on first use by rGetVertexMeshAdjacency() */
+    std::unique_ptr<ElementAdjacency> mpVertexMeshAdjacency;
+
+    /** The statistics of the meshes, calculated on first use by rGetStatistics() */
+    std::unique_ptr<VoronoiMeshStatistics> mpStatistics;
+
+    /** Identifies a mesh cache file */
+    static constexpr std::uint64_t MESH_CACHE_MAGIC = 0x4843414D48534D49ull;
+
+    /** The version of the mesh cache file layout; bump this whenever the layout or the generated meshes change */
+    static constexpr std::uint32_t MESH_CACHE_VERSION = 2u;
+
+    /**
+     * The header of a mesh cache file.  The header is followed by, in order: the vertex and then the immersed
+     * boundary node locations as (x, y) doubles; the vertex element node offsets (one more than the number of
+     * elements) and node indices; the same two arrays for immersed boundary elements; one byte per vertex node for
+     * whether it is a boundary node; one byte per immersed boundary element for whether it is a boundary element; and
+     * the random number generator state after generation.  Every array starts on a suitably aligned offset, so the
+     * file can be read in place once memory mapped.
+     */
+    struct MeshCacheHeader
+    {
+        /** Must equal MESH_CACHE_MAGIC */
+        std::uint64_t mMagic;
+
+        /** Must equal MESH_CACHE_VERSION */
+        std::uint32_t mVersion;
+
+        /** The number of nodes in the vertex mesh */
+        std::uint32_t mNumVertexNodes;
+
+        /** The number of elements in the vertex mesh */
+        std::uint32_t mNumVertexElements;
+
+        /** The total number of nodes over all elements in the vertex mesh */
+        std::uint32_t mNumVertexElementNodeIndices;
+
+        /** The number of nodes in the immersed boundary mesh */
+        std::uint32_t mNumIbNodes;
+
+        /** The number of elements in the immersed boundary mesh */
+        std::uint32_t mNumIbElements;
+
+        /** The total number of nodes over all elements in the immersed boundary mesh */
+        std::uint32_t mNumIbElementNodeIndices;
+
+        /** The length of the serialized random number generator state */
+        std::uint32_t mRngStateLength;
+    };
+
     /**
      * Helper method for the constructor.
      *
-     * Perform a deep copy of a mesh generated by a VoronoiVertexMeshGenerator, into mpVertexMesh, in order for the
-     * mesh to persist once the generator goes out of scope and deletes its mesh.
-     * The mesh is also repositioned to be central within [0,1]x[0,1].
+     * Take ownership of a mesh generated by a VoronoiVertexMeshGenerator into mpVertexMesh, translating its nodes in
+     * place to be central within [0,1]x[0,1], so no nodes or elements are allocated.
+     *
+     * @param pMesh the MutableVertexMesh generated by a VoronoiVertexMeshGenerator.
+     */
+    void RepositionVertexMesh(std::unique_ptr<MutableVertexMesh<2, 2>> pMesh);
+
+    /**
+     * Helper method for RepositionVertexMesh().
      *
-     * @param pMeshToCopy the MutableVertexMesh generated by a VoronoiVertexMeshGenerator.
+     * @return the translation that positions the vertex mesh centrally within [0,1]x[0,1]
      */
-    void DeepCopyAndRepositionVertexMesh(MutableVertexMesh<2, 2>* pMeshToCopy);
+    c_vector<double, 2> GetRepositioningVector() const;
 
     /**
      * Helper method for the constructor.
@@ -102,6 +224,83 @@ protected:
      */
     void GenerateImmersedBoundaryMesh();
 
+    /**
+     * Helper method for GenerateImmersedBoundaryMesh and LoadFromMeshCache.
+     *
+     * Replace the default balancing fluid sources of mpIbMesh with a source at each vertex of mpVertexMesh, in order
+     * of vertex index or, if mUseMortonOrdering, of Morton code.
+     */
+    void ReplaceBalancingFluidSources();
+
+    /**
+     * @param rLocation a location
+     * @return the periodic image of rLocation within the unit square
+     */
+    static c_vector<double, 2> RepositionToUnitSquare(const c_vector<double, 2>& rLocation);
+
+    /** @return the state of the random number generator, serialized to a string */
+    static std::string GetRandomNumberGeneratorState();
+
+    /** @param rState a random number generator state from GetRandomNumberGeneratorState(), to restore */
+    static void SetRandomNumberGeneratorState(const std::string& rState);
+
+    /**
+     * Helper method for the constructor.
+     *
+     * @return a hash of the constructor arguments that determine the mesh and of the current random number generator
+     *     state, as 16 hexadecimal digits
+     */
+    std::string GetMeshCacheKey() const;
+
+    /**
+     * Helper method for the constructor.  Write the generated meshes, and the random number generator state after
+     * generating them, to a mesh cache file.
+     *
+     * @param rFileName the full path of the cache file
+     */
+    void SaveToMeshCache(const std::string& rFileName) const;
+
+    /**
+     * Helper method for the constructor.  Read the meshes, memory mapping the cache file, and restore the random
+     * number generator to its state after they were first generated.  Throws if the file exists but its header,
+     * size, element offsets or node indices are inconsistent.
+     *
+     * @param rFileName the full path of the cache file
+     * @return whether the cache file existed and could be read; if not, nothing is changed
+     */
+    bool LoadFromMeshCache(const std::string& rFileName);
+
+    /**
+     * Helper method for GenerateImmersedBoundaryMesh.
+     *
+     * Shrink a polygon by mAbsoluteGapBetweenElements, walking each vertex in along its angle bisector in small
+     * increments, and merging any short edge that becomes inverted into a single vertex.
+     *
+     * @param rVertexLocations the locations of the polygon vertices, shrunk in place
+     * @param rScratch workspace holding a snapshot of the vertex locations, reused between calls to avoid allocation
+     */
+    void ShrinkPolygon(std::vector<c_vector<double, 2>>& rVertexLocations,
+                       std::vector<c_vector<double, 2>>& rScratch) const;
+
+    /**
+     * Helper method for ShrinkPolygon.
+     *
+     * Determine whether the closed segments [a, b] and [c, d] intersect, using orientation predicates, and if so
+     * where.  Collinear overlapping segments do not have a unique intersection and are reported as not intersecting.
+     *
+     * @param rA the start of the first segment
+     * @param rB the end of the first segment
+     * @param rC the start of the second segment
+     * @param rD the end of the second segment
+     * @param rIntersection set to the point of intersection, if there is one
+     * @return whether the segments have a unique point of intersection
+     */
+    static bool CalculateSegmentIntersection(const c_vector<double, 2>& rA,
+                                             const c_vector<double, 2>& rB,
+                                             const c_vector<double, 2>& rC,
+                                             const c_vector<double, 2>& rD,
+                                             c_vector<double, 2>& rIntersection);
+
 public:
 
     /**
@@ -114,6 +313,14 @@ public:
      * @param maxWidthOrHeightOfMesh The maximum width or height the mesh may be (default 0.9)
      * @param absoluteGapBetweenElements The gap between elements (default 0.01)
      * @param targetNodeSpacingRatio The target ratio of node spacing to fluid mesh spacing (default 0.5)
+     * @param numThreads The number of OpenMP threads used to generate elements (default 1).  The mesh generated does
+     *     not depend on the number of threads.
+     * @param useMeshCache Whether to read the mesh from, or else write it to, a cache file under $CHASTE_TEST_OUTPUT
+     *     keyed by the arguments above and the random number generator state (default false).
+     * @param useMortonOrdering Whether to number the nodes and balancing fluid sources of the immersed boundary mesh
+     *     by the Morton codes of their locations, so that spatially adjacent nodes are adjacent in memory (default
+     *     false).  Elements are numbered as in the underlying vertex mesh either way, and the random number generator
+     *     is used exactly as without reordering.
      */
     VoronoiImmersedBoundaryMeshGenerator(unsigned numElementsX,
                                          unsigned numElementsY,
@@ -121,7 +328,10 @@ public:
                                          unsigned numFluidGridPoints,
                                          double maxWidthOrHeightOfMesh=0.9,
                                          double absoluteGapBetweenElements=0.01,
-                                         double targetNodeSpacingRatio=0.5);
+                                         double targetNodeSpacingRatio=0.5,
+                                         unsigned numThreads=1u,
+                                         bool useMeshCache=false,
+                                         bool useMortonOrdering=false);
 
     /**
      * Null constructor for derived classes to call.
@@ -147,11 +357,32 @@ public:
      */
     virtual ImmersedBoundaryMesh<2,2>* GetMesh();
 
+    /** @return the full path of the mesh cache file, or an empty string if the mesh cache is not used */
+    const std::string& rGetMeshCacheFileName() const;
+
+    /**
+     * Return the adjacency of the elements of the underlying vertex mesh.  This is calculated in one pass over the
+     * elements on the first call and kept, so it describes the vertex mesh as it was then.
+     *
+     * @return the adjacency of the elements of mpVertexMesh
+     */
+    const ElementAdjacency& rGetVertexMeshAdjacency();
+
+    /**
+     * Return the polygon distributions, element area and perimeter statistics, and agreement between the polygons
+     * of the two meshes.  These are calculated on the first call and kept, so they describe the meshes as they were
+     * then: call this before the immersed boundary mesh is changed, for instance by a simulation.
+     *
+     * @return the statistics of the meshes
+     */
+    const VoronoiMeshStatistics& rGetStatistics();
+
     /**
      * Calculate the polygon distribution for the underlying vertex mesh: number of {0, 1, 2, 3, 4, 5,..., 12+}-gons.
      * Note that the vector will always begin {0, 0, 0, ...} as there can be no 0, 1, or 2-gons, but this choice means
      * that accessing the nth element of the vector gives you the number of n-gons which seems to be most natural.
-     * All 12-sided and higher order polygons are accumulated in the array[12] position.
+     * All 12-sided and higher order polygons are accumulated in the array[12] position.  Boundary elements are not
+     * counted.  This is memoised along with the rest of rGetStatistics().
      *
      * @return an array of length 13 representing the polygon distribution.
      */
@@ -159,7 +390,7 @@ public:
 
     /**
      * Computes the coefficient of variation of the areas of elements in the mesh, defined to be the sample standard
-     * deviation in area divided by the mean area.
+     * deviation in area divided by the mean area.  This is memoised along with the rest of rGetStatistics().
      *
      * @return The coefficient of variation of the area of elements in the mesh
      */
@@ -0,0 +1,333 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTANGULARVARIATIONMEMBRANEFORCE_HPP_
+#define TESTANGULARVARIATIONMEMBRANEFORCE_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// From Chaste
+#include "CellsGenerator.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryElement.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+#include "SimulationTime.hpp"
+
+// From this user project
+#include "AngularVariationMembraneForce.hpp"
+#include "ImmersedBoundaryGeometryCache.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * Exposes the general case of AngularVariationMembraneForce::CalculateForcesOnElement(), which in 2D is only used for
+ * laminas and so can be run on a lamina with the index and nodes of each element.
+ */
+class TestableAngularVariationMembraneForce : public AngularVariationMembraneForce<2>
+{
+public:
+
+    /**
+     * Add the forces of the general case to every node of a mesh.  The force must already have been applied to the
+     * population of the mesh, which sets it up.
+     *
+     * @param rMesh the mesh
+     */
+    void AddGeneralCaseForceContribution(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        for (unsigned elem_idx = 0; elem_idx < rMesh.GetNumElements(); ++elem_idx)
+        {
+            ImmersedBoundaryElement<2, 2>* const p_elem = rMesh.GetElement(elem_idx);
+
+            std::vector<Node<2>*> nodes;
+            for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+            {
+                nodes.push_back(p_elem->GetNode(local_idx));
+            }
+
+            ImmersedBoundaryElement<1, 2> lamina(p_elem->GetIndex(), nodes);
+            CalculateForcesOnElement(lamina);
+        }
+    }
+};
+
+class TestAngularVariationMembraneForce : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * Helper method to clear the applied force on every node of a mesh.
+     *
+     * @param rMesh the mesh
+     */
+    void ClearForces(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+        {
+            rMesh.GetNode(node_idx)->ClearAppliedForce();
+        }
+    }
+
+    /**
+     * Helper method to collect the applied force on every node of a mesh.
+     *
+     * @param rMesh the mesh
+     * @return the applied force on each node, two entries per node
+     */
+    std::vector<double> CollectForces(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<double> forces;
+        for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+        {
+            const c_vector<double, 2>& r_force = rMesh.GetNode(node_idx)->rGetAppliedForce();
+            forces.insert(forces.end(), r_force.begin(), r_force.end());
+        }
+        return forces;
+    }
+
+    /**
+     * Helper method to calculate the membrane forces node by node, as AngularVariationMembraneForce did before its
+     * springs were evaluated in contiguous scratch buffers.
+     *
+     * @param rCellPopulation the population
+     * @param springConstant the spring constant of the force
+     * @param restLengthMultiplier the rest length multiplier of the force
+     * @return the force on each node, two entries per node
+     */
+    std::vector<double> CalculateBaselineForces(ImmersedBoundaryCellPopulation<2>& rCellPopulation,
+                                                double springConstant,
+                                                double restLengthMultiplier)
+    {
+        ImmersedBoundaryMesh<2, 2>& r_mesh = rCellPopulation.rGetMesh();
+        const double intrinsic_spacing = rCellPopulation.GetIntrinsicSpacing();
+
+        std::vector<double> forces(2u * r_mesh.GetNumNodes(), 0.0);
+        for (unsigned elem_idx = 0; elem_idx < r_mesh.GetNumElements(); ++elem_idx)
+        {
+            ImmersedBoundaryElement<2, 2>* const p_elem = r_mesh.GetElement(elem_idx);
+            const unsigned num_nodes = p_elem->GetNumNodes();
+
+            const double node_spacing = r_mesh.GetAverageNodeSpacingOfElement(p_elem->GetIndex(), false);
+            const double spring_constant =
+                    springConstant * intrinsic_spacing * intrinsic_spacing / (node_spacing * node_spacing);
+            const double rest_length = restLengthMultiplier * node_spacing;
+
+            for (unsigned node_idx = 0; node_idx < num_nodes; ++node_idx)
+            {
+                const unsigned next_idx = (node_idx + 1u) % num_nodes;
+
+                c_vector<double, 2> elastic_force =
+                        r_mesh.GetVectorFromAtoB(p_elem->GetNodeLocation(node_idx), p_elem->GetNodeLocation(next_idx));
+                const double normed_dist = norm_2(elastic_force);
+                const double cos_theta = std::fabs(elastic_force[1]) / normed_dist;
+                elastic_force *= spring_constant * (1.0 + cos_theta) * (normed_dist - rest_length) / normed_dist;
+
+                // The spring pulls its two nodes together, or pushes them apart, equally
+                for (unsigned dim = 0; dim < 2u; ++dim)
+                {
+                    forces[2u * p_elem->GetNodeGlobalIndex(node_idx) + dim] += elastic_force[dim];
+                    forces[2u * p_elem->GetNodeGlobalIndex(next_idx) + dim] -= elastic_force[dim];
+                }
+            }
+        }
+        return forces;
+    }
+
+    /**
+     * Helper method to translate every node of a mesh, wrapping on the periodic unit square.
+     *
+     * @param rMesh the mesh
+     * @param shiftX the distance to move the nodes along the x axis, in [0, 1)
+     * @param shiftY the distance to move the nodes along the y axis, in [0, 1)
+     */
+    void ShiftNodes(ImmersedBoundaryMesh<2, 2>& rMesh, double shiftX, double shiftY)
+    {
+        for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+        {
+            c_vector<double, 2>& r_location = rMesh.GetNode(node_idx)->rGetModifiableLocation();
+            r_location[0] = std::fmod(r_location[0] + shiftX, 1.0);
+            r_location[1] = std::fmod(r_location[1] + shiftY, 1.0);
+        }
+        ImmersedBoundaryGeometryCache<2>::GetForMesh(rMesh)->Invalidate();
+    }
+
+    /**
+     * Helper method to check that two sets of node forces agree up to rounding.
+     *
+     * @param rExpected the expected forces
+     * @param rActual the actual forces
+     * @param relTolerance the tolerance, relative to the largest expected force component
+     */
+    void CheckForcesAgree(const std::vector<double>& rExpected,
+                          const std::vector<double>& rActual,
+                          double relTolerance)
+    {
+        double max_force = 0.0;
+        for (const double force : rExpected)
+        {
+            max_force = std::max(max_force, std::fabs(force));
+        }
+        TS_ASSERT_LESS_THAN(0.0, max_force);
+
+        TS_ASSERT_EQUALS(rExpected.size(), rActual.size());
+        for (unsigned i = 0; i < std::min(rExpected.size(), rActual.size()); ++i)
+        {
+            TS_ASSERT_DELTA(rActual[i], rExpected[i], relTolerance * max_force);
+        }
+    }
+
+public:
+
+    void TestGeneralCaseMatchesBaseline()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs;
+
+        TestableAngularVariationMembraneForce force;
+        force.SetSpringConstant(1e5);
+        force.SetRestLengthMultiplier(0.3);
+        force.AddImmersedBoundaryForceContribution(node_pairs, cell_population);
+
+        // Elements of varying size reuse and grow the scratch buffers
+        ClearForces(*p_mesh);
+        force.AddGeneralCaseForceContribution(*p_mesh);
+        CheckForcesAgree(CalculateBaselineForces(cell_population, 1e5, 0.3), CollectForces(*p_mesh), 1e-10);
+    }
+    void TestSpecialisationMatchesGeneralCaseAcrossPeriodicBoundary()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        // Move every cell by half its width, so that the cells along two edges straddle the periodic boundary
+        ShiftNodes(*p_mesh, 0.125, 0.125);
+
+        unsigned num_wrapped_springs = 0u;
+        for (unsigned elem_idx = 0; elem_idx < p_mesh->GetNumElements(); ++elem_idx)
+        {
+            ImmersedBoundaryElement<2, 2>* const p_elem = p_mesh->GetElement(elem_idx);
+            for (unsigned node_idx = 0; node_idx < p_elem->GetNumNodes(); ++node_idx)
+            {
+                const c_vector<double, 2> raw_difference =
+                        p_elem->GetNodeLocation((node_idx + 1u) % p_elem->GetNumNodes()) -
+                        p_elem->GetNodeLocation(node_idx);
+                if (std::fabs(raw_difference[0]) > 0.5 || std::fabs(raw_difference[1]) > 0.5)
+                {
+                    ++num_wrapped_springs;
+                }
+            }
+        }
+        TS_ASSERT_LESS_THAN(0u, num_wrapped_springs);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs;
+
+        TestableAngularVariationMembraneForce force;
+        ClearForces(*p_mesh);
+        force.AddImmersedBoundaryForceContribution(node_pairs, cell_population);
+        const std::vector<double> specialised_forces = CollectForces(*p_mesh);
+
+        ClearForces(*p_mesh);
+        force.AddGeneralCaseForceContribution(*p_mesh);
+
+        // The specialisation evaluates the same expressions as the general case, in the same order
+        CheckForcesAgree(CollectForces(*p_mesh), specialised_forces, 1e-12);
+        CheckForcesAgree(CalculateBaselineForces(cell_population, force.GetSpringConstant(),
+                                                 force.GetRestLengthMultiplier()), specialised_forces, 1e-10);
+    }
+    void TestDeviceOffloadMatchesHost()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+        ShiftNodes(*p_mesh, 0.125, 0.125);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs;
+
+        AngularVariationMembraneForce<2> host_force;
+        ClearForces(*p_mesh);
+        host_force.AddImmersedBoundaryForceContribution(node_pairs, cell_population);
+        const std::vector<double> host_forces = CollectForces(*p_mesh);
+
+        AngularVariationMembraneForce<2> device_force;
+        TS_ASSERT_EQUALS(device_force.GetUseDeviceOffload(), false);
+        device_force.SetUseDeviceOffload(true);
+        TS_ASSERT_EQUALS(device_force.GetUseDeviceOffload(), true);
+
+        // The second pass reuses the layout of the nodes on the device
+        for (unsigned pass = 0; pass < 2u; ++pass)
+        {
+            ClearForces(*p_mesh);
+            device_force.AddImmersedBoundaryForceContribution(node_pairs, cell_population);
+
+            // Only the device's sqrt() may differ from the host's
+            CheckForcesAgree(host_forces, CollectForces(*p_mesh), 1e-10);
+        }
+
+        AngularVariationMembraneForce<3> force_3d;
+        TS_ASSERT_THROWS_THIS(force_3d.SetUseDeviceOffload(true), "Device offload is only available in 2D.");
+    }
+};
+
+#endif /*TESTANGULARVARIATIONMEMBRANEFORCE_HPP_*/
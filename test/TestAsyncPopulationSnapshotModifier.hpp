@@ -0,0 +1,120 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_
+#define TESTASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// From Chaste
+#include "CellsGenerator.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "OutputFileHandler.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+// From this user project
+#include "AsyncPopulationSnapshotModifier.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestAsyncPopulationSnapshotModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * @param rDirectory a directory, relative to $CHASTE_TEST_OUTPUT
+     * @return the size in bytes of populationsnapshots.bin in the directory
+     */
+    std::streamoff GetSnapshotFileSize(const std::string& rDirectory)
+    {
+        OutputFileHandler handler(rDirectory, false);
+        std::ifstream file(handler.GetOutputDirectoryFullPath() + "populationsnapshots.bin",
+                           std::ios::binary | std::ios::ate);
+        TS_ASSERT(file.is_open());
+        return file.tellg();
+    }
+
+public:
+
+    void TestFileContinuesAcrossStages()
+    {
+        HoneycombVertexMeshGenerator generator(2, 2);
+        MutableVertexMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        // The header, with no cell data items, then one snapshot of the initial state
+        const std::streamoff header_size = 8 + 2 * sizeof(std::uint32_t);
+        const std::streamoff snapshot_size = sizeof(double) + sizeof(std::uint32_t) +
+                                             p_mesh->GetNumNodes() * 2 * sizeof(double) + sizeof(std::uint32_t) +
+                                             cells.size() * (2 * sizeof(std::uint32_t) + 1 + sizeof(double));
+
+        AsyncPopulationSnapshotModifier<2> modifier;
+        modifier.SetSamplingInterval(10u);
+
+        // A second stage of the same simulation continues the file, without repeating the snapshot at the boundary
+        modifier.SetupSolve(cell_population, "TestAsyncPopulationSnapshotModifier/Staged/results_from_time_0");
+        modifier.UpdateAtEndOfSolve(cell_population);
+        modifier.SetupSolve(cell_population, "TestAsyncPopulationSnapshotModifier/Staged/results_from_time_10");
+        modifier.UpdateAtEndOfSolve(cell_population);
+
+        TS_ASSERT_EQUALS(GetSnapshotFileSize("TestAsyncPopulationSnapshotModifier/Staged"),
+                         header_size + snapshot_size);
+
+        // A different simulation output directory starts a new file
+        modifier.SetupSolve(cell_population, "TestAsyncPopulationSnapshotModifier/Restarted/results_from_time_10");
+        modifier.UpdateAtEndOfSolve(cell_population);
+
+        TS_ASSERT_EQUALS(GetSnapshotFileSize("TestAsyncPopulationSnapshotModifier/Restarted"),
+                         header_size + snapshot_size);
+        TS_ASSERT_EQUALS(GetSnapshotFileSize("TestAsyncPopulationSnapshotModifier/Staged"),
+                         header_size + snapshot_size);
+    }
+};
+
+#endif /*TESTASYNCPOPULATIONSNAPSHOTMODIFIER_HPP_*/
@@ -0,0 +1,408 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TESTBENCHMARKS_HPP_
+#define TESTBENCHMARKS_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+// From Chaste
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellsGenerator.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+#include "OutputFileHandler.hpp"
+#include "SimulationTime.hpp"
+#include "UniformGridRandomFieldGenerator.hpp"
+
+// From this user project
+#include "AngularVariationMembraneForce.hpp"
+#include "ImmersedBoundaryMorseDifferentialAdhesionForce.hpp"
+#include "ImmersedBoundaryTargetAreaModifier.hpp"
+#include "OffLatticeRandomFieldForce.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Simulation does not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * Microbenchmarks of the force classes, modifiers and mesh generator of this project, run as part of the Profile
+ * test pack only.  Each benchmark repeats its kernel until a minimum time has elapsed, and reports the mean time per
+ * pair, per node or per mesh.  All results are written to VertexIbComp/Benchmarks/benchmark_results.json, rewritten
+ * after each test so that it always holds every result so far, for tracking over time.
+ */
+class TestBenchmarks : public AbstractCellBasedTestSuite
+{
+private:
+
+    /** The minimum time, in seconds, over which each kernel is repeated */
+    static constexpr double m_min_time = 0.5;
+
+    /** The result of one benchmark */
+    struct BenchmarkResult
+    {
+        /** The name of the benchmark */
+        std::string mName;
+
+        /** The parameters of the benchmark, as a short description */
+        std::string mParameters;
+
+        /** The number of times the kernel was run */
+        unsigned mNumIterations;
+
+        /** The mean wall time of one run of the kernel, in seconds */
+        double mSecondsPerIteration;
+
+        /** The number of units (pairs, nodes or meshes) processed by one run of the kernel */
+        double mUnitsPerIteration;
+
+        /** The unit processed, such as "pair" */
+        std::string mUnit;
+    };
+
+    /** Every result so far */
+    std::vector<BenchmarkResult> mResults;
+
+    /**
+     * Run a kernel once untimed, then repeatedly until m_min_time has elapsed, and record the result.
+     *
+     * @param rName the name of the benchmark
+     * @param rParameters the parameters of the benchmark
+     * @param unitsPerIteration the number of units processed by one run of the kernel
+     * @param rUnit the unit processed
+     * @param kernel the kernel to run
+     */
+    template<typename KERNEL>
+    void RunBenchmark(const std::string& rName, const std::string& rParameters, double unitsPerIteration,
+                      const std::string& rUnit, KERNEL kernel)
+    {
+        kernel();
+
+        unsigned num_iterations = 0u;
+        const auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed(0.0);
+        while (elapsed.count() < m_min_time || num_iterations < 3u)
+        {
+            kernel();
+            ++num_iterations;
+            elapsed = std::chrono::steady_clock::now() - start;
+        }
+
+        mResults.push_back({rName, rParameters, num_iterations, elapsed.count() / num_iterations, unitsPerIteration, rUnit});
+
+        const BenchmarkResult& r_result = mResults.back();
+        std::cout << std::setw(50) << std::left << rName + " (" + rParameters + ")" << std::right << std::setw(14)
+                  << 1e9 * r_result.mSecondsPerIteration / unitsPerIteration << " ns/" << rUnit << "\n";
+    }
+
+    /** Write every result so far to benchmark_results.json. */
+    void WriteResults()
+    {
+        OutputFileHandler output_file_handler("VertexIbComp/Benchmarks", false);
+        out_stream p_file = output_file_handler.OpenOutputFile("benchmark_results.json");
+
+        *p_file << std::setprecision(9) << "{\n  \"benchmarks\": [";
+        for (unsigned result_idx = 0; result_idx < mResults.size(); ++result_idx)
+        {
+            const BenchmarkResult& r_result = mResults[result_idx];
+            *p_file << (result_idx == 0u ? "\n" : ",\n")
+                    << "    {\"name\": \"" << r_result.mName << "\", "
+                    << "\"parameters\": \"" << r_result.mParameters << "\", "
+                    << "\"iterations\": " << r_result.mNumIterations << ", "
+                    << "\"seconds_per_iteration\": " << r_result.mSecondsPerIteration << ", "
+                    << "\"unit\": \"" << r_result.mUnit << "\", "
+                    << "\"units_per_iteration\": " << r_result.mUnitsPerIteration << ", "
+                    << "\"ns_per_unit\": " << 1e9 * r_result.mSecondsPerIteration / r_result.mUnitsPerIteration << ", "
+                    << "\"units_per_second\": " << r_result.mUnitsPerIteration / r_result.mSecondsPerIteration << "}";
+        }
+        *p_file << (mResults.empty() ? "]\n" : "\n  ]\n") << "}\n";
+        p_file->close();
+    }
+
+    /**
+     * Helper method to set up the simulation time so that kernels can be run for many time steps.
+     */
+    void SetUpSimulationTime()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1e6, 100000000u);
+    }
+
+    /**
+     * Helper method to create cells for every element of a mesh, labelling every other cell.
+     *
+     * @param rMesh the mesh
+     * @return the cells
+     */
+    std::vector<CellPtr> CreateCells(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, rMesh.GetNumElements());
+
+        boost::shared_ptr<AbstractCellProperty> p_label(CellPropertyRegistry::Instance()->Get<CellLabel>());
+        for (unsigned cell_idx = 0; cell_idx < cells.size(); cell_idx += 2u)
+        {
+            cells[cell_idx]->AddCellProperty(p_label);
+        }
+
+        return cells;
+    }
+
+    /**
+     * Helper method to list every pair of nodes closer than a given distance, by brute force.
+     *
+     * @param rMesh the mesh
+     * @param maxDist the distance
+     * @return the pairs
+     */
+    std::vector<std::pair<Node<2>*, Node<2>*>> CalculateNodePairs(ImmersedBoundaryMesh<2, 2>& rMesh, double maxDist)
+    {
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs;
+        for (unsigned idx_a = 0; idx_a < rMesh.GetNumNodes(); ++idx_a)
+        {
+            for (unsigned idx_b = idx_a + 1u; idx_b < rMesh.GetNumNodes(); ++idx_b)
+            {
+                Node<2>* const p_node_a = rMesh.GetNode(idx_a);
+                Node<2>* const p_node_b = rMesh.GetNode(idx_b);
+                if (norm_2(rMesh.GetVectorFromAtoB(p_node_a->rGetLocation(), p_node_b->rGetLocation())) < maxDist)
+                {
+                    node_pairs.emplace_back(p_node_a, p_node_b);
+                }
+            }
+        }
+        return node_pairs;
+    }
+
+public:
+
+    void TestMorseDifferentialAdhesionForce()
+    {
+        SetUpSimulationTime();
+
+        const double cell_gap = 0.03;
+        const double interaction_dist = 2.0 * cell_gap;
+        const double verlet_skin = 0.25 * cell_gap;
+
+        for (const unsigned num_cells_across : {6u, 12u})
+        {
+            VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 5u, 128u, 1.0, cell_gap, 0.5);
+            ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+            std::vector<CellPtr> cells = CreateCells(*p_mesh);
+            ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+            cell_population.SetInteractionDistance(interaction_dist);
+            p_mesh->SetNeighbourDist(interaction_dist + verlet_skin);
+
+            // Every variant is given the pairs a Verlet list needs, so all see the same list
+            std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs = CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+            const std::string parameters = std::to_string(num_cells_across * num_cells_across) + " cells, " +
+                                           std::to_string(node_pairs.size()) + " pairs";
+
+            for (const std::string variant : {"direct", "tabulated", "verlet"})
+            {
+                ImmersedBoundaryMorseDifferentialAdhesionForce<2> force;
+                force.SetUseTabulatedPotential(variant == "tabulated");
+                force.SetVerletSkin(variant == "verlet" ? verlet_skin : 0.0);
+
+                RunBenchmark("MorseDifferentialAdhesionForce/" + variant, parameters, node_pairs.size(), "pair", [&]()
+                {
+                    force.AddImmersedBoundaryForceContribution(node_pairs, cell_population);
+                    SimulationTime::Instance()->IncrementTimeOneStep();
+                });
+            }
+        }
+
+        WriteResults();
+    }
+
+    void TestAngularVariationMembraneForce()
+    {
+        SetUpSimulationTime();
+
+        // Scale the fluid grid with the number of elements, so that each element has a similar number of nodes
+        for (const unsigned num_cells_across : {10u, 32u, 100u})
+        {
+            VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 1u, 8u * num_cells_across,
+                                                           1.0, 0.1 / num_cells_across, 0.5);
+            ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+            std::vector<CellPtr> cells = CreateCells(*p_mesh);
+            ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+            std::vector<std::pair<Node<2>*, Node<2>*>> no_node_pairs;
+            AngularVariationMembraneForce<2> force;
+
+            const std::string parameters = std::to_string(p_mesh->GetNumElements()) + " elements, " +
+                                           std::to_string(p_mesh->GetNumNodes()) + " nodes";
+
+            RunBenchmark("AngularVariationMembraneForce", parameters, p_mesh->GetNumNodes(), "node", [&]()
+            {
+                force.AddImmersedBoundaryForceContribution(no_node_pairs, cell_population);
+                SimulationTime::Instance()->IncrementTimeOneStep();
+            });
+        }
+
+        WriteResults();
+    }
+
+    void TestOffLatticeRandomFieldForce()
+    {
+        SetUpSimulationTime();
+
+        VoronoiImmersedBoundaryMeshGenerator generator(12u, 12u, 5u, 128u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        UniformGridRandomFieldGenerator<2> field_generator({{0.0, 0.0}}, {{1.0, 1.0}}, {{64u, 64u}}, {{true, true}}, 0.8, 0.1);
+        const std::string cached_field_name = field_generator.SaveToCache();
+
+        const std::string parameters = std::to_string(p_mesh->GetNumNodes()) + " nodes";
+
+        for (const std::string variant : {"uncorrelated", "counter_based", "correlated"})
+        {
+            OffLatticeRandomFieldForce<2> force;
+            force.SetDiffusionStrength(1.0);
+            force.SetUseCounterBasedNoise(variant == "counter_based");
+            if (variant == "correlated")
+            {
+                force.SetUpRandomFieldGenerator(cached_field_name);
+            }
+
+            RunBenchmark("OffLatticeRandomFieldForce/" + variant, parameters, p_mesh->GetNumNodes(), "node", [&]()
+            {
+                force.AddForceContribution(cell_population);
+                SimulationTime::Instance()->IncrementTimeOneStep();
+            });
+        }
+
+        WriteResults();
+    }
+
+    void TestUpdateTargetAreas()
+    {
+        SetUpSimulationTime();
+
+        for (const unsigned num_cells_across : {6u, 12u})
+        {
+            VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 5u, 128u, 1.0, 0.03, 0.5);
+            ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+            std::vector<CellPtr> cells = CreateCells(*p_mesh);
+            ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+            double total_area = 0.0;
+            for (const auto& p_cell : cell_population.rGetCells())
+            {
+                total_area += cell_population.GetVolumeOfCell(p_cell);
+            }
+            const double mean_area = total_area / cell_population.GetNumRealCells();
+
+            ImmersedBoundaryTargetAreaModifier<2> modifier;
+            modifier.SetMinTargetArea(0.5 * mean_area);
+            modifier.SetMaxTargetArea(1.5 * mean_area);
+            modifier.SetupSolve(cell_population, "VertexIbComp/Benchmarks");
+
+            const std::string parameters = std::to_string(p_mesh->GetNumElements()) + " elements, " +
+                                           std::to_string(p_mesh->GetNumNodes()) + " nodes";
+
+            RunBenchmark("UpdateTargetAreas", parameters, p_mesh->GetNumNodes(), "node", [&]()
+            {
+                modifier.UpdateAtEndOfTimeStep(cell_population);
+                SimulationTime::Instance()->IncrementTimeOneStep();
+            });
+        }
+
+        WriteResults();
+    }
+
+    void TestVoronoiImmersedBoundaryMeshGenerator()
+    {
+        for (const unsigned num_cells_across : {5u, 10u, 20u})
+        {
+            const std::string parameters = std::to_string(num_cells_across * num_cells_across) + " elements";
+
+            RunBenchmark("VoronoiImmersedBoundaryMeshGenerator", parameters, 1.0, "mesh", [&]()
+            {
+                VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 5u, 128u, 1.0, 0.03, 0.5);
+                TS_ASSERT_EQUALS(generator.GetMesh()->GetNumElements(), num_cells_across * num_cells_across);
+            });
+        }
+
+        WriteResults();
+    }
+
+    void TestVoronoiMeshStatistics()
+    {
+        for (const unsigned num_cells_across : {5u, 10u, 20u})
+        {
+            const std::string parameters = std::to_string(num_cells_across * num_cells_across) + " elements";
+
+            // The statistics are memoised, so each run generates a mesh; compare with the generator benchmark above
+            RunBenchmark("VoronoiImmersedBoundaryMeshGenerator+Statistics", parameters, 1.0, "mesh", [&]()
+            {
+                VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 5u, 128u, 1.0, 0.03, 0.5);
+                TS_ASSERT_LESS_THAN_EQUALS(0.0, generator.rGetStatistics().mPolygonDistributionDifference);
+            });
+
+            // The per-call recomputation of the immersed boundary distribution that the bundle replaces
+            VoronoiImmersedBoundaryMeshGenerator generator(num_cells_across, num_cells_across, 5u, 128u, 1.0, 0.03, 0.5);
+            ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+            p_mesh->SetNeighbourDist(0.1);
+            RunBenchmark("ImmersedBoundaryMesh::GetPolygonDistribution", parameters, 1.0, "mesh", [&]()
+            {
+                const std::array<unsigned, 13> distribution = p_mesh->GetPolygonDistribution();
+                TS_ASSERT_LESS_THAN_EQUALS(std::accumulate(distribution.begin(), distribution.end(), 0u),
+                                           p_mesh->GetNumElements());
+            });
+        }
+
+        WriteResults();
+    }
+};
+
+#endif /*TESTBENCHMARKS_HPP_*/
@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTCELLSORTINGOUTPUTLAYOUT_HPP_
+#define TESTCELLSORTINGOUTPUTLAYOUT_HPP_
+
+// Needed for the test environment
+#include <cxxtest/TestSuite.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+// From Chaste
+#include "OutputFileHandler.hpp"
+
+// From this user project
+#include "CellSortingSimulation.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * CellSortingSimulation::Run() sets up and destroys its own singletons, so, as for the noise lengthscale sweeps, this
+ * suite does not derive from AbstractCellBasedTestSuite.
+ */
+class TestCellSortingOutputLayout : public CxxTest::TestSuite
+{
+private:
+
+    /**
+     * @param rDirectory a directory, relative to $CHASTE_TEST_OUTPUT
+     * @return the paths of every file in the directory and its subdirectories, relative to the directory
+     */
+    std::set<std::string> ListFiles(const std::string& rDirectory)
+    {
+        OutputFileHandler handler(rDirectory, false);
+        const boost::filesystem::path root(handler.GetOutputDirectoryFullPath());
+
+        std::set<std::string> files;
+        for (boost::filesystem::recursive_directory_iterator it(root), end; it != end; ++it)
+        {
+            if (boost::filesystem::is_regular_file(it->path()))
+            {
+                files.insert(it->path().string().substr(root.string().size()));
+            }
+        }
+        return files;
+    }
+
+    /**
+     * @param rDirectory a directory, relative to $CHASTE_TEST_OUTPUT
+     * @param rFile a file in the directory
+     * @return the contents of the file
+     */
+    std::string ReadFile(const std::string& rDirectory, const std::string& rFile)
+    {
+        OutputFileHandler handler(rDirectory, false);
+        std::ifstream file(handler.GetOutputDirectoryFullPath() + rFile);
+        TS_ASSERT(file.is_open());
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+public:
+
+    void TestVertexTextOutputIsOptional()
+    {
+        CellSortingParameters parameters;
+        parameters.mModel = CellSortingModel::VERTEX;
+        parameters.mLengthscale = 0.0;
+        parameters.mDiffusionStrength = 0.1;
+        parameters.mNumCellsAcross = 4u;
+        parameters.mTimeToSteadyState = 0.5;
+        parameters.mTimeForSimulation = 2.5;
+        parameters.mSeed = 1u;
+
+        parameters.mOutputDirectory = "TestCellSortingOutputLayout/FullText";
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(parameters));
+
+        parameters.mOutputDirectory = "TestCellSortingOutputLayout/NoText";
+        parameters.mWriteVertexTextOutput = false;
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(parameters));
+
+        // Only the cell ids, mutation states and adjacency matrix are left out, after labelling
+        const std::set<std::string> full_files = ListFiles("TestCellSortingOutputLayout/FullText");
+        const std::set<std::string> no_text_files = ListFiles("TestCellSortingOutputLayout/NoText");
+        TS_ASSERT(std::includes(full_files.begin(), full_files.end(), no_text_files.begin(), no_text_files.end()));
+        TS_ASSERT_EQUALS(full_files.size(), no_text_files.size() + 3u);
+
+        TS_ASSERT_EQUALS(ReadFile("TestCellSortingOutputLayout/FullText", "sortingstatistics.csv"),
+                         ReadFile("TestCellSortingOutputLayout/NoText", "sortingstatistics.csv"));
+    }
+
+    void TestSnapshotsReplacePerCellTextOutput()
+    {
+        CellSortingParameters parameters;
+        parameters.mModel = CellSortingModel::VERTEX;
+        parameters.mLengthscale = 0.0;
+        parameters.mDiffusionStrength = 0.1;
+        parameters.mNumCellsAcross = 4u;
+        parameters.mTimeToSteadyState = 0.5;
+        parameters.mTimeForSimulation = 2.5;
+        parameters.mSeed = 1u;
+
+        parameters.mOutputDirectory = "TestCellSortingOutputLayout/FullText";
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(parameters));
+
+        parameters.mOutputDirectory = "TestCellSortingOutputLayout/Snapshots";
+        parameters.mSnapshotSamplingInterval = 50u;
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(parameters));
+
+        // The snapshot file takes the place of the cell ids and mutation states, but not of the adjacency matrix
+        const std::set<std::string> full_files = ListFiles("TestCellSortingOutputLayout/FullText");
+        std::set<std::string> snapshot_files = ListFiles("TestCellSortingOutputLayout/Snapshots");
+        TS_ASSERT_EQUALS(snapshot_files.erase("populationsnapshots.bin"), 1u);
+        TS_ASSERT(std::includes(full_files.begin(), full_files.end(), snapshot_files.begin(), snapshot_files.end()));
+        TS_ASSERT_EQUALS(full_files.size(), snapshot_files.size() + 2u);
+    }
+};
+
+#endif /*TESTCELLSORTINGOUTPUTLAYOUT_HPP_*/
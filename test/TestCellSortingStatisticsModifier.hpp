@@ -0,0 +1,198 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTCELLSORTINGSTATISTICSMODIFIER_HPP_
+#define TESTCELLSORTINGSTATISTICSMODIFIER_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// From Chaste
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellsGenerator.hpp"
+#include "Exception.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "OutputFileHandler.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+// From this user project
+#include "CellSortingStatisticsModifier.hpp"
+#include "SimulationOutputDirectory.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestCellSortingStatisticsModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * @param rDirectory a directory, relative to $CHASTE_TEST_OUTPUT
+     * @return the rows of sortingstatistics.csv in the directory, each split into its fields, including the header
+     */
+    std::vector<std::vector<std::string>> ReadStatistics(const std::string& rDirectory)
+    {
+        OutputFileHandler handler(rDirectory, false);
+        std::ifstream file(handler.GetOutputDirectoryFullPath() + "sortingstatistics.csv");
+        TS_ASSERT(file.is_open());
+
+        std::vector<std::vector<std::string>> rows;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> fields;
+            std::stringstream line_stream(line);
+            std::string field;
+            while (std::getline(line_stream, field, ','))
+            {
+                fields.emplace_back(field);
+            }
+            rows.emplace_back(fields);
+        }
+        return rows;
+    }
+
+public:
+
+    void TestGetSimulationOutputDirectory()
+    {
+        TS_ASSERT_EQUALS(GetSimulationOutputDirectory("Sorting/Run/results_from_time_0"), "Sorting/Run");
+        TS_ASSERT_EQUALS(GetSimulationOutputDirectory("Sorting/Run//results_from_time_10"), "Sorting/Run");
+        TS_ASSERT_EQUALS(GetSimulationOutputDirectory("Sorting/Run"), "Sorting/Run");
+        TS_ASSERT_EQUALS(GetSimulationOutputDirectory("results_from_time_0"), "");
+    }
+
+    void TestStatisticsOfOneLabelledCell()
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        // Label the cell in the middle of the tissue
+        const unsigned labelled_idx = 4u;
+        cell_population.GetCellUsingLocationIndex(labelled_idx)->AddCellProperty(
+                CellPropertyRegistry::Instance()->Get<CellLabel>());
+
+        // Expect every pair with the labelled cell to be heterotypic, and every other pair to be homotypic
+        unsigned num_neighbour_entries = 0u;
+        double sum_homotypic_fractions = 0.0;
+        for (const auto& p_cell : cell_population.rGetCells())
+        {
+            const unsigned location_idx = cell_population.GetLocationIndexUsingCell(p_cell);
+            const std::set<unsigned> neighbours = cell_population.GetNeighbouringLocationIndices(p_cell);
+            num_neighbour_entries += neighbours.size();
+
+            unsigned num_homotypic = neighbours.size();
+            if (location_idx == labelled_idx)
+            {
+                num_homotypic = 0u;
+            }
+            else if (neighbours.count(labelled_idx) > 0u)
+            {
+                --num_homotypic;
+            }
+            sum_homotypic_fractions += static_cast<double>(num_homotypic) / neighbours.size();
+        }
+
+        const unsigned num_pairs = num_neighbour_entries / 2u;
+        const unsigned num_heterotypic_pairs =
+                cell_population.GetNeighbouringLocationIndices(cell_population.GetCellUsingLocationIndex(labelled_idx))
+                        .size();
+        TS_ASSERT_EQUALS(num_heterotypic_pairs, 6u);
+
+        CellSortingStatisticsModifier<2> modifier;
+        modifier.SetupSolve(cell_population, "TestCellSortingStatisticsModifier/OneLabelled/results_from_time_0");
+        modifier.UpdateAtEndOfSolve(cell_population);
+
+        const auto rows = ReadStatistics("TestCellSortingStatisticsModifier/OneLabelled");
+        TS_ASSERT_EQUALS(rows.size(), 2u);
+        TS_ASSERT_EQUALS(rows[0].size(), 7u);
+        TS_ASSERT_EQUALS(rows[1].size(), 7u);
+
+        TS_ASSERT_DELTA(std::stod(rows[1][0]), 0.0, 1e-12);
+        TS_ASSERT_EQUALS(std::stoul(rows[1][1]), 9u);
+        TS_ASSERT_EQUALS(std::stoul(rows[1][2]), 1u);
+        TS_ASSERT_EQUALS(std::stoul(rows[1][3]), num_pairs);
+        TS_ASSERT_EQUALS(std::stoul(rows[1][4]), num_heterotypic_pairs);
+        TS_ASSERT_DELTA(std::stod(rows[1][5]), static_cast<double>(num_heterotypic_pairs) / num_pairs, 1e-5);
+        TS_ASSERT_DELTA(std::stod(rows[1][6]), sum_homotypic_fractions / 9.0, 1e-5);
+    }
+
+    void TestFileContinuesAcrossStages()
+    {
+        HoneycombVertexMeshGenerator generator(2, 2);
+        MutableVertexMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        CellSortingStatisticsModifier<2> modifier;
+        TS_ASSERT_THROWS_THIS(modifier.SetSamplingInterval(0u), "The sampling interval must be at least 1.");
+
+        // A second stage of the same simulation continues the file, without repeating the row at the boundary
+        modifier.SetupSolve(cell_population, "TestCellSortingStatisticsModifier/Staged/results_from_time_0");
+        modifier.UpdateAtEndOfSolve(cell_population);
+        modifier.SetupSolve(cell_population, "TestCellSortingStatisticsModifier/Staged/results_from_time_10");
+        modifier.UpdateAtEndOfSolve(cell_population);
+
+        TS_ASSERT_EQUALS(ReadStatistics("TestCellSortingStatisticsModifier/Staged").size(), 2u);
+
+        // A different simulation output directory starts a new file
+        modifier.SetupSolve(cell_population, "TestCellSortingStatisticsModifier/Restarted/results_from_time_10");
+        modifier.UpdateAtEndOfSolve(cell_population);
+
+        TS_ASSERT_EQUALS(ReadStatistics("TestCellSortingStatisticsModifier/Restarted").size(), 2u);
+        TS_ASSERT_EQUALS(ReadStatistics("TestCellSortingStatisticsModifier/Staged").size(), 2u);
+    }
+};
+
+#endif /*TESTCELLSORTINGSTATISTICSMODIFIER_HPP_*/
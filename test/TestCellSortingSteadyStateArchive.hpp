@@ -0,0 +1,176 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTCELLSORTINGSTEADYSTATEARCHIVE_HPP_
+#define TESTCELLSORTINGSTEADYSTATEARCHIVE_HPP_
+
+// Needed for the test environment
+#include <cxxtest/TestSuite.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+// From Chaste
+#include "Exception.hpp"
+#include "FileFinder.hpp"
+#include "OutputFileHandler.hpp"
+
+// From this user project
+#include "CellSortingSimulation.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * CellSortingSimulation::Run() sets up and destroys its own singletons, so, as for the noise lengthscale sweeps, this
+ * suite does not derive from AbstractCellBasedTestSuite.
+ */
+class TestCellSortingSteadyStateArchive : public CxxTest::TestSuite
+{
+private:
+
+    /**
+     * @param model the model to simulate
+     * @param outputDir the output directory of the run, within that of this suite
+     * @param seed the seed of the run after steady state
+     * @return the parameters of a short run with a steady state archive, long enough for it to sample the sorting
+     *     statistics once after steady state
+     */
+    CellSortingParameters MakeParameters(CellSortingModel model, const std::string& outputDir, unsigned seed)
+    {
+        CellSortingParameters parameters;
+        parameters.mModel = model;
+        parameters.mOutputDirectory = "TestCellSortingSteadyStateArchive/" + outputDir;
+        parameters.mSeed = seed;
+        parameters.mSteadyStateSeed = 7u;
+
+        if (model == CellSortingModel::VERTEX)
+        {
+            parameters.mLengthscale = 0.0;
+            parameters.mDiffusionStrength = 0.1;
+            parameters.mNumCellsAcross = 4u;
+            parameters.mTimeToSteadyState = 0.5;
+            parameters.mTimeForSimulation = 2.0;
+            parameters.mSteadyStateArchive = "TestCellSortingSteadyStateArchive/archive";
+        }
+        else
+        {
+            parameters.mNumCellsAcross = 3u;
+            parameters.mNumFluidGridPoints = 32u;
+            parameters.mTimeToSteadyState = 1.0;
+            parameters.mTimeForSimulation = 3.5;
+            parameters.mSteadyStateArchive = "TestCellSortingSteadyStateArchive/ib_archive";
+        }
+        return parameters;
+    }
+
+    /**
+     * @param rOutputDir the output directory of a run, within that of this suite
+     * @return the contents of the sorting statistics file of the run
+     */
+    std::string ReadSortingStatistics(const std::string& rOutputDir)
+    {
+        OutputFileHandler handler("TestCellSortingSteadyStateArchive/" + rOutputDir, false);
+        std::ifstream file(handler.GetOutputDirectoryFullPath() + "sortingstatistics.csv");
+        TS_ASSERT(file.is_open());
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+public:
+
+    void TestSaveAndResumeFromSteadyState()
+    {
+        OutputFileHandler handler("TestCellSortingSteadyStateArchive", true);
+
+        // The first run saves its steady state, renaming the whole archive directory into place
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(MakeParameters(CellSortingModel::VERTEX, "saving", 1u)));
+        TS_ASSERT(handler.FindFile("archive/steady_state_parameters.txt").Exists());
+        TS_ASSERT(handler.FindFile("archive/archive").IsDir());
+        TS_ASSERT(!handler.FindFile("archive.tmp" + std::to_string(getpid())).Exists());
+
+        // A run with another seed resumes from it
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(MakeParameters(CellSortingModel::VERTEX, "resuming", 2u)));
+        TS_ASSERT(handler.FindFile("resuming/sortingstatistics.csv").Exists());
+
+        // ... and a run with the seed of the first repeats it exactly, so resuming is as good as running through
+        TS_ASSERT_THROWS_NOTHING(CellSortingSimulation::Run(MakeParameters(CellSortingModel::VERTEX, "repeating", 1u)));
+        TS_ASSERT_EQUALS(ReadSortingStatistics("repeating"), ReadSortingStatistics("saving"));
+        TS_ASSERT_DIFFERS(ReadSortingStatistics("resuming"), ReadSortingStatistics("saving"));
+
+        // Runs whose steady state would differ are rejected, rather than resuming from the wrong one
+        CellSortingParameters other_threshold = MakeParameters(CellSortingModel::VERTEX, "other_threshold", 3u);
+        other_threshold.mRearrangementThreshold = 0.02;
+        TS_ASSERT_THROWS_CONTAINS(CellSortingSimulation::Run(other_threshold),
+                                  "rearrangement_threshold=0.01 rather than rearrangement_threshold=0.02");
+
+        CellSortingParameters other_seed = MakeParameters(CellSortingModel::VERTEX, "other_seed", 4u);
+        other_seed.mSteadyStateSeed = 8u;
+        TS_ASSERT_THROWS_CONTAINS(CellSortingSimulation::Run(other_seed),
+                                  "steady_state_seed=7 rather than steady_state_seed=8");
+
+        CellSortingParameters other_time = MakeParameters(CellSortingModel::VERTEX, "other_time", 5u);
+        other_time.mTimeToSteadyState = 1.0;
+        TS_ASSERT_THROWS_CONTAINS(CellSortingSimulation::Run(other_time),
+                                  "time_to_steady_state=0.5 rather than time_to_steady_state=1");
+    }
+
+    void TestSaveAndResumeImmersedBoundaryFromSteadyState()
+    {
+        OutputFileHandler handler("TestCellSortingSteadyStateArchive", false);
+
+        TS_ASSERT_THROWS_NOTHING(
+            CellSortingSimulation::Run(MakeParameters(CellSortingModel::IMMERSED_BOUNDARY, "ib_saving", 1u)));
+        TS_ASSERT(handler.FindFile("ib_archive/steady_state_parameters.txt").Exists());
+        TS_ASSERT(handler.FindFile("ib_archive/archive").IsDir());
+
+        TS_ASSERT_THROWS_NOTHING(
+            CellSortingSimulation::Run(MakeParameters(CellSortingModel::IMMERSED_BOUNDARY, "ib_resuming", 2u)));
+        TS_ASSERT_THROWS_NOTHING(
+            CellSortingSimulation::Run(MakeParameters(CellSortingModel::IMMERSED_BOUNDARY, "ib_repeating", 1u)));
+        TS_ASSERT_EQUALS(ReadSortingStatistics("ib_repeating"), ReadSortingStatistics("ib_saving"));
+        TS_ASSERT_DIFFERS(ReadSortingStatistics("ib_resuming"), ReadSortingStatistics("ib_saving"));
+
+        // The fluid grid is part of the immersed boundary steady state
+        CellSortingParameters other_grid = MakeParameters(CellSortingModel::IMMERSED_BOUNDARY, "ib_other_grid", 3u);
+        other_grid.mNumFluidGridPoints = 64u;
+        TS_ASSERT_THROWS_CONTAINS(CellSortingSimulation::Run(other_grid), "rather than num_fluid_grid_points=64");
+    }
+};
+
+#endif /*TESTCELLSORTINGSTEADYSTATEARCHIVE_HPP_*/
@@ -0,0 +1,149 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTCOUNTERBASEDNORMALGENERATOR_HPP_
+#define TESTCOUNTERBASEDNORMALGENERATOR_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <cmath>
+#include <vector>
+
+// From this user project
+#include "CounterBasedNormalGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestCounterBasedNormalGenerator : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestPhiloxKnownAnswers()
+    {
+        using Block = CounterBasedNormalGenerator::Block;
+        using Key = std::array<std::uint32_t, 2>;
+
+        // The Philox4x32-10 known-answer vectors distributed with Random123
+        {
+            const Block out = CounterBasedNormalGenerator::Philox4x32({{0u, 0u, 0u, 0u}}, Key{{0u, 0u}});
+            TS_ASSERT_EQUALS(out[0], 0x6627e8d5u);
+            TS_ASSERT_EQUALS(out[1], 0xe169c58du);
+            TS_ASSERT_EQUALS(out[2], 0xbc57ac4cu);
+            TS_ASSERT_EQUALS(out[3], 0x9b00dbd8u);
+        }
+        {
+            const Block out = CounterBasedNormalGenerator::Philox4x32(
+                    {{0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}}, Key{{0xffffffffu, 0xffffffffu}});
+            TS_ASSERT_EQUALS(out[0], 0x408f276du);
+            TS_ASSERT_EQUALS(out[1], 0x41c83b0eu);
+            TS_ASSERT_EQUALS(out[2], 0xa20bc7c6u);
+            TS_ASSERT_EQUALS(out[3], 0x6d5451fdu);
+        }
+        {
+            const Block out = CounterBasedNormalGenerator::Philox4x32(
+                    {{0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}}, Key{{0xa4093822u, 0x299f31d0u}});
+            TS_ASSERT_EQUALS(out[0], 0xd16cfe09u);
+            TS_ASSERT_EQUALS(out[1], 0x94fdccebu);
+            TS_ASSERT_EQUALS(out[2], 0x5001e420u);
+            TS_ASSERT_EQUALS(out[3], 0x24126ea1u);
+        }
+    }
+
+    void TestKey()
+    {
+        CounterBasedNormalGenerator generator(0x0123456789abcdefu);
+        TS_ASSERT_EQUALS(generator.GetKey(), 0x0123456789abcdefu);
+
+        generator.SetKey(42u);
+        TS_ASSERT_EQUALS(generator.GetKey(), 42u);
+    }
+
+    void TestFillIsIndependentOfPartitioning()
+    {
+        const CounterBasedNormalGenerator generator(42u);
+        const std::size_t num_deviates = 101u;
+
+        std::vector<double> whole(num_deviates);
+        generator.FillStandardNormals(7u, 0u, num_deviates, whole.data());
+
+        // Filling in pieces, starting at odd and even indices, gives exactly the same deviates
+        std::vector<double> pieces(num_deviates);
+        generator.FillStandardNormals(7u, 0u, 3u, pieces.data());
+        generator.FillStandardNormals(7u, 3u, 50u, pieces.data() + 3u);
+        generator.FillStandardNormals(7u, 53u, 48u, pieces.data() + 53u);
+
+        for (std::size_t i = 0; i < num_deviates; ++i)
+        {
+            TS_ASSERT_EQUALS(whole[i], pieces[i]);
+        }
+
+        // Another stream, or another key, gives other deviates
+        std::vector<double> other_stream(num_deviates);
+        generator.FillStandardNormals(8u, 0u, num_deviates, other_stream.data());
+        TS_ASSERT_DIFFERS(whole[0], other_stream[0]);
+
+        std::vector<double> other_key(num_deviates);
+        CounterBasedNormalGenerator(43u).FillStandardNormals(7u, 0u, num_deviates, other_key.data());
+        TS_ASSERT_DIFFERS(whole[0], other_key[0]);
+    }
+
+    void TestMoments()
+    {
+        const CounterBasedNormalGenerator generator(2024u);
+        const std::size_t num_deviates = 200000u;
+
+        std::vector<double> deviates(num_deviates);
+        generator.FillStandardNormals(0u, 0u, num_deviates, deviates.data());
+
+        double sum = 0.0;
+        double sum_of_squares = 0.0;
+        for (const double deviate : deviates)
+        {
+            TS_ASSERT(std::isfinite(deviate));
+            sum += deviate;
+            sum_of_squares += deviate * deviate;
+        }
+
+        // The standard errors of the sample mean and variance are about 0.002 and 0.003
+        const double mean = sum / num_deviates;
+        TS_ASSERT_DELTA(mean, 0.0, 0.01);
+        TS_ASSERT_DELTA(sum_of_squares / num_deviates - mean * mean, 1.0, 0.015);
+    }
+};
+
+#endif /*TESTCOUNTERBASEDNORMALGENERATOR_HPP_*/
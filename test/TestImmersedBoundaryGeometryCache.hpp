@@ -0,0 +1,134 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYGEOMETRYCACHE_HPP_
+#define TESTIMMERSEDBOUNDARYGEOMETRYCACHE_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <memory>
+
+// From Chaste
+#include "ImmersedBoundaryMesh.hpp"
+#include "SimulationTime.hpp"
+
+// From this user project
+#include "ImmersedBoundaryGeometryCache.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestImmersedBoundaryGeometryCache : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestCachedValuesMatchMesh()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(3u, 3u, 5u, 64u, 1.0, 0.05, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        ImmersedBoundaryGeometryCache<2> cache(*p_mesh);
+        TS_ASSERT_EQUALS(&cache.rGetMesh(), p_mesh);
+
+        for (unsigned elem_idx = 0; elem_idx < p_mesh->GetNumElements(); ++elem_idx)
+        {
+            TS_ASSERT_EQUALS(cache.GetAverageNodeSpacingOfElement(elem_idx),
+                             p_mesh->GetAverageNodeSpacingOfElement(elem_idx, false));
+            TS_ASSERT_EQUALS(cache.GetSurfaceAreaOfElement(elem_idx), p_mesh->GetSurfaceAreaOfElement(elem_idx));
+            TS_ASSERT_EQUALS(cache.GetVolumeOfElement(elem_idx), p_mesh->GetVolumeOfElement(elem_idx));
+
+            const c_vector<double, 2> centroid = p_mesh->GetCentroidOfElement(elem_idx);
+            TS_ASSERT_EQUALS(cache.rGetCentroidOfElement(elem_idx)[0], centroid[0]);
+            TS_ASSERT_EQUALS(cache.rGetCentroidOfElement(elem_idx)[1], centroid[1]);
+        }
+    }
+
+    void TestInvalidation()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(3u, 3u, 5u, 64u, 1.0, 0.05, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        ImmersedBoundaryGeometryCache<2> cache(*p_mesh);
+        const double original_volume = cache.GetVolumeOfElement(0u);
+
+        // Moving a node by hand within a time step leaves the cached value until invalidated
+        p_mesh->GetElement(0u)->GetNode(0u)->rGetModifiableLocation()[0] += 0.01;
+        const double moved_volume = p_mesh->GetVolumeOfElement(0u);
+        TS_ASSERT_DIFFERS(moved_volume, original_volume);
+        TS_ASSERT_EQUALS(cache.GetVolumeOfElement(0u), original_volume);
+
+        cache.Invalidate();
+        TS_ASSERT_EQUALS(cache.GetVolumeOfElement(0u), moved_volume);
+
+        // Every value is recalculated on the next time step, without being invalidated
+        p_mesh->GetElement(0u)->GetNode(0u)->rGetModifiableLocation()[0] -= 0.01;
+        TS_ASSERT_EQUALS(cache.GetVolumeOfElement(0u), moved_volume);
+
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        TS_ASSERT_EQUALS(cache.GetVolumeOfElement(0u), p_mesh->GetVolumeOfElement(0u));
+        TS_ASSERT_EQUALS(cache.GetSurfaceAreaOfElement(0u), p_mesh->GetSurfaceAreaOfElement(0u));
+    }
+
+    void TestCacheIsSharedPerMesh()
+    {
+        VoronoiImmersedBoundaryMeshGenerator generator_a(2u, 2u, 5u, 64u, 1.0, 0.05, 0.5);
+        VoronoiImmersedBoundaryMeshGenerator generator_b(2u, 2u, 5u, 64u, 1.0, 0.05, 0.5);
+
+        std::shared_ptr<ImmersedBoundaryGeometryCache<2>> p_cache_a =
+                ImmersedBoundaryGeometryCache<2>::GetForMesh(*generator_a.GetMesh());
+        TS_ASSERT_EQUALS(ImmersedBoundaryGeometryCache<2>::GetForMesh(*generator_a.GetMesh()), p_cache_a);
+        TS_ASSERT_EQUALS(&p_cache_a->rGetMesh(), generator_a.GetMesh());
+
+        std::shared_ptr<ImmersedBoundaryGeometryCache<2>> p_cache_b =
+                ImmersedBoundaryGeometryCache<2>::GetForMesh(*generator_b.GetMesh());
+        TS_ASSERT_DIFFERS(p_cache_b, p_cache_a);
+        TS_ASSERT_EQUALS(&p_cache_b->rGetMesh(), generator_b.GetMesh());
+
+        // Once the last pointer is released the cache is destroyed, and a new one is made on request
+        std::weak_ptr<ImmersedBoundaryGeometryCache<2>> p_weak_cache_a = p_cache_a;
+        p_cache_a.reset();
+        TS_ASSERT(p_weak_cache_a.expired());
+        TS_ASSERT(ImmersedBoundaryGeometryCache<2>::GetForMesh(*generator_a.GetMesh()));
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYGEOMETRYCACHE_HPP_*/
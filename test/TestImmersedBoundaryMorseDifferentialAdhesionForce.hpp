@@ -0,0 +1,457 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYMORSEDIFFERENTIALADHESIONFORCE_HPP_
+#define TESTIMMERSEDBOUNDARYMORSEDIFFERENTIALADHESIONFORCE_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// From Chaste
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellsGenerator.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryElement.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+#include "SimulationTime.hpp"
+
+// From this user project
+#include "ImmersedBoundaryGeometryCache.hpp"
+#include "ImmersedBoundaryMorseDifferentialAdhesionForce.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestImmersedBoundaryMorseDifferentialAdhesionForce : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * Helper method to create cells for every element of a mesh, labelling every other cell.
+     *
+     * @param rMesh the mesh
+     * @return the cells
+     */
+    std::vector<CellPtr> CreateCells(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, rMesh.GetNumElements());
+
+        boost::shared_ptr<AbstractCellProperty> p_label(CellPropertyRegistry::Instance()->Get<CellLabel>());
+        for (unsigned cell_idx = 0; cell_idx < cells.size(); cell_idx += 2u)
+        {
+            cells[cell_idx]->AddCellProperty(p_label);
+        }
+
+        return cells;
+    }
+
+    /**
+     * Helper method to list every pair of nodes closer than a given distance, by brute force.
+     *
+     * @param rMesh the mesh
+     * @param maxDist the distance
+     * @return the pairs
+     */
+    std::vector<std::pair<Node<2>*, Node<2>*>> CalculateNodePairs(ImmersedBoundaryMesh<2, 2>& rMesh, double maxDist)
+    {
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs;
+        for (unsigned idx_a = 0; idx_a < rMesh.GetNumNodes(); ++idx_a)
+        {
+            for (unsigned idx_b = idx_a + 1u; idx_b < rMesh.GetNumNodes(); ++idx_b)
+            {
+                Node<2>* const p_node_a = rMesh.GetNode(idx_a);
+                Node<2>* const p_node_b = rMesh.GetNode(idx_b);
+                if (norm_2(rMesh.GetVectorFromAtoB(p_node_a->rGetLocation(), p_node_b->rGetLocation())) < maxDist)
+                {
+                    node_pairs.emplace_back(p_node_a, p_node_b);
+                }
+            }
+        }
+        return node_pairs;
+    }
+
+    /**
+     * Helper method to apply a force to a population on its own.
+     *
+     * @param rForce the force
+     * @param rNodePairs the node pairs of the population
+     * @param rCellPopulation the population
+     * @return the applied force on each node, DIM entries per node
+     */
+    std::vector<double> CalculateForces(ImmersedBoundaryMorseDifferentialAdhesionForce<2>& rForce,
+                                        std::vector<std::pair<Node<2>*, Node<2>*>>& rNodePairs,
+                                        ImmersedBoundaryCellPopulation<2>& rCellPopulation)
+    {
+        ImmersedBoundaryMesh<2, 2>& r_mesh = rCellPopulation.rGetMesh();
+        for (unsigned node_idx = 0; node_idx < r_mesh.GetNumNodes(); ++node_idx)
+        {
+            r_mesh.GetNode(node_idx)->ClearAppliedForce();
+        }
+
+        rForce.AddImmersedBoundaryForceContribution(rNodePairs, rCellPopulation);
+
+        std::vector<double> forces;
+        for (unsigned node_idx = 0; node_idx < r_mesh.GetNumNodes(); ++node_idx)
+        {
+            const c_vector<double, 2>& r_force = r_mesh.GetNode(node_idx)->rGetAppliedForce();
+            forces.insert(forces.end(), r_force.begin(), r_force.end());
+        }
+        return forces;
+    }
+
+    /**
+     * Helper method to translate the nodes of an element along the x axis, wrapping on the periodic unit square.
+     *
+     * @param rMesh the mesh
+     * @param elemIdx the index of the element
+     * @param distance the distance to move the nodes
+     */
+    void MoveElementNodes(ImmersedBoundaryMesh<2, 2>& rMesh, unsigned elemIdx, double distance)
+    {
+        ImmersedBoundaryElement<2, 2>* const p_elem = rMesh.GetElement(elemIdx);
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+        {
+            c_vector<double, 2>& r_location = p_elem->GetNode(local_idx)->rGetModifiableLocation();
+            r_location[0] += distance;
+            if (r_location[0] >= 1.0)
+            {
+                r_location[0] -= 1.0;
+            }
+        }
+        ImmersedBoundaryGeometryCache<2>::GetForMesh(rMesh)->Invalidate();
+    }
+
+    /**
+     * Helper method to translate every node of a mesh, wrapping on the periodic unit square.
+     *
+     * @param rMesh the mesh
+     * @param shiftX the distance to move the nodes along the x axis, in [0, 1)
+     * @param shiftY the distance to move the nodes along the y axis, in [0, 1)
+     */
+    void ShiftNodes(ImmersedBoundaryMesh<2, 2>& rMesh, double shiftX, double shiftY)
+    {
+        for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+        {
+            c_vector<double, 2>& r_location = rMesh.GetNode(node_idx)->rGetModifiableLocation();
+            r_location[0] = std::fmod(r_location[0] + shiftX, 1.0);
+            r_location[1] = std::fmod(r_location[1] + shiftY, 1.0);
+        }
+        ImmersedBoundaryGeometryCache<2>::GetForMesh(rMesh)->Invalidate();
+    }
+
+    /**
+     * Helper method to check that two sets of node forces agree up to the rounding of summing in a different order.
+     *
+     * @param rExpected the expected forces
+     * @param rActual the actual forces
+     * @param relTolerance the tolerance, relative to the largest expected force component
+     */
+    void CheckForcesAgree(const std::vector<double>& rExpected,
+                          const std::vector<double>& rActual,
+                          double relTolerance)
+    {
+        double max_force = 0.0;
+        for (const double force : rExpected)
+        {
+            max_force = std::max(max_force, std::fabs(force));
+        }
+        TS_ASSERT_LESS_THAN(0.0, max_force);
+
+        TS_ASSERT_EQUALS(rExpected.size(), rActual.size());
+        for (unsigned i = 0; i < std::min(rExpected.size(), rActual.size()); ++i)
+        {
+            TS_ASSERT_DELTA(rActual[i], rExpected[i], relTolerance * max_force);
+        }
+    }
+
+public:
+
+    void TestThreadsGiveBitwiseIdenticalForces()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        const double cell_gap = 0.03;
+        const double interaction_dist = 2.0 * cell_gap;
+        const double verlet_skin = 0.25 * cell_gap;
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, cell_gap, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.SetInteractionDistance(interaction_dist);
+        p_mesh->SetNeighbourDist(interaction_dist + verlet_skin);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs =
+                CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> force;
+        TS_ASSERT_THROWS_THIS(force.SetNumThreads(0u), "The number of threads must be at least 1.");
+
+        // Forces are accumulated in pair order whatever the number of threads, with and without the Verlet list
+        for (const double skin : {0.0, verlet_skin})
+        {
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> serial_force;
+            serial_force.SetVerletSkin(skin);
+            const std::vector<double> serial_forces = CalculateForces(serial_force, node_pairs, cell_population);
+
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> threaded_force;
+            threaded_force.SetVerletSkin(skin);
+            threaded_force.SetNumThreads(4u);
+            const std::vector<double> threaded_forces = CalculateForces(threaded_force, node_pairs, cell_population);
+
+            TS_ASSERT(std::any_of(serial_forces.begin(), serial_forces.end(), [](double f) { return f != 0.0; }));
+            TS_ASSERT_EQUALS(serial_forces.size(), threaded_forces.size());
+            for (unsigned i = 0; i < serial_forces.size(); ++i)
+            {
+                TS_ASSERT_EQUALS(serial_forces[i], threaded_forces[i]);
+            }
+        }
+    }
+
+    void TestVerletListMatchesFullPairList()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        const double cell_gap = 0.03;
+        const double interaction_dist = 2.0 * cell_gap;
+        const double verlet_skin = 0.25 * cell_gap;
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, cell_gap, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.SetInteractionDistance(interaction_dist);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs =
+                CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+        std::vector<std::pair<Node<2>*, Node<2>*>> no_node_pairs;
+
+        // The population's pairs must reach the interaction distance plus the skin
+        {
+            p_mesh->SetNeighbourDist(interaction_dist);
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> force;
+            force.SetVerletSkin(verlet_skin);
+            TS_ASSERT_THROWS_CONTAINS(CalculateForces(force, node_pairs, cell_population),
+                                      "The mesh neighbour distance must be at least the interaction distance plus "
+                                      "the Verlet skin");
+        }
+        p_mesh->SetNeighbourDist(interaction_dist + verlet_skin);
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> full_force;
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> verlet_force;
+        verlet_force.SetVerletSkin(verlet_skin);
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> reused_force;
+        reused_force.SetVerletSkin(verlet_skin);
+
+        // The Verlet list sums the same pair forces in a different order
+        CheckForcesAgree(CalculateForces(full_force, node_pairs, cell_population),
+                         CalculateForces(verlet_force, node_pairs, cell_population), 1e-12);
+        CalculateForces(reused_force, node_pairs, cell_population);
+
+        // After moving an element by less than half the skin the list is reused, so the population's pairs are not read
+        MoveElementNodes(*p_mesh, 0u, 0.4 * verlet_skin);
+        node_pairs = CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+        CheckForcesAgree(CalculateForces(full_force, node_pairs, cell_population),
+                         CalculateForces(reused_force, no_node_pairs, cell_population), 1e-12);
+
+        // After moving it by more than half the skin in total the list is rebuilt from the population's pairs
+        MoveElementNodes(*p_mesh, 0u, 0.4 * verlet_skin);
+        node_pairs = CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+        CheckForcesAgree(CalculateForces(full_force, node_pairs, cell_population),
+                         CalculateForces(verlet_force, node_pairs, cell_population), 1e-12);
+
+        const std::vector<double> rebuilt_forces = CalculateForces(reused_force, no_node_pairs, cell_population);
+        TS_ASSERT(std::all_of(rebuilt_forces.begin(), rebuilt_forces.end(), [](double f) { return f == 0.0; }));
+    }
+
+    void TestVerletKernelWrapsPeriodicBoundary()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        const double cell_gap = 0.03;
+        const double interaction_dist = 2.0 * cell_gap;
+        const double verlet_skin = 0.25 * cell_gap;
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, cell_gap, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        // Move every cell by half its width, so that cells interact across both periodic boundaries
+        ShiftNodes(*p_mesh, 0.125, 0.125);
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.SetInteractionDistance(interaction_dist);
+        p_mesh->SetNeighbourDist(interaction_dist + verlet_skin);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs =
+                CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+
+        unsigned num_wrapped_pairs = 0u;
+        for (const auto& r_node_pair : node_pairs)
+        {
+            const c_vector<double, 2> raw_difference =
+                    r_node_pair.second->rGetLocation() - r_node_pair.first->rGetLocation();
+            if (std::fabs(raw_difference[0]) > 0.5 || std::fabs(raw_difference[1]) > 0.5)
+            {
+                ++num_wrapped_pairs;
+            }
+        }
+        TS_ASSERT_LESS_THAN(0u, num_wrapped_pairs);
+
+        // The full pair loop wraps through the mesh, and the Verlet kernel through its specialisation for 2D
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> full_force;
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> verlet_force;
+        verlet_force.SetVerletSkin(verlet_skin);
+
+        CheckForcesAgree(CalculateForces(full_force, node_pairs, cell_population),
+                         CalculateForces(verlet_force, node_pairs, cell_population), 1e-12);
+    }
+
+    void TestDeviceOffloadMatchesHost()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        const double cell_gap = 0.03;
+        const double interaction_dist = 2.0 * cell_gap;
+        const double verlet_skin = 0.25 * cell_gap;
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, cell_gap, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+        ShiftNodes(*p_mesh, 0.125, 0.125);
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.SetInteractionDistance(interaction_dist);
+        p_mesh->SetNeighbourDist(interaction_dist + verlet_skin);
+
+        std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs =
+                CalculateNodePairs(*p_mesh, interaction_dist + verlet_skin);
+
+        // The device loop needs the Verlet list
+        {
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> force;
+            force.SetUseDeviceOffload(true);
+            TS_ASSERT_THROWS_THIS(CalculateForces(force, node_pairs, cell_population),
+                                  "Device offload needs a Verlet list, so the Verlet skin must be positive.");
+        }
+
+        // Both the analytic and the tabulated profile are evaluated on the device
+        for (const bool use_tabulated_potential : {false, true})
+        {
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> host_force;
+            host_force.SetVerletSkin(verlet_skin);
+            host_force.SetUseTabulatedPotential(use_tabulated_potential);
+            const std::vector<double> host_forces = CalculateForces(host_force, node_pairs, cell_population);
+
+            ImmersedBoundaryMorseDifferentialAdhesionForce<2> device_force;
+            device_force.SetVerletSkin(verlet_skin);
+            device_force.SetUseTabulatedPotential(use_tabulated_potential);
+            TS_ASSERT_EQUALS(device_force.GetUseDeviceOffload(), false);
+            device_force.SetUseDeviceOffload(true);
+            TS_ASSERT_EQUALS(device_force.GetUseDeviceOffload(), true);
+
+            // The second pass reuses the pairs on the device; only the device's exp() and sqrt() may differ
+            for (unsigned pass = 0; pass < 2u; ++pass)
+            {
+                CheckForcesAgree(host_forces, CalculateForces(device_force, node_pairs, cell_population), 1e-10);
+            }
+        }
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<3> force_3d;
+        TS_ASSERT_THROWS_THIS(force_3d.SetUseDeviceOffload(true), "Device offload is only available in 2D.");
+    }
+
+    void TestTabulatedPotentialMatchesAnalytic()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        const double cell_gap = 0.03;
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, cell_gap, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+        p_mesh->SetNeighbourDist(2.0 * cell_gap);
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> analytic_force;
+
+        ImmersedBoundaryMorseDifferentialAdhesionForce<2> tabulated_force;
+        TS_ASSERT_THROWS_THIS(tabulated_force.SetTabulationTolerance(0.0),
+                              "The tabulation tolerance must be positive.");
+        tabulated_force.SetUseTabulatedPotential(true);
+
+        // The table is rebuilt when the interaction distance changes
+        for (const double interaction_dist : {2.0 * cell_gap, 1.5 * cell_gap})
+        {
+            cell_population.SetInteractionDistance(interaction_dist);
+            std::vector<std::pair<Node<2>*, Node<2>*>> node_pairs = CalculateNodePairs(*p_mesh, interaction_dist);
+
+            const std::vector<double> analytic_forces = CalculateForces(analytic_force, node_pairs, cell_population);
+            const std::vector<double> tabulated_forces = CalculateForces(tabulated_force, node_pairs, cell_population);
+
+            double max_force = 0.0;
+            double max_difference = 0.0;
+            for (unsigned i = 0; i < analytic_forces.size(); ++i)
+            {
+                max_force = std::max(max_force, std::fabs(analytic_forces[i]));
+                max_difference = std::max(max_difference, std::fabs(tabulated_forces[i] - analytic_forces[i]));
+            }
+
+            // Each pair is within the tolerance of the largest tabulated magnitude, and nodes have a few dozen pairs
+            TS_ASSERT_LESS_THAN(0.0, max_force);
+            TS_ASSERT_LESS_THAN(max_difference, 1e-4 * max_force);
+        }
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYMORSEDIFFERENTIALADHESIONFORCE_HPP_*/
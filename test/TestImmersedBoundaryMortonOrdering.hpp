@@ -0,0 +1,177 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYMORTONORDERING_HPP_
+#define TESTIMMERSEDBOUNDARYMORTONORDERING_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// From Chaste
+#include "ImmersedBoundaryMesh.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "UblasCustomFunctions.hpp"
+
+// From this user project
+#include "ImmersedBoundaryMortonOrdering.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestImmersedBoundaryMortonOrdering : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestCalculateMortonCode()
+    {
+        typedef ImmersedBoundaryMortonOrdering<2> Ordering;
+        TS_ASSERT_EQUALS(Ordering::BITS_PER_DIM, 32u);
+
+        // The x bit is the more significant of each pair, and locations are clamped to the unit square
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(0.0, 0.0)), 0u);
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(0.5, 0.0)), std::uint64_t(1) << 63u);
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(0.0, 0.5)), std::uint64_t(1) << 62u);
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(0.75, 0.25)), std::uint64_t(0xB) << 60u);
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(1.0, 1.0)), UINT64_MAX);
+        TS_ASSERT_EQUALS(Ordering::CalculateMortonCode(Create_c_vector(-0.5, 2.0)),
+                         Ordering::CalculateMortonCode(Create_c_vector(0.0, 1.0)));
+
+        TS_ASSERT_EQUALS(ImmersedBoundaryMortonOrdering<3>::BITS_PER_DIM, 21u);
+        TS_ASSERT_EQUALS(ImmersedBoundaryMortonOrdering<3>::CalculateMortonCode(Create_c_vector(0.0, 0.0, 0.5)),
+                         std::uint64_t(1) << 60u);
+    }
+
+    void TestCalculateOrdering()
+    {
+        // One location in each quadrant, visited in Z order, with the repeated location after the first by index
+        const std::vector<c_vector<double, 2>> locations = {Create_c_vector(0.75, 0.75),
+                                                            Create_c_vector(0.25, 0.75),
+                                                            Create_c_vector(0.75, 0.25),
+                                                            Create_c_vector(0.25, 0.25),
+                                                            Create_c_vector(0.75, 0.75)};
+
+        const std::vector<unsigned> ordering = ImmersedBoundaryMortonOrdering<2>::CalculateOrdering(locations);
+        const std::vector<unsigned> expected = {3u, 1u, 2u, 0u, 4u};
+        TS_ASSERT(ordering == expected);
+
+        TS_ASSERT(ImmersedBoundaryMortonOrdering<2>::CalculateOrdering({}).empty());
+    }
+
+    void TestMortonOrderingKeepsElementNumbering()
+    {
+        RandomNumberGenerator::Instance()->Reseed(0u);
+        VoronoiImmersedBoundaryMeshGenerator plain_generator(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, false, false);
+        ImmersedBoundaryMesh<2, 2>* p_plain_mesh = plain_generator.GetMesh();
+
+        RandomNumberGenerator::Instance()->Reseed(0u);
+        VoronoiImmersedBoundaryMeshGenerator morton_generator(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, false, true);
+        ImmersedBoundaryMesh<2, 2>* p_morton_mesh = morton_generator.GetMesh();
+
+        // Without reordering, element i is generated from vertex element i, so with it element i must be the same
+        TS_ASSERT_EQUALS(p_morton_mesh->GetNumElements(), p_plain_mesh->GetNumElements());
+        TS_ASSERT_EQUALS(p_morton_mesh->GetNumNodes(), p_plain_mesh->GetNumNodes());
+        for (unsigned elem_idx = 0; elem_idx < p_plain_mesh->GetNumElements(); ++elem_idx)
+        {
+            ImmersedBoundaryElement<2, 2>* p_plain_elem = p_plain_mesh->GetElement(elem_idx);
+            ImmersedBoundaryElement<2, 2>* p_morton_elem = p_morton_mesh->GetElement(elem_idx);
+            TS_ASSERT_EQUALS(p_morton_elem->GetIndex(), elem_idx);
+            TS_ASSERT_EQUALS(p_morton_elem->IsElementOnBoundary(), p_plain_elem->IsElementOnBoundary());
+
+            TS_ASSERT_EQUALS(p_morton_elem->GetNumNodes(), p_plain_elem->GetNumNodes());
+            for (unsigned local_idx = 0; local_idx < p_plain_elem->GetNumNodes(); ++local_idx)
+            {
+                const c_vector<double, 2>& r_plain = p_plain_elem->GetNode(local_idx)->rGetLocation();
+                const c_vector<double, 2>& r_morton = p_morton_elem->GetNode(local_idx)->rGetLocation();
+                TS_ASSERT_EQUALS(r_morton[0], r_plain[0]);
+                TS_ASSERT_EQUALS(r_morton[1], r_plain[1]);
+            }
+        }
+
+        // Nodes and balancing fluid sources are numbered in order of Morton code
+        for (unsigned node_idx = 0; node_idx < p_morton_mesh->GetNumNodes(); ++node_idx)
+        {
+            TS_ASSERT_EQUALS(p_morton_mesh->GetNode(node_idx)->GetIndex(), node_idx);
+            if (node_idx > 0u)
+            {
+                TS_ASSERT_LESS_THAN_EQUALS(ImmersedBoundaryMortonOrdering<2>::CalculateMortonCode(
+                                                   p_morton_mesh->GetNode(node_idx - 1u)->rGetLocation()),
+                                           ImmersedBoundaryMortonOrdering<2>::CalculateMortonCode(
+                                                   p_morton_mesh->GetNode(node_idx)->rGetLocation()));
+            }
+        }
+
+        const auto& r_sources = p_morton_mesh->rGetBalancingFluidSources();
+        TS_ASSERT_EQUALS(r_sources.size(), p_plain_mesh->rGetBalancingFluidSources().size());
+        for (unsigned source_idx = 1; source_idx < r_sources.size(); ++source_idx)
+        {
+            TS_ASSERT_LESS_THAN_EQUALS(
+                    ImmersedBoundaryMortonOrdering<2>::CalculateMortonCode(r_sources[source_idx - 1u]->rGetLocation()),
+                    ImmersedBoundaryMortonOrdering<2>::CalculateMortonCode(r_sources[source_idx]->rGetLocation()));
+        }
+
+        // Renumbering the already ordered nodes changes nothing
+        TS_ASSERT(!ImmersedBoundaryMortonOrdering<2>::RenumberNodes(*p_morton_mesh));
+
+        // Renumbering the plain mesh keeps each element's nodes, in order, and numbers nodes by position
+        auto GetNodesByElement = [](ImmersedBoundaryMesh<2, 2>& rMesh)
+        {
+            std::vector<std::vector<Node<2>*>> nodes_by_elem(rMesh.GetNumElements());
+            for (unsigned elem_idx = 0; elem_idx < rMesh.GetNumElements(); ++elem_idx)
+            {
+                ImmersedBoundaryElement<2, 2>* p_elem = rMesh.GetElement(elem_idx);
+                for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+                {
+                    nodes_by_elem[elem_idx].emplace_back(p_elem->GetNode(local_idx));
+                }
+            }
+            return nodes_by_elem;
+        };
+
+        const std::vector<std::vector<Node<2>*>> plain_nodes_by_elem = GetNodesByElement(*p_plain_mesh);
+        TS_ASSERT(ImmersedBoundaryMortonOrdering<2>::RenumberNodes(*p_plain_mesh));
+        TS_ASSERT(GetNodesByElement(*p_plain_mesh) == plain_nodes_by_elem);
+        for (unsigned node_idx = 0; node_idx < p_plain_mesh->GetNumNodes(); ++node_idx)
+        {
+            TS_ASSERT_EQUALS(p_plain_mesh->GetNode(node_idx)->GetIndex(), node_idx);
+        }
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYMORTONORDERING_HPP_*/
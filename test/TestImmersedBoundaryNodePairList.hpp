@@ -0,0 +1,161 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYNODEPAIRLIST_HPP_
+#define TESTIMMERSEDBOUNDARYNODEPAIRLIST_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+// From Chaste
+#include "ImmersedBoundaryMesh.hpp"
+#include "Node.hpp"
+
+// From this user project
+#include "ImmersedBoundaryNodePairList.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/** A node pair as its two element indices followed by its two node indices, lower element first */
+typedef std::array<unsigned, 4> KeyedPair;
+
+class TestImmersedBoundaryNodePairList : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * @param rPairList a pair list
+     * @param rMesh the mesh the list was built from
+     * @return every pair in the list, keyed by its elements in the order of the list, checking the element pairs
+     *     describe contiguous ranges of node pairs in those elements
+     */
+    std::vector<KeyedPair> GetKeyedPairs(const ImmersedBoundaryNodePairList<2>& rPairList,
+                                         ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<KeyedPair> keyed_pairs;
+        const auto& r_node_pairs = rPairList.rGetNodePairs();
+        for (const auto& r_elem_pair : rPairList.rGetElementPairs())
+        {
+            TS_ASSERT_LESS_THAN(r_elem_pair.mElemA, r_elem_pair.mElemB);
+            TS_ASSERT_EQUALS(r_elem_pair.mFirstNodePair, keyed_pairs.size());
+            TS_ASSERT_LESS_THAN(r_elem_pair.mFirstNodePair, r_elem_pair.mEndNodePair);
+
+            for (unsigned pair_idx = r_elem_pair.mFirstNodePair; pair_idx < r_elem_pair.mEndNodePair; ++pair_idx)
+            {
+                const unsigned node_a = r_node_pairs[pair_idx].mNodeA;
+                const unsigned node_b = r_node_pairs[pair_idx].mNodeB;
+                TS_ASSERT_EQUALS(*(rMesh.GetNode(node_a)->ContainingElementsBegin()), r_elem_pair.mElemA);
+                TS_ASSERT_EQUALS(*(rMesh.GetNode(node_b)->ContainingElementsBegin()), r_elem_pair.mElemB);
+
+                keyed_pairs.push_back({{r_elem_pair.mElemA, r_elem_pair.mElemB, node_a, node_b}});
+            }
+        }
+        TS_ASSERT_EQUALS(keyed_pairs.size(), r_node_pairs.size());
+        return keyed_pairs;
+    }
+
+public:
+
+    void TestRoundTripToKeySortedPairs()
+    {
+        VoronoiImmersedBoundaryMeshGenerator generator(3u, 3u, 1u, 64u, 0.9, 0.02);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+        const double max_dist = 0.05;
+
+        // Every pair of nodes once, as a box collection would give them, and the pairs the list should keep
+        std::vector<std::pair<Node<2>*, Node<2>*> > node_pairs;
+        std::vector<KeyedPair> expected_pairs;
+        for (unsigned idx_a = 0; idx_a < p_mesh->GetNumNodes(); ++idx_a)
+        {
+            for (unsigned idx_b = idx_a + 1u; idx_b < p_mesh->GetNumNodes(); ++idx_b)
+            {
+                Node<2>* const p_node_a = p_mesh->GetNode(idx_a);
+                Node<2>* const p_node_b = p_mesh->GetNode(idx_b);
+                node_pairs.emplace_back(p_node_a, p_node_b);
+
+                const unsigned elem_a = *(p_node_a->ContainingElementsBegin());
+                const unsigned elem_b = *(p_node_b->ContainingElementsBegin());
+                const double dist = norm_2(p_mesh->GetVectorFromAtoB(p_node_a->rGetLocation(),
+                                                                     p_node_b->rGetLocation()));
+                if (elem_a != elem_b && dist < max_dist)
+                {
+                    expected_pairs.push_back(elem_a < elem_b ? KeyedPair{{elem_a, elem_b, idx_a, idx_b}}
+                                                             : KeyedPair{{elem_b, elem_a, idx_b, idx_a}});
+                }
+            }
+        }
+        std::sort(expected_pairs.begin(), expected_pairs.end());
+        TS_ASSERT(!expected_pairs.empty());
+
+        ImmersedBoundaryNodePairList<2> pair_list;
+        pair_list.Build(node_pairs, *p_mesh, max_dist);
+        TS_ASSERT(GetKeyedPairs(pair_list, *p_mesh) == expected_pairs);
+
+        // The list does not depend on the order of the pairs, or of the nodes within each pair
+        std::reverse(node_pairs.begin(), node_pairs.end());
+        for (auto& r_node_pair : node_pairs)
+        {
+            std::swap(r_node_pair.first, r_node_pair.second);
+        }
+        pair_list.Build(node_pairs, *p_mesh, max_dist);
+        TS_ASSERT(GetKeyedPairs(pair_list, *p_mesh) == expected_pairs);
+
+        // Building from fewer pairs drops the rest, and clearing drops all of them
+        node_pairs.clear();
+        pair_list.Build(node_pairs, *p_mesh, max_dist);
+        TS_ASSERT(pair_list.rGetNodePairs().empty());
+        TS_ASSERT(pair_list.rGetElementPairs().empty());
+
+        pair_list.Build({{p_mesh->GetNode(expected_pairs[0][3]), p_mesh->GetNode(expected_pairs[0][2])}}, *p_mesh,
+                        max_dist);
+        TS_ASSERT_EQUALS(pair_list.rGetNodePairs().size(), 1u);
+        TS_ASSERT_EQUALS(pair_list.rGetNodePairs()[0].mNodeA, expected_pairs[0][2]);
+        TS_ASSERT_EQUALS(pair_list.rGetNodePairs()[0].mNodeB, expected_pairs[0][3]);
+
+        pair_list.Clear();
+        TS_ASSERT(pair_list.rGetNodePairs().empty());
+        TS_ASSERT(pair_list.rGetElementPairs().empty());
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYNODEPAIRLIST_HPP_*/
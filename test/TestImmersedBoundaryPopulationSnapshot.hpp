@@ -0,0 +1,169 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_
+#define TESTIMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// From Chaste
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellsGenerator.hpp"
+#include "Exception.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+
+// From this user project
+#include "ImmersedBoundaryMortonOrdering.hpp"
+#include "ImmersedBoundaryPopulationSnapshot.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestImmersedBoundaryPopulationSnapshot : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * @param rCellPopulation a population
+     * @return the location of every node of the element of each cell, in the order of rGetCells() and then of the
+     *     element's nodes
+     */
+    std::vector<c_vector<double, 2>> GetLocationsByCell(ImmersedBoundaryCellPopulation<2>& rCellPopulation)
+    {
+        std::vector<c_vector<double, 2>> locations;
+        for (const auto& p_cell : rCellPopulation.rGetCells())
+        {
+            ImmersedBoundaryElement<2, 2>* p_elem =
+                    rCellPopulation.rGetMesh().GetElement(rCellPopulation.GetLocationIndexUsingCell(p_cell));
+            for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+            {
+                locations.emplace_back(p_elem->GetNode(local_idx)->rGetLocation());
+            }
+        }
+        return locations;
+    }
+
+public:
+
+    void TestRoundTripAcrossNodeRenumbering()
+    {
+        VoronoiImmersedBoundaryMeshGenerator generator(3u, 3u, 1u, 64u, 0.9, 0.02);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        boost::shared_ptr<AbstractCellProperty> p_label = CellPropertyRegistry::Instance()->Get<CellLabel>();
+        cell_population.rGetCells().front()->AddCellProperty(p_label);
+        cell_population.rGetCells().front()->GetCellData()->SetItem("target area", 0.1);
+
+        const std::vector<c_vector<double, 2>> original_locations = GetLocationsByCell(cell_population);
+        const ImmersedBoundaryPopulationSnapshot<2> snapshot(cell_population);
+
+        // Move every node, change cell labels and data, and renumber the nodes, as a run with Morton ordering would
+        for (auto& p_node : p_mesh->rGetNodes())
+        {
+            const c_vector<double, 2> location = p_node->rGetLocation();
+            p_node->rGetModifiableLocation() = Create_c_vector(1.0 - location[1], location[0]);
+        }
+        for (const auto& p_cell : cell_population.rGetCells())
+        {
+            p_cell->GetCellData()->SetItem("target area", 0.2);
+            if (p_cell->HasCellProperty<CellLabel>())
+            {
+                p_cell->RemoveCellProperty<CellLabel>();
+            }
+            else
+            {
+                p_cell->AddCellProperty(p_label);
+            }
+        }
+        TS_ASSERT(ImmersedBoundaryMortonOrdering<2>::RenumberNodes(*p_mesh));
+
+        snapshot.Restore(cell_population);
+
+        // Each node of each cell's element is back where it was, although its index has changed
+        const std::vector<c_vector<double, 2>> restored_locations = GetLocationsByCell(cell_population);
+        TS_ASSERT_EQUALS(restored_locations.size(), original_locations.size());
+        for (unsigned idx = 0; idx < std::min(restored_locations.size(), original_locations.size()); ++idx)
+        {
+            TS_ASSERT_EQUALS(restored_locations[idx][0], original_locations[idx][0]);
+            TS_ASSERT_EQUALS(restored_locations[idx][1], original_locations[idx][1]);
+        }
+
+        bool is_first = true;
+        for (const auto& p_cell : cell_population.rGetCells())
+        {
+            TS_ASSERT_EQUALS(p_cell->HasCellProperty<CellLabel>(), is_first);
+            if (is_first)
+            {
+                TS_ASSERT_EQUALS(p_cell->GetCellData()->GetItem("target area"), 0.1);
+            }
+            is_first = false;
+        }
+    }
+
+    void TestRestoreIntoDifferentPopulationThrows()
+    {
+        VoronoiImmersedBoundaryMeshGenerator generator(3u, 3u, 1u, 64u, 0.9, 0.02);
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, generator.GetMesh()->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> cell_population(*generator.GetMesh(), cells);
+        const ImmersedBoundaryPopulationSnapshot<2> snapshot(cell_population);
+
+        VoronoiImmersedBoundaryMeshGenerator other_generator(4u, 4u, 1u, 64u, 0.9, 0.02);
+        std::vector<CellPtr> other_cells;
+        cells_generator.GenerateBasicRandom(other_cells, other_generator.GetMesh()->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> other_population(*other_generator.GetMesh(), other_cells);
+
+        TS_ASSERT_THROWS_THIS(snapshot.Restore(other_population),
+                              "Cannot restore a snapshot into a population with a different mesh structure.");
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYPOPULATIONSNAPSHOT_HPP_*/
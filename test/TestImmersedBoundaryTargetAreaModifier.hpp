@@ -0,0 +1,382 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTIMMERSEDBOUNDARYTARGETAREAMODIFIER_HPP_
+#define TESTIMMERSEDBOUNDARYTARGETAREAMODIFIER_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// From Chaste
+#include "CellsGenerator.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryElement.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+#include "SimulationTime.hpp"
+
+// From this user project
+#include "ImmersedBoundaryTargetAreaModifier.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * Exposes the crowding used by ImmersedBoundaryTargetAreaModifier in its most recent update.
+ */
+class TestableImmersedBoundaryTargetAreaModifier : public ImmersedBoundaryTargetAreaModifier<2>
+{
+public:
+
+    /** @return the crowding of each element, exact or extrapolated */
+    const std::vector<double>& rGetCrowding() const
+    {
+        return mCrowding;
+    }
+};
+
+class TestImmersedBoundaryTargetAreaModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /** The default response speed of the modifier */
+    static constexpr double RESPONSE_SPEED = 0.001;
+
+    /**
+     * Helper method to create a cell for every element of a mesh.
+     *
+     * @param rMesh the mesh
+     * @return the cells
+     */
+    std::vector<CellPtr> CreateCells(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, rMesh.GetNumElements());
+        return cells;
+    }
+
+    /**
+     * Helper method to translate the nodes of an element along the x axis, wrapping on the periodic unit square.
+     *
+     * @param rMesh the mesh
+     * @param elemIdx the index of the element
+     * @param distance the distance to move the nodes
+     */
+    void MoveElementNodes(ImmersedBoundaryMesh<2, 2>& rMesh, unsigned elemIdx, double distance)
+    {
+        ImmersedBoundaryElement<2, 2>* const p_elem = rMesh.GetElement(elemIdx);
+        for (unsigned local_idx = 0; local_idx < p_elem->GetNumNodes(); ++local_idx)
+        {
+            c_vector<double, 2>& r_location = p_elem->GetNode(local_idx)->rGetModifiableLocation();
+            r_location[0] = std::fmod(r_location[0] + distance, 1.0);
+        }
+    }
+
+    /**
+     * Helper method to evaluate the crowding of every element directly from the mesh.
+     *
+     * @param rMesh the mesh
+     * @return the ratio of the Voronoi perimeter to the perimeter of each element
+     */
+    std::vector<double> CalculateExactCrowding(ImmersedBoundaryMesh<2, 2>& rMesh)
+    {
+        std::vector<double> crowding;
+        for (unsigned elem_idx = 0; elem_idx < rMesh.GetNumElements(); ++elem_idx)
+        {
+            crowding.push_back(rMesh.GetVoronoiSurfaceAreaOfElement(elem_idx) /
+                               rMesh.GetSurfaceAreaOfElement(elem_idx));
+        }
+        return crowding;
+    }
+
+    /**
+     * Helper method to get the target area of every cell.
+     *
+     * @param rCellPopulation the population
+     * @return the target area of the cell of each element, indexed by element index
+     */
+    std::vector<double> GetTargetAreas(ImmersedBoundaryCellPopulation<2>& rCellPopulation)
+    {
+        std::vector<double> target_areas(rCellPopulation.rGetMesh().GetNumElements());
+        for (unsigned elem_idx = 0; elem_idx < target_areas.size(); ++elem_idx)
+        {
+            target_areas[elem_idx] =
+                    rCellPopulation.GetCellUsingLocationIndex(elem_idx)->GetCellData()->GetItem("target area");
+        }
+        return target_areas;
+    }
+
+    /**
+     * Helper method to calculate the next target areas as the modifier did before crowding could be extrapolated,
+     * with exact crowding, a two-pass mean and variance, and a cell lookup for every target area.
+     *
+     * @param rCellPopulation the population
+     * @param minTargetArea the minimum target area of the modifier
+     * @param maxTargetArea the maximum target area of the modifier
+     * @return the target area of the cell of each element, indexed by element index
+     */
+    std::vector<double> CalculateBaselineTargetAreas(ImmersedBoundaryCellPopulation<2>& rCellPopulation,
+                                                     double minTargetArea,
+                                                     double maxTargetArea)
+    {
+        const std::vector<double> crowding = CalculateExactCrowding(rCellPopulation.rGetMesh());
+
+        const double crowding_mean = std::accumulate(crowding.begin(), crowding.end(), 0.0) / crowding.size();
+        double crowding_sum_sq_diffs = 0.0;
+        for (const double element_crowding : crowding)
+        {
+            crowding_sum_sq_diffs += (element_crowding - crowding_mean) * (element_crowding - crowding_mean);
+        }
+        const double crowding_std = std::sqrt(crowding_sum_sq_diffs / crowding.size());
+
+        const double response = RESPONSE_SPEED * SimulationTime::Instance()->GetTimeStep();
+
+        std::vector<double> target_areas = GetTargetAreas(rCellPopulation);
+        const double old_total_target_area = std::accumulate(target_areas.begin(), target_areas.end(), 0.0);
+
+        for (unsigned elem_idx = 0; elem_idx < target_areas.size(); ++elem_idx)
+        {
+            const double deviation = (crowding[elem_idx] - crowding_mean) / crowding_std;
+            const double t_area = target_areas[elem_idx] * (1.0 + response * deviation);
+            target_areas[elem_idx] = std::min(std::max(t_area, minTargetArea), maxTargetArea);
+        }
+
+        const double tweak = (old_total_target_area - std::accumulate(target_areas.begin(), target_areas.end(), 0.0)) /
+                             target_areas.size();
+        for (double& r_target_area : target_areas)
+        {
+            r_target_area += tweak;
+        }
+        return target_areas;
+    }
+
+    /**
+     * Helper method to check that two vectors agree to within a relative tolerance.
+     *
+     * @param rExpected the expected values
+     * @param rActual the actual values
+     * @param relTolerance the tolerance, relative to each expected value
+     */
+    void CheckValuesAgree(const std::vector<double>& rExpected,
+                          const std::vector<double>& rActual,
+                          double relTolerance)
+    {
+        TS_ASSERT_EQUALS(rExpected.size(), rActual.size());
+        for (unsigned i = 0; i < std::min(rExpected.size(), rActual.size()); ++i)
+        {
+            TS_ASSERT_DELTA(rActual[i], rExpected[i], relTolerance * std::fabs(rExpected[i]));
+        }
+    }
+
+public:
+
+    void TestIntervalOneReproducesBaselineTargetAreas()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        TestableImmersedBoundaryTargetAreaModifier modifier;
+        modifier.SetMinTargetArea(0.0);
+        modifier.SetMaxTargetArea(1.0);
+        TS_ASSERT_EQUALS(modifier.GetCrowdingUpdateInterval(), 1u);
+        TS_ASSERT_THROWS_THIS(modifier.SetCrowdingUpdateInterval(0u),
+                              "The crowding update interval must be at least 1.");
+        modifier.SetupSolve(cell_population, "TestImmersedBoundaryTargetAreaModifier");
+
+        // Every time step evaluates crowding exactly, as the modifier always did before it could extrapolate
+        for (unsigned step = 0; step < 4u; ++step)
+        {
+            MoveElementNodes(*p_mesh, step, 0.01);
+            SimulationTime::Instance()->IncrementTimeOneStep();
+
+            const std::vector<double> expected_target_areas = CalculateBaselineTargetAreas(cell_population, 0.0, 1.0);
+            modifier.UpdateAtEndOfTimeStep(cell_population);
+
+            CheckValuesAgree(CalculateExactCrowding(*p_mesh), modifier.rGetCrowding(), 1e-12);
+            CheckValuesAgree(expected_target_areas, GetTargetAreas(cell_population), 1e-12);
+        }
+    }
+
+    void TestSinglePassStatisticsMatchTwoPassBaseline()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(5u, 5u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        TestableImmersedBoundaryTargetAreaModifier modifier;
+        modifier.SetMinTargetArea(0.0);
+        modifier.SetMaxTargetArea(1.0);
+        modifier.SetupSolve(cell_population, "TestImmersedBoundaryTargetAreaModifier");
+
+        for (unsigned step = 0; step < 3u; ++step)
+        {
+            // Crowd a few elements against their neighbours, to spread the crowding
+            for (unsigned elem_idx = step; elem_idx < p_mesh->GetNumElements(); elem_idx += 7u)
+            {
+                MoveElementNodes(*p_mesh, elem_idx, 0.01);
+            }
+            SimulationTime::Instance()->IncrementTimeOneStep();
+
+            const std::vector<double> old_target_areas = GetTargetAreas(cell_population);
+            const std::vector<double> expected_target_areas = CalculateBaselineTargetAreas(cell_population, 0.0, 1.0);
+            modifier.UpdateAtEndOfTimeStep(cell_population);
+            const std::vector<double> target_areas = GetTargetAreas(cell_population);
+
+            /*
+             * Each change in target area is proportional to the deviation of crowding from its mean, in units of its
+             * standard deviation, so comparing the changes checks the statistics far more tightly than comparing
+             * the target areas themselves
+             */
+            double max_change = 0.0;
+            for (unsigned elem_idx = 0; elem_idx < target_areas.size(); ++elem_idx)
+            {
+                const double expected_change = expected_target_areas[elem_idx] - old_target_areas[elem_idx];
+                max_change = std::max(max_change, std::fabs(expected_change));
+            }
+            TS_ASSERT_LESS_THAN(0.0, max_change);
+
+            for (unsigned elem_idx = 0; elem_idx < target_areas.size(); ++elem_idx)
+            {
+                TS_ASSERT_DELTA(target_areas[elem_idx] - old_target_areas[elem_idx],
+                                expected_target_areas[elem_idx] - old_target_areas[elem_idx],
+                                1e-9 * max_change);
+            }
+        }
+    }
+
+    void TestCrowdingIsExtrapolatedBetweenExactEvaluations()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        TestableImmersedBoundaryTargetAreaModifier modifier;
+        modifier.SetMinTargetArea(0.0);
+        modifier.SetMaxTargetArea(1.0);
+        modifier.SetCrowdingUpdateInterval(3u);
+
+        // Setting up evaluates crowding exactly, at time step 0
+        modifier.SetupSolve(cell_population, "TestImmersedBoundaryTargetAreaModifier");
+        const std::vector<double> crowding_0 = CalculateExactCrowding(*p_mesh);
+        CheckValuesAgree(crowding_0, modifier.rGetCrowding(), 1e-12);
+
+        // With only one exact evaluation to go on, crowding is taken to be unchanged until the interval has elapsed
+        for (unsigned step = 1; step < 3u; ++step)
+        {
+            MoveElementNodes(*p_mesh, 0u, 0.005);
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            modifier.UpdateAtEndOfTimeStep(cell_population);
+            CheckValuesAgree(crowding_0, modifier.rGetCrowding(), 1e-12);
+        }
+
+        MoveElementNodes(*p_mesh, 0u, 0.005);
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        modifier.UpdateAtEndOfTimeStep(cell_population);
+        const std::vector<double> crowding_3 = CalculateExactCrowding(*p_mesh);
+        CheckValuesAgree(crowding_3, modifier.rGetCrowding(), 1e-12);
+        TS_ASSERT(crowding_3 != crowding_0);
+
+        // One step later, crowding is extrapolated a third of the way beyond the last exact evaluation
+        MoveElementNodes(*p_mesh, 0u, 0.005);
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        modifier.UpdateAtEndOfTimeStep(cell_population);
+
+        std::vector<double> extrapolated_crowding(crowding_3.size());
+        for (unsigned elem_idx = 0; elem_idx < crowding_3.size(); ++elem_idx)
+        {
+            extrapolated_crowding[elem_idx] =
+                    crowding_3[elem_idx] + (crowding_3[elem_idx] - crowding_0[elem_idx]) / 3.0;
+        }
+        CheckValuesAgree(extrapolated_crowding, modifier.rGetCrowding(), 1e-12);
+    }
+
+    void TestCrowdingIsReusedWithinDisplacementTolerance()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells = CreateCells(*p_mesh);
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        TestableImmersedBoundaryTargetAreaModifier modifier;
+        modifier.SetMinTargetArea(0.0);
+        modifier.SetMaxTargetArea(1.0);
+        TS_ASSERT_THROWS_THIS(modifier.SetCrowdingDisplacementTolerance(-1.0),
+                              "The crowding displacement tolerance must be non-negative.");
+        modifier.SetCrowdingDisplacementTolerance(0.02);
+        TS_ASSERT_DELTA(modifier.GetCrowdingDisplacementTolerance(), 0.02, 1e-12);
+
+        modifier.SetupSolve(cell_population, "TestImmersedBoundaryTargetAreaModifier");
+        const std::vector<double> crowding_0 = CalculateExactCrowding(*p_mesh);
+
+        // While no node has moved further than the tolerance, the last exact crowding is reused
+        MoveElementNodes(*p_mesh, 0u, 0.01);
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        modifier.UpdateAtEndOfTimeStep(cell_population);
+        TS_ASSERT(CalculateExactCrowding(*p_mesh) != crowding_0);
+        CheckValuesAgree(crowding_0, modifier.rGetCrowding(), 1e-12);
+
+        // Once one has, crowding is evaluated exactly again
+        MoveElementNodes(*p_mesh, 0u, 0.015);
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        modifier.UpdateAtEndOfTimeStep(cell_population);
+        CheckValuesAgree(CalculateExactCrowding(*p_mesh), modifier.rGetCrowding(), 1e-12);
+    }
+};
+
+#endif /*TESTIMMERSEDBOUNDARYTARGETAREAMODIFIER_HPP_*/
@@ -0,0 +1,154 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTOFFLATTICERANDOMFIELDFORCE_HPP_
+#define TESTOFFLATTICERANDOMFIELDFORCE_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+// From Chaste
+#include "CellsGenerator.hpp"
+#include "ImmersedBoundaryCellPopulation.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "NoCellCycleModel.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "SimulationTime.hpp"
+#include "UniformGridRandomFieldGenerator.hpp"
+
+// From this user project
+#include "OffLatticeRandomFieldForce.hpp"
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+class TestOffLatticeRandomFieldForce : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * Helper method to spread the nodes of a mesh over the periodic unit square, so that between them they take the
+     * field at every part of the grid, including either side of the periodic boundaries.
+     *
+     * @param rMesh the mesh
+     * @param offset an offset added to every coordinate before wrapping
+     */
+    void SpreadNodes(ImmersedBoundaryMesh<2, 2>& rMesh, double offset)
+    {
+        const double golden_ratio = 0.5 * (1.0 + std::sqrt(5.0));
+        for (unsigned node_idx = 0; node_idx < rMesh.GetNumNodes(); ++node_idx)
+        {
+            c_vector<double, 2>& r_location = rMesh.GetNode(node_idx)->rGetModifiableLocation();
+            r_location[0] = std::fmod(offset + node_idx * golden_ratio, 1.0);
+            r_location[1] = std::fmod(offset + node_idx * std::sqrt(2.0), 1.0);
+        }
+
+        // Just inside the top right corner, whose nearest grid point wraps to the bottom left one
+        c_vector<double, 2>& r_last_location = rMesh.GetNode(rMesh.GetNumNodes() - 1)->rGetModifiableLocation();
+        r_last_location[0] = 1.0 - 1e-9;
+        r_last_location[1] = 1.0 - 1e-9;
+    }
+
+public:
+
+    void TestCorrelatedForceMatchesDirectInterpolation()
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 100u);
+
+        VoronoiImmersedBoundaryMeshGenerator generator(4u, 4u, 5u, 64u, 1.0, 0.03, 0.5);
+        ImmersedBoundaryMesh<2, 2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasicRandom(cells, p_mesh->GetNumElements());
+        ImmersedBoundaryCellPopulation<2> cell_population(*p_mesh, cells);
+
+        UniformGridRandomFieldGenerator<2> field_generator({{0.0, 0.0}}, {{1.0, 1.0}}, {{16u, 16u}}, {{true, true}},
+                                                           0.8, 0.1);
+        const std::string cached_field_name = field_generator.SaveToCache();
+        std::shared_ptr<UniformGridRandomFieldGenerator<2>> p_shared_generator =
+                OffLatticeRandomFieldForce<2>::GetSharedRandomFieldGenerator(cached_field_name);
+
+        const double diffusion_strength = 0.1;
+        OffLatticeRandomFieldForce<2> force;
+        force.SetDiffusionStrength(diffusion_strength);
+        force.SetUpRandomFieldGenerator(cached_field_name);
+
+        const double force_scale_factor =
+                std::sqrt(2.0 * diffusion_strength / SimulationTime::Instance()->GetTimeStep());
+
+        // The grid location of each node is worked out afresh each time step, so move the nodes in between
+        for (const double offset : {0.0, 0.37})
+        {
+            SpreadNodes(*p_mesh, offset);
+            for (unsigned node_idx = 0; node_idx < p_mesh->GetNumNodes(); ++node_idx)
+            {
+                p_mesh->GetNode(node_idx)->ClearAppliedForce();
+            }
+
+            RandomNumberGenerator::Instance()->Reseed(5u);
+            force.AddForceContribution(cell_population);
+
+            // The same fields, sampled in the same order and interpolated at each node directly
+            RandomNumberGenerator::Instance()->Reseed(5u);
+            std::array<std::vector<double>, 2> fields;
+            for (auto& r_field : fields)
+            {
+                r_field = p_shared_generator->SampleRandomField();
+            }
+
+            for (unsigned node_idx = 0; node_idx < p_mesh->GetNumNodes(); ++node_idx)
+            {
+                Node<2>* const p_node = p_mesh->GetNode(node_idx);
+                for (unsigned dim = 0; dim < 2; ++dim)
+                {
+                    const double expected =
+                            force_scale_factor * p_shared_generator->Interpolate(fields[dim], p_node->rGetLocation());
+                    TS_ASSERT_DELTA(p_node->rGetAppliedForce()[dim], expected, 1e-12);
+                }
+            }
+        }
+    }
+};
+
+#endif /*TESTOFFLATTICERANDOMFIELDFORCE_HPP_*/
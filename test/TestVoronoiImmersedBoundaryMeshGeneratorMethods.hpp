@@ -0,0 +1,357 @@
+/*
+
+Copyright (c) 2005-2018, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Chaste.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TESTVORONOIIMMERSEDBOUNDARYMESHGENERATORMETHODS_HPP_
+#define TESTVORONOIIMMERSEDBOUNDARYMESHGENERATORMETHODS_HPP_
+
+// Needed for the test environment
+#include "AbstractCellBasedTestSuite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// From Chaste
+#include "Exception.hpp"
+#include "ImmersedBoundaryMesh.hpp"
+#include "MutableVertexMesh.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "UblasCustomFunctions.hpp"
+#include "VoronoiVertexMeshGenerator.hpp"
+
+// From this user project
+#include "VoronoiImmersedBoundaryMeshGenerator.hpp"
+
+// Tests do not run in parallel
+#include "FakePetscSetup.hpp"
+
+/**
+ * Tests of the helper methods of VoronoiImmersedBoundaryMeshGenerator, of which this suite is a friend.  The meshes
+ * are small so that the suite runs quickly.
+ */
+class TestVoronoiImmersedBoundaryMeshGenerator : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * Check two immersed boundary meshes have exactly the same nodes, elements and balancing fluid sources.
+     *
+     * @param rMeshA the first mesh
+     * @param rMeshB the second mesh
+     */
+    void CheckMeshesAreIdentical(ImmersedBoundaryMesh<2, 2>& rMeshA, ImmersedBoundaryMesh<2, 2>& rMeshB)
+    {
+        TS_ASSERT_EQUALS(rMeshA.GetNumNodes(), rMeshB.GetNumNodes());
+        TS_ASSERT_EQUALS(rMeshA.GetNumElements(), rMeshB.GetNumElements());
+        if (rMeshA.GetNumNodes() != rMeshB.GetNumNodes() || rMeshA.GetNumElements() != rMeshB.GetNumElements())
+        {
+            return;
+        }
+
+        for (unsigned node_idx = 0; node_idx < rMeshA.GetNumNodes(); ++node_idx)
+        {
+            TS_ASSERT_EQUALS(rMeshA.GetNode(node_idx)->rGetLocation()[0], rMeshB.GetNode(node_idx)->rGetLocation()[0]);
+            TS_ASSERT_EQUALS(rMeshA.GetNode(node_idx)->rGetLocation()[1], rMeshB.GetNode(node_idx)->rGetLocation()[1]);
+        }
+
+        for (unsigned elem_idx = 0; elem_idx < rMeshA.GetNumElements(); ++elem_idx)
+        {
+            ImmersedBoundaryElement<2, 2>* p_elem_a = rMeshA.GetElement(elem_idx);
+            ImmersedBoundaryElement<2, 2>* p_elem_b = rMeshB.GetElement(elem_idx);
+            TS_ASSERT_EQUALS(p_elem_a->GetNumNodes(), p_elem_b->GetNumNodes());
+            TS_ASSERT_EQUALS(p_elem_a->IsElementOnBoundary(), p_elem_b->IsElementOnBoundary());
+            const unsigned num_nodes = std::min(p_elem_a->GetNumNodes(), p_elem_b->GetNumNodes());
+            for (unsigned local_idx = 0; local_idx < num_nodes; ++local_idx)
+            {
+                TS_ASSERT_EQUALS(p_elem_a->GetNodeGlobalIndex(local_idx), p_elem_b->GetNodeGlobalIndex(local_idx));
+            }
+        }
+
+        TS_ASSERT_EQUALS(rMeshA.rGetBalancingFluidSources().size(), rMeshB.rGetBalancingFluidSources().size());
+    }
+
+    /**
+     * @param rFileName the full path of a file
+     * @return the bytes of the file
+     */
+    std::vector<char> ReadFile(const std::string& rFileName)
+    {
+        std::ifstream file(rFileName, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    /**
+     * @param rFileName the full path of a file, overwritten
+     * @param rBytes the new bytes of the file
+     */
+    void WriteFile(const std::string& rFileName, const std::vector<char>& rBytes)
+    {
+        std::ofstream file(rFileName, std::ios::binary | std::ios::trunc);
+        file.write(rBytes.data(), rBytes.size());
+    }
+
+public:
+
+    void TestCalculateSegmentIntersection()
+    {
+        using Generator = VoronoiImmersedBoundaryMeshGenerator;
+        c_vector<double, 2> intersection = zero_vector<double>(2);
+
+        // A proper crossing
+        TS_ASSERT(Generator::CalculateSegmentIntersection(Create_c_vector(0.0, 0.0), Create_c_vector(2.0, 2.0),
+                                                          Create_c_vector(0.0, 2.0), Create_c_vector(2.0, 0.0),
+                                                          intersection));
+        TS_ASSERT_DELTA(intersection[0], 1.0, 1e-12);
+        TS_ASSERT_DELTA(intersection[1], 1.0, 1e-12);
+
+        // Segments whose lines cross beyond the end of one of them
+        TS_ASSERT(!Generator::CalculateSegmentIntersection(Create_c_vector(0.0, 0.0), Create_c_vector(1.0, 0.0),
+                                                           Create_c_vector(2.0, -1.0), Create_c_vector(2.0, 1.0),
+                                                           intersection));
+
+        // Parallel segments
+        TS_ASSERT(!Generator::CalculateSegmentIntersection(Create_c_vector(0.0, 0.0), Create_c_vector(1.0, 0.0),
+                                                           Create_c_vector(0.0, 1.0), Create_c_vector(1.0, 1.0),
+                                                           intersection));
+
+        // Collinear overlapping segments have no unique intersection
+        TS_ASSERT(!Generator::CalculateSegmentIntersection(Create_c_vector(0.0, 0.0), Create_c_vector(2.0, 0.0),
+                                                           Create_c_vector(1.0, 0.0), Create_c_vector(3.0, 0.0),
+                                                           intersection));
+
+        // An end point of one segment touching the other
+        TS_ASSERT(Generator::CalculateSegmentIntersection(Create_c_vector(0.0, 0.0), Create_c_vector(2.0, 0.0),
+                                                          Create_c_vector(1.0, 0.0), Create_c_vector(1.0, 1.0),
+                                                          intersection));
+        TS_ASSERT_DELTA(intersection[0], 1.0, 1e-12);
+        TS_ASSERT_DELTA(intersection[1], 0.0, 1e-12);
+    }
+
+    void TestShrinkPolygon()
+    {
+        VoronoiImmersedBoundaryMeshGenerator generator;
+        generator.mAbsoluteGapBetweenElements = 0.02;
+
+        // Each corner of an anticlockwise square moves inwards along its bisector, but no further than the gap
+        const std::vector<c_vector<double, 2>> square = {Create_c_vector(0.0, 0.0), Create_c_vector(0.2, 0.0),
+                                                         Create_c_vector(0.2, 0.2), Create_c_vector(0.0, 0.2)};
+        std::vector<c_vector<double, 2>> shrunk = square;
+        std::vector<c_vector<double, 2>> scratch;
+        generator.ShrinkPolygon(shrunk, scratch);
+
+        TS_ASSERT_EQUALS(shrunk.size(), 4u);
+        for (unsigned idx = 0; idx < shrunk.size(); ++idx)
+        {
+            for (unsigned dim = 0; dim < 2; ++dim)
+            {
+                const double inset = std::fabs(shrunk[idx][dim] - square[idx][dim]);
+                TS_ASSERT_LESS_THAN(0.0, inset);
+                TS_ASSERT_LESS_THAN_EQUALS(inset, generator.mAbsoluteGapBetweenElements);
+                TS_ASSERT_LESS_THAN(0.0, shrunk[idx][dim]);
+                TS_ASSERT_LESS_THAN(shrunk[idx][dim], 0.2);
+            }
+        }
+
+        // Reusing the scratch space gives the same result
+        std::vector<c_vector<double, 2>> shrunk_again = square;
+        generator.ShrinkPolygon(shrunk_again, scratch);
+        for (unsigned idx = 0; idx < shrunk.size(); ++idx)
+        {
+            TS_ASSERT_EQUALS(shrunk_again[idx][0], shrunk[idx][0]);
+            TS_ASSERT_EQUALS(shrunk_again[idx][1], shrunk[idx][1]);
+        }
+    }
+
+    void TestMeshDoesNotDependOnNumberOfThreads()
+    {
+        RandomNumberGenerator::Instance()->Reseed(4u);
+        VoronoiImmersedBoundaryMeshGenerator serial(4u, 4u, 1u, 64u, 0.9, 0.02, 0.5, 1u);
+        const double next_random_after_serial = RandomNumberGenerator::Instance()->ranf();
+
+        RandomNumberGenerator::Instance()->Reseed(4u);
+        VoronoiImmersedBoundaryMeshGenerator threaded(4u, 4u, 1u, 64u, 0.9, 0.02, 0.5, 4u);
+        TS_ASSERT_EQUALS(RandomNumberGenerator::Instance()->ranf(), next_random_after_serial);
+
+        CheckMeshesAreIdentical(*serial.GetMesh(), *threaded.GetMesh());
+
+        TS_ASSERT_THROWS_THIS(VoronoiImmersedBoundaryMeshGenerator(4u, 4u, 1u, 64u, 0.9, 0.02, 0.5, 0u),
+                              "The number of threads must be at least 1.");
+    }
+
+    void TestTakingOwnershipRepositionsVertexMesh()
+    {
+        // The generator takes the vertex mesh from its VoronoiVertexMeshGenerator and translates it in place
+        RandomNumberGenerator::Instance()->Reseed(5u);
+        VoronoiImmersedBoundaryMeshGenerator owning(4u, 3u, 1u, 64u, 0.8, 0.02);
+
+        // The same vertex mesh, left where its own generator put it
+        RandomNumberGenerator::Instance()->Reseed(5u);
+        VoronoiVertexMeshGenerator vertex_generator(4u, 3u, 1u, (0.8 * 0.8) / (4.0 * 4.0));
+
+        MutableVertexMesh<2, 2>& r_owned = *owning.GetMutableVertexMesh();
+        MutableVertexMesh<2, 2>& r_original = *vertex_generator.GetMesh();
+        TS_ASSERT_EQUALS(r_owned.GetNumNodes(), r_original.GetNumNodes());
+        TS_ASSERT_EQUALS(r_owned.GetNumElements(), r_original.GetNumElements());
+        if (r_owned.GetNumNodes() != r_original.GetNumNodes() ||
+            r_owned.GetNumElements() != r_original.GetNumElements())
+        {
+            return;
+        }
+
+        // Every node is translated by the same vector, which centres the mesh, and nothing else changes
+        const c_vector<double, 2> correction = owning.GetRepositioningVector();
+        TS_ASSERT_DELTA(correction[0], 0.2, 1e-12);
+        TS_ASSERT_DELTA(correction[1], 0.1, 1e-12);
+        for (unsigned node_idx = 0; node_idx < r_owned.GetNumNodes(); ++node_idx)
+        {
+            const Node<2>* p_owned_node = r_owned.GetNode(node_idx);
+            const Node<2>* p_original_node = r_original.GetNode(node_idx);
+            TS_ASSERT_EQUALS(p_owned_node->GetIndex(), p_original_node->GetIndex());
+            TS_ASSERT_EQUALS(p_owned_node->rGetLocation()[0], p_original_node->rGetLocation()[0] + correction[0]);
+            TS_ASSERT_EQUALS(p_owned_node->rGetLocation()[1], p_original_node->rGetLocation()[1] + correction[1]);
+            TS_ASSERT_EQUALS(p_owned_node->IsBoundaryNode(), p_original_node->IsBoundaryNode());
+        }
+
+        for (unsigned elem_idx = 0; elem_idx < r_owned.GetNumElements(); ++elem_idx)
+        {
+            TS_ASSERT_EQUALS(r_owned.GetElement(elem_idx)->GetNumNodes(),
+                             r_original.GetElement(elem_idx)->GetNumNodes());
+            for (unsigned local_idx = 0; local_idx < r_owned.GetElement(elem_idx)->GetNumNodes(); ++local_idx)
+            {
+                TS_ASSERT_EQUALS(r_owned.GetElement(elem_idx)->GetNodeGlobalIndex(local_idx),
+                                 r_original.GetElement(elem_idx)->GetNodeGlobalIndex(local_idx));
+            }
+        }
+    }
+
+    void TestMeshCacheRoundTrip()
+    {
+        // Generate, and cache, a mesh, noting the random number generator state afterwards
+        RandomNumberGenerator::Instance()->Reseed(1u);
+        VoronoiImmersedBoundaryMeshGenerator generated(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, true);
+        const double next_random_after_generation = RandomNumberGenerator::Instance()->ranf();
+
+        const std::string cache_file_name = generated.rGetMeshCacheFileName();
+        TS_ASSERT(!cache_file_name.empty());
+        TS_ASSERT(!ReadFile(cache_file_name).empty());
+
+        // The same arguments from the same random number generator state read the cached mesh, and leave the
+        // random number generator as generation would
+        RandomNumberGenerator::Instance()->Reseed(1u);
+        VoronoiImmersedBoundaryMeshGenerator loaded(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, true);
+        TS_ASSERT_EQUALS(loaded.rGetMeshCacheFileName(), cache_file_name);
+        TS_ASSERT_EQUALS(RandomNumberGenerator::Instance()->ranf(), next_random_after_generation);
+
+        CheckMeshesAreIdentical(*generated.GetMesh(), *loaded.GetMesh());
+        TS_ASSERT_EQUALS(generated.GetMutableVertexMesh()->GetNumNodes(), loaded.GetMutableVertexMesh()->GetNumNodes());
+        TS_ASSERT_EQUALS(generated.GetMutableVertexMesh()->GetNumElements(),
+                         loaded.GetMutableVertexMesh()->GetNumElements());
+    }
+
+    void TestCorruptMeshCacheThrows()
+    {
+        RandomNumberGenerator::Instance()->Reseed(2u);
+        VoronoiImmersedBoundaryMeshGenerator generated(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, true);
+        const std::string cache_file_name = generated.rGetMeshCacheFileName();
+        const std::vector<char> valid_bytes = ReadFile(cache_file_name);
+        TS_ASSERT_LESS_THAN(sizeof(VoronoiImmersedBoundaryMeshGenerator::MeshCacheHeader), valid_bytes.size());
+
+        VoronoiImmersedBoundaryMeshGenerator::MeshCacheHeader header;
+        std::copy(valid_bytes.begin(), valid_bytes.begin() + sizeof(header), reinterpret_cast<char*>(&header));
+
+        auto LoadCorrupted = [&](const std::vector<char>& rBytes, const std::string& rExpectedReason)
+        {
+            WriteFile(cache_file_name, rBytes);
+            RandomNumberGenerator::Instance()->Reseed(2u);
+            TS_ASSERT_THROWS_CONTAINS(VoronoiImmersedBoundaryMeshGenerator(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, true),
+                                      rExpectedReason);
+        };
+
+        // Shorter than the header
+        LoadCorrupted(std::vector<char>(valid_bytes.begin(), valid_bytes.begin() + 8), "shorter than its header");
+
+        // Not a cache file
+        {
+            std::vector<char> bytes = valid_bytes;
+            bytes[0] ^= 1;
+            LoadCorrupted(bytes, "not a mesh cache file");
+        }
+
+        // Another layout version
+        {
+            std::vector<char> bytes = valid_bytes;
+            bytes[offsetof(VoronoiImmersedBoundaryMeshGenerator::MeshCacheHeader, mVersion)] ^= 2;
+            LoadCorrupted(bytes, "layout version");
+        }
+
+        // Truncated
+        LoadCorrupted(std::vector<char>(valid_bytes.begin(), valid_bytes.end() - 1), "bytes rather than");
+
+        // The last immersed boundary element node index past the last node, and the offsets out of order
+        const std::size_t ib_offsets_start = sizeof(header) +
+                sizeof(double) * 2u * (header.mNumVertexNodes + header.mNumIbNodes) +
+                sizeof(std::uint32_t) * (header.mNumVertexElements + 1u + header.mNumVertexElementNodeIndices);
+        const std::size_t ib_indices_end = ib_offsets_start +
+                sizeof(std::uint32_t) * (header.mNumIbElements + 1u + header.mNumIbElementNodeIndices);
+        {
+            std::vector<char> bytes = valid_bytes;
+            const std::uint32_t bad_index = header.mNumIbNodes;
+            std::copy(reinterpret_cast<const char*>(&bad_index), reinterpret_cast<const char*>(&bad_index + 1),
+                      bytes.begin() + ib_indices_end - sizeof(std::uint32_t));
+            LoadCorrupted(bytes, "is not less than its");
+        }
+        {
+            std::vector<char> bytes = valid_bytes;
+            const std::uint32_t bad_offset = header.mNumIbElementNodeIndices;
+            std::copy(reinterpret_cast<const char*>(&bad_offset), reinterpret_cast<const char*>(&bad_offset + 1),
+                      bytes.begin() + ib_offsets_start + sizeof(std::uint32_t));
+            LoadCorrupted(bytes, "element offsets decrease");
+        }
+
+        // With the valid file back in place, the mesh loads again
+        WriteFile(cache_file_name, valid_bytes);
+        RandomNumberGenerator::Instance()->Reseed(2u);
+        VoronoiImmersedBoundaryMeshGenerator loaded(3u, 3u, 1u, 64u, 0.9, 0.02, 0.5, 1u, true);
+        CheckMeshesAreIdentical(*generated.GetMesh(), *loaded.GetMesh());
+    }
+};
+
+#endif /*TESTVORONOIIMMERSEDBOUNDARYMESHGENERATORMETHODS_HPP_*/